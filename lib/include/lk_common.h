@@ -31,6 +31,7 @@ typedef enum {
     LK_WORD_NOT_FOUND, /*!< Suffix tree does not contain the word */
     LK_EXACT_MATCH, /*!< The word was found in the dictionary */
     LK_COMMENT, /*!< The parsed line is a comment and was skipped while processing data */
+    LK_FILE_WRITE_ERR, /*!< File was opened successfully but write failed */
 } lk_result;
 
 /**
@@ -5,23 +5,105 @@
 extern "C" {
 #endif
 
+/**
+ * \struct lk_dict_stats
+ *
+ * Dictionary size information returned by lk_dict_get_stats
+ */
+struct lk_dict_stats {
+    size_t words; /*!< number of words including all word forms */
+    size_t bases; /*!< number of base word forms */
+    size_t keys; /*!< number of distinct lookup keys in the tree */
+    size_t nodes; /*!< number of nodes in the lookup tree */
+    size_t tree_memory; /*!< number of bytes allocated by the lookup tree */
+};
+
+/**
+ * \enum lk_index_mode
+ *
+ * What keys are added to the dictionary lookup tree, see
+ *  lk_dict_set_index_mode
+ */
+typedef enum {
+    LK_INDEX_ALL_FORMS, /*!< every spelling variant of a word form */
+    LK_INDEX_FOLDED /*!< one folded key per word form */
+} lk_index_mode;
+
+/**
+ * \struct lk_lookup_result
+ *
+ * The result of one word checked by lk_dict_lookup_batch
+ */
+struct lk_lookup_result {
+    lk_result status; /*!< LK_EXACT_MATCH if the word is correct, LK_OK if
+                        the word has suggestions, or an error */
+    size_t first; /*!< index of the first suggestion of the word */
+    size_t count; /*!< number of suggestions of the word */
+};
+
+/**
+ * \struct lk_cache_stats
+ *
+ * Usage counters of a lookup cache returned by lk_lookup_ctx_cache_stats
+ */
+struct lk_cache_stats {
+    size_t hits; /*!< number of words found in the cache */
+    size_t misses; /*!< number of words that were looked up in the dictionary */
+    size_t entries; /*!< number of cached words */
+    size_t capacity; /*!< maximum number of cached words */
+};
+
 struct lk_dictionary;
 struct lk_word;
 struct lk_word_ptr;
+struct lk_lookup_ctx;
 
 struct lk_dictionary* lk_dict_init();
 lk_result lk_read_dictionary(struct lk_dictionary *dict, const char *path);
+lk_result lk_read_dictionary_parallel(struct lk_dictionary *dict, const char *path, size_t threads);
 void lk_dict_close(struct lk_dictionary* dict);
 int lk_is_dict_valid(const struct lk_dictionary* dict);
 size_t lk_word_count(const struct lk_dictionary *dict);
+lk_result lk_dict_freeze(struct lk_dictionary *dict);
+lk_result lk_dict_minimize(struct lk_dictionary *dict);
+lk_result lk_dict_set_index_mode(struct lk_dictionary *dict, lk_index_mode mode);
+lk_result lk_dict_get_stats(const struct lk_dictionary *dict, struct lk_dict_stats *stats);
+lk_result lk_dict_set_cache(struct lk_dictionary *dict, size_t entries);
+lk_result lk_dict_cache_stats(const struct lk_dictionary *dict, struct lk_cache_stats *stats);
+lk_result lk_dict_save_image(struct lk_dictionary *dict, const char *path);
+struct lk_dictionary* lk_dict_open_image(const char *path);
 
 lk_result lk_parse_word(const char *info, struct lk_dictionary* dict);
 char** lk_dict_exact_lookup(const struct lk_dictionary *dict,
         const char *word, int *count);
+char** lk_dict_exact_lookup_n(const struct lk_dictionary *dict,
+        const char *word, size_t len, int *count);
 void lk_exact_lookup_free(char** lookup);
+lk_result lk_dict_lookup_view(const struct lk_dictionary *dict, const char *word,
+        const char **suggestions, size_t *count);
+lk_result lk_dict_lookup_view_n(const struct lk_dictionary *dict, const char *word, size_t len,
+        const char **suggestions, size_t *count);
 
 
 const struct lk_word_ptr* lk_dict_find_word(const struct lk_dictionary *dict, const char *word);
+const struct lk_word_ptr* lk_dict_find_word_n(const struct lk_dictionary *dict, const char *word,
+        size_t len);
+
+struct lk_lookup_ctx* lk_lookup_ctx_init();
+void lk_lookup_ctx_free(struct lk_lookup_ctx *ctx);
+lk_result lk_lookup_ctx_set_cache(struct lk_lookup_ctx *ctx, size_t entries);
+lk_result lk_lookup_ctx_cache_stats(const struct lk_lookup_ctx *ctx, struct lk_cache_stats *stats);
+const struct lk_word_ptr* lk_dict_find_word_r(const struct lk_dictionary *dict, const char *word,
+        struct lk_lookup_ctx *ctx);
+char** lk_dict_exact_lookup_r(const struct lk_dictionary *dict, const char *word, int *count,
+        struct lk_lookup_ctx *ctx);
+lk_result lk_dict_lookup_view_r(const struct lk_dictionary *dict, const char *word,
+        const char **suggestions, size_t *count, struct lk_lookup_ctx *ctx);
+lk_result lk_dict_lookup_batch(const struct lk_dictionary *dict, const char **words, size_t n,
+        struct lk_lookup_result *results, const char **suggestions, size_t *sugg_count);
+lk_result lk_dict_lookup_batch_r(const struct lk_dictionary *dict, const char **words, size_t n,
+        struct lk_lookup_result *results, const char **suggestions, size_t *sugg_count,
+        struct lk_lookup_ctx *ctx);
 
 #ifdef __cplusplus
 }
@@ -5,13 +5,55 @@
 extern "C" {
 #endif
 
+/**
+ * \enum lk_file_mode
+ *
+ * How lk_file_open_ex reads a file
+ */
+typedef enum {
+    LK_FILE_BUFFERED, /*!< read by blocks into a buffer, it works for pipes */
+    LK_FILE_MMAP, /*!< map a regular file into memory */
+    LK_FILE_READ_AHEAD /*!< a background thread reads the file ahead by blocks */
+} lk_file_mode;
+
+/**
+ * @struct lk_file_stats
+ * Statistics of reading a file
+ */
+struct lk_file_stats {
+    size_t blocks; /*!< number of blocks read from the file */
+    size_t bytes; /*!< number of bytes in the blocks */
+    size_t stalls; /*!< number of times the reader waited for a block */
+    unsigned long long wait_ns; /*!< total time the reader waited for blocks, ns */
+};
+
+/**
+ * @struct lk_file_range
+ * A part of a file: lines that start at byte offsets in [begin, end)
+ */
+struct lk_file_range {
+    unsigned long long begin; /*!< offset of the first byte of the range */
+    unsigned long long end; /*!< offset after the last byte of the range */
+};
+
 struct lk_file;
 
 struct lk_file* lk_file_open(const char* path);
+struct lk_file* lk_file_open_ex(const char* path, lk_file_mode mode);
+struct lk_file* lk_file_open_read_ahead(const char* path, size_t block_size, size_t blocks);
+struct lk_file* lk_file_open_range(const char* path, lk_file_mode mode,
+        unsigned long long begin, unsigned long long end);
+lk_result lk_file_plan_chunks(const char *path, struct lk_file_range *ranges, size_t count);
 void lk_file_close(struct lk_file *file);
 int lk_file_is_valid(const struct lk_file const *file);
 
 lk_result lk_file_read(struct lk_file *file, char *buffer, size_t buf_size);
+lk_result lk_file_next_line_view(struct lk_file *file, const char **line, size_t *len);
+lk_result lk_file_read_line(struct lk_file *file, const char **line, size_t *len);
+lk_result lk_file_get_stats(const struct lk_file *file, struct lk_file_stats *stats);
+lk_result lk_file_check_utf8(struct lk_file *file, int enable);
+int lk_file_line_trusted(const struct lk_file *file);
+lk_result lk_file_utf8_error(const struct lk_file *file, unsigned long long *offset);
 
 #ifdef __cplusplus
 }
@@ -1,6 +1,8 @@
 #ifndef LKCHECKER_SUFTREE
 #define LKCHECKER_SUFTREE
 
+#include <stdio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,14 +19,66 @@ struct lk_word_ptr {
     struct lk_word_ptr *next;
 };
 
+/**
+ * \struct lk_tree_stats
+ *
+ * Size of a suffix tree returned by lk_tree_get_stats
+ */
+struct lk_tree_stats {
+    size_t nodes; /*!< number of tree leaves or trie states */
+    size_t keys; /*!< number of paths that have words */
+    size_t memory; /*!< total number of bytes allocated by the tree */
+};
+
+/**
+ * \struct lk_tree_pos
+ *
+ * A place in a suffix tree reached by walking a path with lk_tree_step.
+ *  Copy the structure to continue several paths from the same prefix.
+ *  The fields are internal and must not be changed by a caller
+ */
+struct lk_tree_pos {
+    const void *leaf; /*!< the leaf of the last character for a linked tree */
+    long state; /*!< the trie state for a frozen tree, -1 if the path is not in the tree */
+};
+
 struct lk_word;
 struct lk_tree;
 
+/**
+ * Returns the number of a word that is written to a file by lk_tree_save
+ *  instead of the word pointer
+ */
+typedef unsigned int (*lk_word_id_func)(const struct lk_word *word, void *arg);
+
 struct lk_tree* lk_tree_init();
 void lk_tree_free(struct lk_tree *tree);
 
 lk_result lk_tree_add_word(struct lk_tree *tree, const char *path, const struct lk_word *word);
+lk_result lk_tree_merge(struct lk_tree *tree, struct lk_tree **parts, size_t cnt, const char *order);
 const struct lk_word_ptr* lk_tree_search(const struct lk_tree *tree, const char *path);
+const struct lk_word_ptr* lk_tree_search_n(const struct lk_tree *tree, const char *path, size_t len);
+void lk_tree_root(const struct lk_tree *tree, struct lk_tree_pos *pos);
+lk_result lk_tree_step(const struct lk_tree *tree, struct lk_tree_pos *pos,
+        const char *path, size_t len, struct lk_tree_pos *trail);
+lk_result lk_tree_step_char(const struct lk_tree *tree, struct lk_tree_pos *pos, unsigned int cp);
+const struct lk_word_ptr* lk_tree_pos_words(const struct lk_tree *tree,
+        const struct lk_tree_pos *pos);
+lk_result lk_tree_walk_many(const struct lk_tree *tree, const char **paths, size_t n,
+        struct lk_tree_pos *pos);
+
+lk_result lk_tree_freeze(struct lk_tree *tree);
+lk_result lk_tree_minimize(struct lk_tree *tree);
+int lk_tree_is_frozen(const struct lk_tree *tree);
+lk_result lk_tree_get_stats(const struct lk_tree *tree, struct lk_tree_stats *stats);
+
+lk_result lk_tree_save(const struct lk_tree *tree, FILE *fh, lk_word_id_func id_of, void *arg,
+        size_t *written);
+struct lk_tree* lk_tree_open_image(const void *data, size_t size);
+lk_result lk_tree_search_ids(const struct lk_tree *tree, const char *path,
+        const unsigned int **ids, size_t *count);
+lk_result lk_tree_pos_ids(const struct lk_tree *tree, const struct lk_tree_pos *pos,
+        const unsigned int **ids, size_t *count);
 
 #ifdef __cplusplus
 }
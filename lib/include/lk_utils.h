@@ -5,19 +5,83 @@
 extern "C" {
 #endif
 
+/** @enum lk_form
+ * Variants of a word built by lk_normalize_forms. The dictionary adds the
+ *  forms from LK_FORM_LOW to LK_FORM_ASCII_GRAVE to the lookup tree in the
+ *  order they are declared
+ */
+typedef enum {
+    LK_FORM_LOW, /*!< low case, quotes replaced with glottal stop: lk_to_low_case */
+    LK_FORM_LOW_NO_STOP, /*!< LK_FORM_LOW without glottal stops */
+    LK_FORM_UNSTRESSED, /*!< LK_FORM_LOW without stress marks */
+    LK_FORM_UNSTRESSED_NO_STOP, /*!< LK_FORM_UNSTRESSED without glottal stops */
+    LK_FORM_ASCII, /*!< LK_FORM_UNSTRESSED with all diacritic marks removed */
+    LK_FORM_ASCII_NO_STOP, /*!< LK_FORM_ASCII without glottal stops */
+    LK_FORM_ASCII_GRAVE, /*!< LK_FORM_ASCII with apostrophes replaced with
+                           grave accents */
+    LK_FORM_DESTRESSED, /*!< the original word without stress marks: lk_destress */
+    LK_FORM_DESTRESSED_LOW, /*!< LK_FORM_DESTRESSED in low case */
+    LK_FORM_COUNT
+} lk_form;
+
+#define LK_FORM_BIT(f) (1u << (f))
+/**
+ * All forms the dictionary adds to the lookup tree for every word
+ */
+#define LK_FORMS_DICT (LK_FORM_BIT(LK_FORM_ASCII_GRAVE + 1) - 1)
+
+/**
+ * @struct lk_forms
+ * Variants of a word built by lk_normalize_forms
+ */
+struct lk_forms {
+    char form[LK_FORM_COUNT][LK_MAX_WORD_LEN]; /*!< NUL-terminated variants */
+    unsigned int valid; /*!< LK_FORM_BIT(f) is set if the form f was built.
+                          A form is not built if it was not requested or if
+                          it did not fit LK_MAX_WORD_LEN bytes */
+    unsigned int distinct; /*!< LK_FORM_BIT(f) is set for a form from LK_FORMS_DICT
+                             that differs from the original word and from all
+                             forms declared before it. Unstressed forms
+                             are never distinct if stressed is 0 */
+    int stressed; /*!< number of stressed vowels, see lk_stressed_vowels_no */
+    int has_stop; /*!< non-zero if the word contains glottal stop */
+};
+
+/**
+ * @struct lk_word_span
+ * A word found by lk_split_words
+ */
+struct lk_word_span {
+    size_t offset; /*!< offset of the first byte of the word in the buffer */
+    size_t len; /*!< length of the word in bytes */
+};
+
+lk_result lk_normalize_forms(const char *word, unsigned int kinds, struct lk_forms *forms);
+lk_result lk_normalize_forms_n(const char *word, size_t len, unsigned int kinds,
+        struct lk_forms *forms);
+unsigned int lk_match_forms(const char *word, unsigned int kinds, const char *key);
 lk_result lk_to_low_case(const char *word, char *out, size_t out_sz);
+lk_result lk_to_low_case_n(const char *word, size_t len, char *out, size_t out_sz);
+lk_result lk_to_low_case_trusted(const char *word, size_t len, char *out, size_t out_sz);
 
 int lk_stressed_vowels_no(const char *word);
 int lk_vowels_no(const char *word);
 int lk_is_ascii(const char *word);
 lk_result lk_to_ascii(const char *word, char *out, size_t out_sz);
+lk_result lk_to_ascii_n(const char *word, size_t len, char *out, size_t out_sz);
+lk_result lk_to_ascii_trusted(const char *word, size_t len, char *out, size_t out_sz);
 lk_result lk_destress(const char *word, char *out, size_t out_sz);
+lk_result lk_destress_n(const char *word, size_t len, char *out, size_t out_sz);
+lk_result lk_destress_trusted(const char *word, size_t len, char *out, size_t out_sz);
 lk_result lk_remove_glottal_stop(const char *word, char *out, size_t out_sz);
+lk_result lk_remove_glottal_stop_n(const char *word, size_t len, char *out, size_t out_sz);
+lk_result lk_remove_glottal_stop_trusted(const char *word, size_t len, char *out, size_t out_sz);
 int lk_has_glottal_stop(const char *word);
 
 int lk_ends_with(const char *orig, const char *cmp);
 const char* lk_word_begin(const char *str, size_t pos);
 const char* lk_next_word(const char *str, size_t *len);
+lk_result lk_split_words(const char *str, size_t len, struct lk_word_span *words, size_t *count);
 
 #ifdef __cplusplus
 }
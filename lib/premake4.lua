@@ -39,3 +39,6 @@ project "lkchecker"
       flags { "Optimize" }
 
    links { "utf8proc" }
+
+   configuration "linux"
+      links { "pthread" }
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+
+#include "lk_arena.h"
+
+/* all allocations are aligned to this value */
+#define LK_ARENA_ALIGN (sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double))
+
+/**
+ * @struct lk_chunk
+ * One block of memory owned by an arena. Data follows the header
+ */
+struct lk_chunk {
+    struct lk_chunk *next; /*!< previously allocated chunk */
+    size_t used; /*!< number of bytes given out from this chunk */
+    size_t cap; /*!< chunk data capacity */
+};
+
+/* size of the chunk header rounded up to keep data aligned */
+#define LK_CHUNK_HEADER ((sizeof(struct lk_chunk) + LK_ARENA_ALIGN - 1) & ~(LK_ARENA_ALIGN - 1))
+
+/**
+ * Initializes an empty arena. The first chunk is allocated with the first
+ *  lk_arena_alloc call
+ *
+ * @param[in] arena is a pointer to arena to initialize
+ * @param[in] chunk_size is the size of every chunk in bytes. If it is 0 then
+ *  LK_ARENA_CHUNK_SIZE is used
+ */
+void lk_arena_init(struct lk_arena *arena, size_t chunk_size) {
+    if (arena == NULL)
+        return;
+
+    arena->head = NULL;
+    arena->chunk_size = (chunk_size == 0) ? LK_ARENA_CHUNK_SIZE : chunk_size;
+    arena->used = 0;
+    arena->reserved = 0;
+}
+
+/**
+ * Frees all chunks of the arena. All pointers returned by the arena become
+ *  invalid. The arena can be used again after the call
+ */
+void lk_arena_free(struct lk_arena *arena) {
+    if (arena == NULL)
+        return;
+
+    struct lk_chunk *chunk = arena->head;
+    while (chunk != NULL) {
+        struct lk_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    arena->head = NULL;
+    arena->used = 0;
+    arena->reserved = 0;
+}
+
+/**
+ * Allocates a block of memory from the arena. The memory is not initialized
+ *  and it must not be freed with free()
+ *
+ * @return NULL if size is 0 or if allocating a new chunk failed
+ */
+void* lk_arena_alloc(struct lk_arena *arena, size_t size) {
+    if (arena == NULL || size == 0)
+        return NULL;
+
+    size = (size + LK_ARENA_ALIGN - 1) & ~(LK_ARENA_ALIGN - 1);
+
+    struct lk_chunk *chunk = arena->head;
+    if (chunk == NULL || chunk->cap - chunk->used < size) {
+        size_t cap = arena->chunk_size - LK_CHUNK_HEADER;
+        if (cap < size)
+            cap = size;
+
+        chunk = (struct lk_chunk*)malloc(LK_CHUNK_HEADER + cap);
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->cap = cap;
+        chunk->used = 0;
+        chunk->next = arena->head;
+        arena->head = chunk;
+        arena->reserved += LK_CHUNK_HEADER + cap;
+    }
+
+    void *ptr = (char*)chunk + LK_CHUNK_HEADER + chunk->used;
+    chunk->used += size;
+    arena->used += size;
+
+    return ptr;
+}
+
+/**
+ * Moves all chunks of src to the arena, so the memory given out by src is
+ *  freed with the arena. New allocations still use the current chunk of the
+ *  arena. src becomes empty
+ */
+void lk_arena_merge(struct lk_arena *arena, struct lk_arena *src) {
+    if (arena == NULL || src == NULL || src->head == NULL)
+        return;
+
+    if (arena->head == NULL) {
+        arena->head = src->head;
+    } else {
+        struct lk_chunk *last = src->head;
+        while (last->next != NULL)
+            last = last->next;
+        last->next = arena->head->next;
+        arena->head->next = src->head;
+    }
+
+    arena->used += src->used;
+    arena->reserved += src->reserved;
+    src->head = NULL;
+    src->used = 0;
+    src->reserved = 0;
+}
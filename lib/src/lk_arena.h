@@ -0,0 +1,38 @@
+#ifndef LKCHECKER_ARENA
+#define LKCHECKER_ARENA
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Default size of one arena chunk in bytes
+ */
+#define LK_ARENA_CHUNK_SIZE (64 * 1024)
+
+struct lk_chunk;
+
+/**
+ * @struct lk_arena
+ * Bump allocator used internally by the library for small structures that
+ *  live as long as their owner (tree leaves, word lists etc). Memory is taken
+ *  from big chunks and it is never freed item by item: lk_arena_free drops
+ *  all chunks at once
+ */
+struct lk_arena {
+    struct lk_chunk *head; /*!< the chunk that is used for allocations now */
+    size_t chunk_size; /*!< size of a new chunk */
+    size_t used; /*!< total number of bytes given out by the arena */
+    size_t reserved; /*!< total number of bytes allocated for all chunks */
+};
+
+void lk_arena_init(struct lk_arena *arena, size_t chunk_size);
+void lk_arena_free(struct lk_arena *arena);
+void* lk_arena_alloc(struct lk_arena *arena, size_t size);
+void lk_arena_merge(struct lk_arena *arena, struct lk_arena *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
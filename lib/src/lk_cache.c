@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "lk_common.h"
+#include "lk_cache.h"
+
+/* the end of a list of items */
+#define LK_CACHE_NONE 0xFFFFFFFFu
+
+/* FNV-1a hash of the key */
+static size_t hash_key(const char *key, size_t len) {
+    size_t h = 2166136261u;
+    for (size_t idx = 0; idx < len; idx++)
+        h = (h ^ (unsigned char)key[idx]) * 16777619u;
+    return h;
+}
+
+static void unlink_item(struct lk_cache *cache, unsigned int idx) {
+    struct lk_cache_item *item = &cache->items[idx];
+    if (item->prev == LK_CACHE_NONE)
+        cache->head = item->next;
+    else
+        cache->items[item->prev].next = item->next;
+    if (item->next == LK_CACHE_NONE)
+        cache->tail = item->prev;
+    else
+        cache->items[item->next].prev = item->prev;
+}
+
+static void push_item(struct lk_cache *cache, unsigned int idx) {
+    struct lk_cache_item *item = &cache->items[idx];
+    item->prev = LK_CACHE_NONE;
+    item->next = cache->head;
+    if (cache->head == LK_CACHE_NONE)
+        cache->tail = idx;
+    else
+        cache->items[cache->head].prev = idx;
+    cache->head = idx;
+}
+
+/**
+ * Allocates a cache of cap items. The cache is empty after the call
+ *
+ * @return the result of operation:
+ *  LK_OK - the cache is ready
+ *  LK_INVALID_ARG - cache is NULL or cap is 0 or too big
+ *  LK_OUT_OF_MEMORY - failed to allocate memory, the cache is disabled
+ */
+lk_result lk_cache_init(struct lk_cache *cache, size_t cap) {
+    if (cache == NULL || cap == 0 || cap >= LK_CACHE_NONE)
+        return LK_INVALID_ARG;
+
+    memset(cache, 0, sizeof(*cache));
+    size_t buckets = 1;
+    while (buckets < cap)
+        buckets <<= 1;
+    cache->items = (struct lk_cache_item*)malloc(cap * sizeof(*cache->items));
+    cache->buckets = (unsigned int*)malloc(buckets * sizeof(*cache->buckets));
+    if (cache->items == NULL || cache->buckets == NULL) {
+        lk_cache_free(cache);
+        return LK_OUT_OF_MEMORY;
+    }
+
+    cache->mask = buckets - 1;
+    cache->cap = cap;
+    lk_cache_clear(cache);
+    return LK_OK;
+}
+
+/**
+ * Frees the memory of the cache. The cache becomes disabled
+ */
+void lk_cache_free(struct lk_cache *cache) {
+    if (cache == NULL)
+        return;
+
+    free(cache->items);
+    free(cache->buckets);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * Drops all items of the cache. Hit and miss counters are kept
+ */
+void lk_cache_clear(struct lk_cache *cache) {
+    if (cache == NULL || cache->items == NULL)
+        return;
+
+    memset(cache->buckets, 0xFF, (cache->mask + 1) * sizeof(*cache->buckets));
+    cache->used = 0;
+    cache->head = LK_CACHE_NONE;
+    cache->tail = LK_CACHE_NONE;
+}
+
+/**
+ * Finds the result of the word and marks it as the most recently used one
+ *
+ * @return NULL if the word is not in the cache or the cache is disabled
+ */
+const struct lk_cache_item* lk_cache_get(struct lk_cache *cache, const char *key, size_t len) {
+    if (cache == NULL || cache->items == NULL)
+        return NULL;
+
+    if (len >= LK_CACHE_KEY_LEN) {
+        cache->misses++;
+        return NULL;
+    }
+
+    size_t hash = hash_key(key, len);
+    unsigned int idx = cache->buckets[hash & cache->mask];
+    while (idx != LK_CACHE_NONE) {
+        const struct lk_cache_item *item = &cache->items[idx];
+        if (item->hash == hash && memcmp(item->key, key, len) == 0 && item->key[len] == '\0')
+            break;
+        idx = item->chain;
+    }
+    if (idx == LK_CACHE_NONE) {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->hits++;
+    if (idx != cache->head) {
+        unlink_item(cache, idx);
+        push_item(cache, idx);
+    }
+    return &cache->items[idx];
+}
+
+/**
+ * Adds the word that is not in the cache. If the cache is full the least
+ *  recently used item is replaced. The caller fills the result of the
+ *  returned item
+ *
+ * @return NULL if the word is too long or the cache is disabled
+ */
+struct lk_cache_item* lk_cache_put(struct lk_cache *cache, const char *key, size_t len) {
+    if (cache == NULL || cache->items == NULL)
+        return NULL;
+
+    if (len >= LK_CACHE_KEY_LEN)
+        return NULL;
+
+    unsigned int idx;
+    if (cache->used < cache->cap) {
+        idx = (unsigned int)cache->used++;
+    } else {
+        idx = cache->tail;
+        unlink_item(cache, idx);
+        unsigned int *link = &cache->buckets[cache->items[idx].hash & cache->mask];
+        while (*link != idx)
+            link = &cache->items[*link].chain;
+        *link = cache->items[idx].chain;
+    }
+
+    struct lk_cache_item *item = &cache->items[idx];
+    memcpy(item->key, key, len);
+    item->key[len] = '\0';
+    item->hash = hash_key(key, len);
+    item->status = LK_OK;
+    item->count = 0;
+    item->chain = cache->buckets[item->hash & cache->mask];
+    cache->buckets[item->hash & cache->mask] = idx;
+    push_item(cache, idx);
+    return item;
+}
@@ -0,0 +1,65 @@
+#ifndef LKCHECKER_CACHE
+#define LKCHECKER_CACHE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum length of a cached word in bytes including the terminating NUL.
+ *  Longer words are looked up every time
+ */
+#define LK_CACHE_KEY_LEN 48
+/**
+ * Maximum number of suggestions kept for a cached word. Words with more
+ *  suggestions are looked up every time
+ */
+#define LK_CACHE_SUGG 6
+
+/**
+ * @struct lk_cache_item
+ * The result of looking up one word
+ */
+struct lk_cache_item {
+    char key[LK_CACHE_KEY_LEN]; /*!< the word as it was given */
+    size_t hash; /*!< hash of the key */
+    lk_result status; /*!< the result of the lookup */
+    unsigned int count; /*!< number of items in sugg */
+    const char *sugg[LK_CACHE_SUGG]; /*!< suggestions, they point to the
+                                       dictionary strings */
+    unsigned int prev; /*!< more recently used item */
+    unsigned int next; /*!< less recently used item */
+    unsigned int chain; /*!< next item in the same hash bucket */
+};
+
+/**
+ * @struct lk_cache
+ * Bounded cache of lookup results used internally by lookup contexts. When
+ *  the cache is full the least recently used item is replaced. The cache
+ *  remembers the generation of the dictionary its items came from, the
+ *  owner clears the cache when the generation changes
+ */
+struct lk_cache {
+    struct lk_cache_item *items; /*!< NULL if the cache is disabled */
+    unsigned int *buckets; /*!< hash table: the first item of every bucket */
+    size_t mask; /*!< number of buckets minus 1 */
+    size_t cap; /*!< number of items */
+    size_t used; /*!< number of filled items */
+    unsigned int head; /*!< the most recently used item */
+    unsigned int tail; /*!< the least recently used item */
+    unsigned long long generation; /*!< the dictionary generation */
+    size_t hits; /*!< number of found words */
+    size_t misses; /*!< number of words that were not in the cache */
+};
+
+lk_result lk_cache_init(struct lk_cache *cache, size_t cap);
+void lk_cache_free(struct lk_cache *cache);
+void lk_cache_clear(struct lk_cache *cache);
+const struct lk_cache_item* lk_cache_get(struct lk_cache *cache, const char *key, size_t len);
+struct lk_cache_item* lk_cache_put(struct lk_cache *cache, const char *key, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
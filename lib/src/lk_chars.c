@@ -0,0 +1,10 @@
+#include "lk_common.h"
+#include "lk_chars.h"
+
+#define LK_CHAR_ENTRY(cp, flags, low, ascii, unstressed) \
+    [(cp) < LK_CHAR_TABLE_SIZE ? (cp) : LK_CHAR_SLOT_QUOTE2] = {(flags), (low), (ascii), (unstressed)},
+
+/* the table is built from LK_CHAR_LIST, the slots of other characters are zero */
+const struct lk_char_info lk_char_table[LK_CHAR_TABLE_SIZE + 2] = {
+    LK_CHAR_LIST(LK_CHAR_ENTRY)
+};
@@ -0,0 +1,149 @@
+#ifndef LKCHECKER_CHARS
+#define LKCHECKER_CHARS
+
+#include <utf8proc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* classification flags of a character */
+#define LK_CH_LETTER 0x01 /* a letter of a Lakota word, glottal stop letters included */
+#define LK_CH_VOWEL 0x02 /* a vowel in low case, stressed or not */
+#define LK_CH_STRESSED 0x04 /* a stressed vowel in low case */
+#define LK_CH_QUOTE 0x08 /* a mark that is read as glottal stop */
+
+/*
+ * All characters that Lakota text uses, the only source of the table of
+ *  lk_char_info. A line is:
+ *   X(code point, flags, low case form, ASCII form, unstressed form)
+ *  The ASCII form is what lk_to_ascii writes: diacritic marks are removed
+ *  from letters in low case, and all glottal stops become single quote mark.
+ *  Every code point must be less than LK_CHAR_TABLE_SIZE except LK_QUOTE2
+ *  that has its own slot
+ */
+#define LK_CHAR_LIST(X) \
+    X('a', LK_CH_LETTER | LK_CH_VOWEL, 'a', 'a', 'a') \
+    X('b', LK_CH_LETTER, 'b', 'b', 'b') \
+    X('c', LK_CH_LETTER, 'c', 'c', 'c') \
+    X('d', LK_CH_LETTER, 'd', 'd', 'd') \
+    X('e', LK_CH_LETTER | LK_CH_VOWEL, 'e', 'e', 'e') \
+    X('f', LK_CH_LETTER, 'f', 'f', 'f') \
+    X('g', LK_CH_LETTER, 'g', 'g', 'g') \
+    X('h', LK_CH_LETTER, 'h', 'h', 'h') \
+    X('i', LK_CH_LETTER | LK_CH_VOWEL, 'i', 'i', 'i') \
+    X('j', LK_CH_LETTER, 'j', 'j', 'j') \
+    X('k', LK_CH_LETTER, 'k', 'k', 'k') \
+    X('l', LK_CH_LETTER, 'l', 'l', 'l') \
+    X('m', LK_CH_LETTER, 'm', 'm', 'm') \
+    X('n', LK_CH_LETTER, 'n', 'n', 'n') \
+    X('o', LK_CH_LETTER | LK_CH_VOWEL, 'o', 'o', 'o') \
+    X('p', LK_CH_LETTER, 'p', 'p', 'p') \
+    X('q', LK_CH_LETTER, 'q', 'q', 'q') \
+    X('r', LK_CH_LETTER, 'r', 'r', 'r') \
+    X('s', LK_CH_LETTER, 's', 's', 's') \
+    X('t', LK_CH_LETTER, 't', 't', 't') \
+    X('u', LK_CH_LETTER | LK_CH_VOWEL, 'u', 'u', 'u') \
+    X('v', LK_CH_LETTER, 'v', 'v', 'v') \
+    X('w', LK_CH_LETTER, 'w', 'w', 'w') \
+    X('x', LK_CH_LETTER, 'x', 'x', 'x') \
+    X('y', LK_CH_LETTER, 'y', 'y', 'y') \
+    X('z', LK_CH_LETTER, 'z', 'z', 'z') \
+    X('A', LK_CH_LETTER, 'a', 'A', 'A') \
+    X('B', LK_CH_LETTER, 'b', 'B', 'B') \
+    X('C', LK_CH_LETTER, 'c', 'C', 'C') \
+    X('D', LK_CH_LETTER, 'd', 'D', 'D') \
+    X('E', LK_CH_LETTER, 'e', 'E', 'E') \
+    X('F', LK_CH_LETTER, 'f', 'F', 'F') \
+    X('G', LK_CH_LETTER, 'g', 'G', 'G') \
+    X('H', LK_CH_LETTER, 'h', 'H', 'H') \
+    X('I', LK_CH_LETTER, 'i', 'I', 'I') \
+    X('J', LK_CH_LETTER, 'j', 'J', 'J') \
+    X('K', LK_CH_LETTER, 'k', 'K', 'K') \
+    X('L', LK_CH_LETTER, 'l', 'L', 'L') \
+    X('M', LK_CH_LETTER, 'm', 'M', 'M') \
+    X('N', LK_CH_LETTER, 'n', 'N', 'N') \
+    X('O', LK_CH_LETTER, 'o', 'O', 'O') \
+    X('P', LK_CH_LETTER, 'p', 'P', 'P') \
+    X('Q', LK_CH_LETTER, 'q', 'Q', 'Q') \
+    X('R', LK_CH_LETTER, 'r', 'R', 'R') \
+    X('S', LK_CH_LETTER, 's', 'S', 'S') \
+    X('T', LK_CH_LETTER, 't', 'T', 'T') \
+    X('U', LK_CH_LETTER, 'u', 'U', 'U') \
+    X('V', LK_CH_LETTER, 'v', 'V', 'V') \
+    X('W', LK_CH_LETTER, 'w', 'W', 'W') \
+    X('X', LK_CH_LETTER, 'x', 'X', 'X') \
+    X('Y', LK_CH_LETTER, 'y', 'Y', 'Y') \
+    X('Z', LK_CH_LETTER, 'z', 'Z', 'Z') \
+    X(LK_A_LOW, LK_CH_LETTER | LK_CH_VOWEL | LK_CH_STRESSED, LK_A_LOW, 'a', 'a') \
+    X(LK_O_LOW, LK_CH_LETTER | LK_CH_VOWEL | LK_CH_STRESSED, LK_O_LOW, 'o', 'o') \
+    X(LK_E_LOW, LK_CH_LETTER | LK_CH_VOWEL | LK_CH_STRESSED, LK_E_LOW, 'e', 'e') \
+    X(LK_I_LOW, LK_CH_LETTER | LK_CH_VOWEL | LK_CH_STRESSED, LK_I_LOW, 'i', 'i') \
+    X(LK_U_LOW, LK_CH_LETTER | LK_CH_VOWEL | LK_CH_STRESSED, LK_U_LOW, 'u', 'u') \
+    X(LK_A_UP, LK_CH_LETTER, LK_A_LOW, LK_A_UP, LK_A_UP) \
+    X(LK_O_UP, LK_CH_LETTER, LK_O_LOW, LK_O_UP, LK_O_UP) \
+    X(LK_E_UP, LK_CH_LETTER, LK_E_LOW, LK_E_UP, LK_E_UP) \
+    X(LK_I_UP, LK_CH_LETTER, LK_I_LOW, LK_I_UP, LK_I_UP) \
+    X(LK_U_UP, LK_CH_LETTER, LK_U_LOW, LK_U_UP, LK_U_UP) \
+    X(LK_N_LOW, LK_CH_LETTER, LK_N_LOW, 'n', LK_N_LOW) \
+    X(LK_C_LOW, LK_CH_LETTER, LK_C_LOW, 'c', LK_C_LOW) \
+    X(LK_Z_LOW, LK_CH_LETTER, LK_Z_LOW, 'z', LK_Z_LOW) \
+    X(LK_H_LOW, LK_CH_LETTER, LK_H_LOW, 'h', LK_H_LOW) \
+    X(LK_G_LOW, LK_CH_LETTER, LK_G_LOW, 'g', LK_G_LOW) \
+    X(LK_S_LOW, LK_CH_LETTER, LK_S_LOW, 's', LK_S_LOW) \
+    X(LK_N_UP, LK_CH_LETTER, LK_N_LOW, LK_N_UP, LK_N_UP) \
+    X(LK_C_UP, LK_CH_LETTER, LK_C_LOW, LK_C_UP, LK_C_UP) \
+    X(LK_Z_UP, LK_CH_LETTER, LK_Z_LOW, LK_Z_UP, LK_Z_UP) \
+    X(LK_H_UP, LK_CH_LETTER, LK_H_LOW, LK_H_UP, LK_H_UP) \
+    X(LK_G_UP, LK_CH_LETTER, LK_G_LOW, LK_G_UP, LK_G_UP) \
+    X(LK_S_UP, LK_CH_LETTER, LK_S_LOW, LK_S_UP, LK_S_UP) \
+    X('\'', LK_CH_QUOTE, '\'', '\'', '\'') \
+    X('`', LK_CH_QUOTE, '`', '\'', '`') \
+    X(LK_QUOTE, LK_CH_LETTER | LK_CH_QUOTE, LK_QUOTE, '\'', LK_QUOTE) \
+    X(LK_QUOTE2, LK_CH_LETTER | LK_CH_QUOTE, LK_QUOTE2, '\'', LK_QUOTE2)
+
+/* code points below the size are looked up directly */
+#define LK_CHAR_TABLE_SIZE 0x300
+/* the slot of LK_QUOTE2 and the slot of all other characters */
+#define LK_CHAR_SLOT_QUOTE2 LK_CHAR_TABLE_SIZE
+#define LK_CHAR_SLOT_OTHER (LK_CHAR_TABLE_SIZE + 1)
+
+/**
+ * @struct lk_char_info
+ * Classification of a character. A character that is not in LK_CHAR_LIST
+ *  has zero flags and its forms are not filled
+ */
+struct lk_char_info {
+    unsigned short flags; /*!< LK_CH_ flags, 0 for characters not in the list */
+    unsigned short low; /*!< low case form */
+    unsigned short ascii; /*!< ASCII form */
+    unsigned short unstressed; /*!< the form without stress mark */
+};
+
+extern const struct lk_char_info lk_char_table[LK_CHAR_TABLE_SIZE + 2];
+
+/* returns the classification of a code point, negative code points included */
+static inline const struct lk_char_info* lk_char_get(int cp) {
+    unsigned int slot = (unsigned int)cp < LK_CHAR_TABLE_SIZE ? (unsigned int)cp
+        : cp == LK_QUOTE2 ? LK_CHAR_SLOT_QUOTE2 : LK_CHAR_SLOT_OTHER;
+    return &lk_char_table[slot];
+}
+
+/* glottal stop as lk_to_low_case writes it */
+static inline int lk_char_fix_quote(int cp) {
+    return (lk_char_get(cp)->flags & LK_CH_QUOTE) ? LK_QUOTE : cp;
+}
+
+/* characters that Lakota does not use are converted by utf8proc */
+static inline int lk_char_to_low(int cp) {
+    const struct lk_char_info *ci = lk_char_get(cp);
+    if (ci->flags)
+        return ci->low;
+    return cp < 0x80 ? cp : utf8proc_tolower(cp);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
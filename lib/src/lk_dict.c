@@ -14,16 +14,87 @@
 #include "lk_file.h"
 #include "lk_utils.h"
 #include "lk_tree.h"
+#include "lk_map.h"
+#include "lk_thread.h"
+#include "lk_cache.h"
+#include "lk_chars.h"
+#include "lk_utf8.h"
+
+/* base of a word that is a base form itself */
+#define LK_NO_BASE 0xFFFFFFFFu
+/* an empty slot of the string index */
+#define LK_NO_STR 0xFFFFFFFFu
+
+/* word records are allocated by chunks of 2^LK_WORD_CHUNK_BITS items, so
+ * pointers to them kept by the lookup tree never change */
+#define LK_WORD_CHUNK_BITS 12
+#define LK_WORD_CHUNK ((size_t)1 << LK_WORD_CHUNK_BITS)
 
 /**
  * @struct lk_word
- * Keeps an information about one word form, used by lk_dictionary
+ * Keeps an information about one word form, used by lk_dictionary. Records
+ *  are written to a dictionary image as is
  */
 struct lk_word {
-    struct lk_word *base; /*!< pointer to base word - used for extra word forms */
-    struct lk_word *next; /*!< pointer to next word in the dictionary */
+    unsigned int str; /*!< offset of the word form in the string pool */
+    unsigned int base; /*!< index of the base word or LK_NO_BASE */
+    unsigned int forms; /*!< LK_FORM_BIT of the forms that find the word
+                          in LK_INDEX_FOLDED dictionary */
+};
 
-    char *word; /*!< the word form */
+/**
+ * @struct lk_batch_key
+ * A word of lk_dict_lookup_batch_r. Words are sorted only to group equal
+ *  words, so every distinct word is normalized and looked up once
+ */
+struct lk_batch_key {
+    unsigned long long prefix; /*!< the first 8 bytes of the word, it makes
+                                 most comparisons cheap */
+    const char *key; /*!< the word */
+    size_t word; /*!< index of the word in the batch */
+};
+
+/* offset of a form that was not built for a batch word */
+#define LK_NO_TEXT ((size_t)-1)
+
+/**
+ * @struct lk_batch_word
+ * A distinct word of lk_dict_lookup_batch_r. Forms are offsets in the batch
+ *  text because the text grows while words are added
+ */
+struct lk_batch_word {
+    size_t word; /*!< index of the word in the batch */
+    size_t key; /*!< the tree key or LK_NO_TEXT */
+    size_t low; /*!< the word in low case */
+    size_t dlow; /*!< the word without stress marks in low case or LK_NO_TEXT */
+    size_t dword; /*!< the word without stress marks */
+    int stress; /*!< 1 if the word has stress marks, -1 if it has them but
+                  the form without them was not built, 0 otherwise */
+};
+
+/**
+ * @struct lk_lookup_ctx
+ * Scratch buffers used by dictionary lookups. A lookup changes only its
+ *  context, so threads that use different contexts can look up words in
+ *  the same dictionary at the same time
+ */
+struct lk_lookup_ctx {
+    struct lk_forms forms; /*!< normalized forms of the word to look up */
+    struct lk_word_ptr *found_list; /*!< the last image or folded lookup result */
+    size_t found_cap; /*!< number of items in found_list */
+    struct lk_cache cache; /*!< results of recent lookups, disabled by default */
+
+    /* buffers of lk_dict_lookup_batch_r, they grow to the largest batch */
+    struct lk_batch_key *keys; /*!< sorted words of the batch */
+    struct lk_batch_key *sorted; /*!< temporary buffer of the sort */
+    struct lk_batch_word *batch; /*!< distinct words of the batch */
+    const char **paths; /*!< tree keys to walk */
+    struct lk_tree_pos *pos; /*!< where the tree keys end */
+    size_t *retry; /*!< distinct words to look up without stress marks */
+    size_t batch_cap; /*!< number of items in all batch buffers */
+    char *text; /*!< forms of distinct words */
+    size_t text_size; /*!< number of used bytes in text */
+    size_t text_cap; /*!< size of text */
 };
 
 /**
@@ -31,46 +102,369 @@ struct lk_word {
  * The storage for all word forms
  */
 struct lk_dictionary {
-    struct lk_word *head; /*!< the first dictionary word */
-    struct lk_word *tail; /*!< the last dictionary word, used by add-word
-                            feature for best performance */
+    struct lk_word **chunks; /*!< word records in the order they were added */
+    size_t chunk_cap; /*!< number of items in chunks */
+    char *strings; /*!< all word forms, NUL-terminated. Every distinct form
+                     is kept once, so words with the same offset are the
+                     same form. It points to the mapped image if the
+                     dictionary is an image */
+    size_t strings_size; /*!< number of used bytes in strings */
+    size_t strings_cap; /*!< size of strings */
+    unsigned int *str_index; /*!< hash table of offsets of forms in strings,
+                               it finds a form that is already stored */
+    size_t str_index_cap; /*!< number of slots in str_index, a power of 2 */
+    size_t str_cnt; /*!< number of distinct forms in strings */
+    size_t word_cnt; /*!< number of word forms including base forms */
+    size_t base_cnt; /*!< number of base forms */
     struct lk_tree *tree; /*!< suffix tree for quick lookup */
+    lk_index_mode index; /*!< what keys of a word are added to the tree */
+    struct lk_key_run *run; /*!< if it is not NULL, lookup keys of new words
+                              are collected here instead of adding them to
+                              the tree. Used by the parallel loader */
+
+    /* dictionary opened with lk_dict_open_image */
+    struct lk_map map; /*!< the mapped image, map.data is NULL for
+                         a dictionary loaded from a text file */
+    const struct lk_word *image_words; /*!< words table of the image */
+
+    struct lk_lookup_ctx ctx; /*!< used by lookup functions without _r suffix */
+    unsigned long long generation; /*!< unique number of the dictionary
+                                     contents, it changes when words are
+                                     added. Lookup caches compare it */
 };
 
+/* "LKDI" in little-endian byte order */
+#define LK_IMAGE_MAGIC 0x49444b4cu
+#define LK_IMAGE_VERSION 3
+/* written as is, so an image created on a machine with another byte order is rejected */
+#define LK_IMAGE_BYTE_ORDER 0x01020304u
+
 /**
- * @struct lk_word_form
- * A suggestion for a incorrect word. Used internally by dictionary lookup
- *  to avoid extra malloc calls
+ * @struct lk_image_header
+ * The first bytes of a dictionary image written by lk_dict_save_image.
+ *  All sections start at offsets aligned to 8 bytes
  */
-struct lk_word_form {
-    char form[LK_MAX_WORD_LEN];
-    struct lk_word_form *next;
+struct lk_image_header {
+    unsigned int magic; /*!< LK_IMAGE_MAGIC */
+    unsigned int version; /*!< LK_IMAGE_VERSION */
+    unsigned int byte_order; /*!< LK_IMAGE_BYTE_ORDER */
+    unsigned int words; /*!< number of items in words table */
+    unsigned int index; /*!< lk_index_mode of the dictionary */
+    unsigned int bases; /*!< number of base forms */
+    unsigned long long strings_offset; /*!< NUL-terminated word forms */
+    unsigned long long strings_size;
+    unsigned long long words_offset; /*!< words table: lk_word items */
+    unsigned long long trie_offset; /*!< the tree written by lk_tree_save */
+    unsigned long long trie_size;
 };
 
+/* returns the word record by its index */
+static const struct lk_word* word_at(const struct lk_dictionary *dict, size_t idx) {
+    if (dict->map.data != NULL)
+        return &dict->image_words[idx];
+    return &dict->chunks[idx >> LK_WORD_CHUNK_BITS][idx & (LK_WORD_CHUNK - 1)];
+}
+
+static const char* word_str(const struct lk_dictionary *dict, const struct lk_word *word) {
+    return dict->strings + word->str;
+}
+
+static void free_ctx_buffers(struct lk_lookup_ctx *ctx) {
+    free(ctx->found_list);
+    ctx->found_list = NULL;
+    ctx->found_cap = 0;
+    free(ctx->keys);
+    free(ctx->sorted);
+    free(ctx->batch);
+    free((void*)ctx->paths);
+    free(ctx->pos);
+    free(ctx->retry);
+    free(ctx->text);
+    ctx->keys = NULL;
+    ctx->sorted = NULL;
+    ctx->batch = NULL;
+    ctx->paths = NULL;
+    ctx->pos = NULL;
+    ctx->retry = NULL;
+    ctx->text = NULL;
+    ctx->batch_cap = 0;
+    ctx->text_size = 0;
+    ctx->text_cap = 0;
+    lk_cache_free(&ctx->cache);
+}
+
+/**
+ * Allocates a lookup context for lk_dict_find_word_r, lk_dict_exact_lookup_r
+ *  and lk_dict_lookup_batch_r. Every thread must use its own context.
+ *  A context is not bound to a dictionary, so it can be used with any
+ *  dictionary
+ *
+ * @return NULL if it failed to allocate memory
+ *
+ * @sa lk_lookup_ctx_free
+ */
+struct lk_lookup_ctx* lk_lookup_ctx_init() {
+    return (struct lk_lookup_ctx*)calloc(1, sizeof(struct lk_lookup_ctx));
+}
+
+/**
+ * Frees the lookup context. Lists returned by lk_dict_find_word_r with this
+ *  context become invalid. If ctx is NULL the function does nothing
+ */
+void lk_lookup_ctx_free(struct lk_lookup_ctx *ctx) {
+    if (ctx == NULL)
+        return;
+
+    free_ctx_buffers(ctx);
+    free(ctx);
+}
+
+/* makes room for count items in the lookup result kept in the context */
+static lk_result reserve_found(struct lk_lookup_ctx *ctx, size_t count) {
+    if (count <= ctx->found_cap)
+        return LK_OK;
+
+    size_t cap = count < 16 ? 16 : count;
+    struct lk_word_ptr *list = (struct lk_word_ptr*)realloc(ctx->found_list,
+            cap * sizeof(*list));
+    if (list == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->found_list = list;
+    ctx->found_cap = cap;
+    return LK_OK;
+}
+
+/* links the first count items of the lookup result kept in the context */
+static const struct lk_word_ptr* link_found(struct lk_lookup_ctx *ctx, size_t count) {
+    if (count == 0)
+        return NULL;
+
+    for (size_t idx = 0; idx < count; idx++)
+        ctx->found_list[idx].next = (idx + 1 < count) ? &ctx->found_list[idx + 1] : NULL;
+    return ctx->found_list;
+}
+
+/* returns non-zero if the lookup key finds the word with the given forms in
+ * LK_INDEX_FOLDED dictionary: the key is either the word or one of its forms */
+static int folded_match(const char *word, unsigned int forms, const char *key) {
+    return strcmp(word, key) == 0 || lk_match_forms(word, forms, key) != 0;
+}
+
+/* fills the context buffer with the words of an image for lk_dict_find_word_r.
+ * The list points to the word records of the image.
+ * If key is not NULL only the words that the key matches are added */
+static const struct lk_word_ptr* image_word_list(const struct lk_dictionary *dict,
+        struct lk_lookup_ctx *ctx, const unsigned int *ids, size_t count, const char *key) {
+    if (count == 0 || reserve_found(ctx, count) != LK_OK)
+        return NULL;
+
+    size_t found = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        if (ids[idx] >= dict->word_cnt)
+            return NULL;
+        const struct lk_word *w = &dict->image_words[ids[idx]];
+        if (w->str >= dict->strings_size)
+            return NULL;
+        if (key != NULL && !folded_match(word_str(dict, w), w->forms, key))
+            continue;
+        ctx->found_list[found++].word = w;
+    }
+
+    return link_found(ctx, found);
+}
+
+/* returns the words of the tree list that the key matches */
+static const struct lk_word_ptr* folded_word_list(const struct lk_dictionary *dict,
+        const struct lk_word_ptr *list, struct lk_lookup_ctx *ctx, const char *key) {
+    size_t count = 0;
+    for (const struct lk_word_ptr *cw = list; cw != NULL; cw = cw->next)
+        count++;
+    if (count == 0 || reserve_found(ctx, count) != LK_OK)
+        return NULL;
+
+    size_t found = 0;
+    for (const struct lk_word_ptr *cw = list; cw != NULL; cw = cw->next) {
+        if (folded_match(word_str(dict, cw->word), cw->word->forms, key))
+            ctx->found_list[found++].word = cw->word;
+    }
+
+    return link_found(ctx, found);
+}
+
+/* the key of LK_INDEX_FOLDED dictionary: the word in low case without stress
+ * marks, diacritics and glottal stops. A word of glottal stops only uses its
+ * low case form. NULL if the form was not built */
+static const char* folded_key(const struct lk_forms *forms) {
+    if ((forms->valid & LK_FORM_BIT(LK_FORM_ASCII_NO_STOP)) == 0)
+        return NULL;
+    if (forms->form[LK_FORM_ASCII_NO_STOP][0] == '\0')
+        return forms->form[LK_FORM_LOW];
+    return forms->form[LK_FORM_ASCII_NO_STOP];
+}
+
+/* returns the words at the tree position of a lookup key. key is the word in
+ * low case, it filters the words of LK_INDEX_FOLDED dictionary */
+static const struct lk_word_ptr* words_at_pos(const struct lk_dictionary *dict,
+        const struct lk_tree_pos *pos, const char *key, struct lk_lookup_ctx *ctx) {
+    if (dict->map.data != NULL) {
+        const unsigned int *ids;
+        size_t count;
+        if (lk_tree_pos_ids(dict->tree, pos, &ids, &count) != LK_OK)
+            return NULL;
+        return image_word_list(dict, ctx, ids, count,
+                dict->index == LK_INDEX_FOLDED ? key : NULL);
+    }
+
+    const struct lk_word_ptr *list = lk_tree_pos_words(dict->tree, pos);
+    if (dict->index == LK_INDEX_FOLDED)
+        return folded_word_list(dict, list, ctx, key);
+    return list;
+}
+
+/* looks up a word that is already converted to low case. folded is the
+ * key of LK_INDEX_FOLDED dictionary or NULL to build it from the key */
+static const struct lk_word_ptr* find_low_word(const struct lk_dictionary *dict, const char *key,
+        const char *folded, struct lk_lookup_ctx *ctx) {
+    struct lk_forms key_forms;
+
+    if (dict->index == LK_INDEX_FOLDED) {
+        if (folded == NULL) {
+            if (lk_normalize_forms(key, LK_FORM_BIT(LK_FORM_ASCII_NO_STOP), &key_forms) != LK_OK)
+                return NULL;
+            folded = folded_key(&key_forms);
+            if (folded == NULL)
+                return NULL;
+        }
+    } else {
+        folded = key;
+    }
+
+    struct lk_tree_pos pos;
+    lk_tree_root(dict->tree, &pos);
+    if (lk_tree_step(dict->tree, &pos, folded, strlen(folded), NULL) != LK_OK)
+        return NULL;
+    return words_at_pos(dict, &pos, key, ctx);
+}
+
+
+/* walks the tree by the low case form of a word without building the form:
+ * every character is decoded once, converted the same way as for
+ * LK_FORM_LOW of lk_normalize_forms_n and looked up at once. Returns 0 if
+ * the path is not in the tree or the word has no low case form */
+static int walk_low_case(const struct lk_dictionary *dict, const char *word, size_t len,
+        struct lk_tree_pos *pos) {
+    if (len > LK_MAX_WORD_LEN)
+        return 0;
+
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + len;
+    /* the length of the word with glottal stops in place of quote marks */
+    size_t quoted = 0;
+    lk_tree_root(dict->tree, pos);
+    while (usrc < uend) {
+        utf8proc_int32_t cp = *usrc;
+        utf8proc_ssize_t cplen = 1;
+        if (cp >= 0x80) {
+            cplen = lk_utf8_decode(usrc, uend - usrc, &cp);
+            if (cp == -1)
+                return 0;
+        }
+        usrc += cplen;
+
+        utf8proc_int32_t q = lk_char_fix_quote(cp);
+        utf8proc_int32_t low = lk_char_to_low(q);
+        quoted += lk_utf8_cp_len(q);
+        if (quoted + 1 > LK_MAX_WORD_LEN || lk_utf8_cp_len(low) > lk_utf8_cp_len(q))
+            return 0;
+        if (lk_tree_step_char(dict->tree, pos, (unsigned int)low) != LK_OK)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* looks up the word of len bytes for lk_dict_find_word_r and lk_dict_find_word_n */
+static const struct lk_word_ptr* find_word(const struct lk_dictionary *dict, const char *word,
+        size_t len, struct lk_lookup_ctx *ctx) {
+    if (dict->index != LK_INDEX_FOLDED) {
+        struct lk_tree_pos pos;
+        if (!walk_low_case(dict, word, len, &pos))
+            return NULL;
+        return words_at_pos(dict, &pos, NULL, ctx);
+    }
+
+    /* the key of the folded index is another form, and the words are
+     * filtered with the low case form, so both forms are built */
+    unsigned int kinds = LK_FORM_BIT(LK_FORM_LOW) | LK_FORM_BIT(LK_FORM_ASCII_NO_STOP);
+    lk_result r = lk_normalize_forms_n(word, len, kinds, &ctx->forms);
+    if (r != LK_OK || (ctx->forms.valid & LK_FORM_BIT(LK_FORM_LOW)) == 0)
+        return NULL;
+
+    return find_low_word(dict, ctx->forms.form[LK_FORM_LOW], folded_key(&ctx->forms), ctx);
+}
+
+/**
+ * Reentrant version of lk_dict_find_word. Any number of threads can look up
+ *  words in the same dictionary at the same time if every thread uses its
+ *  own context and nobody changes the dictionary
+ *
+ * @param[in] dict is a dictionary to look up
+ * @param[in] word is a word to find
+ * @param[in] ctx is a lookup context created with lk_lookup_ctx_init. For
+ *  a dictionary opened with lk_dict_open_image the result is kept in the
+ *  context and it is valid until the next lookup with the same context
+ *
+ * @return NULL if no suggestion was found or any argument is NULL
+ *
+ * @sa lk_dict_find_word
+ */
+const struct lk_word_ptr* lk_dict_find_word_r(const struct lk_dictionary *dict, const char *word,
+        struct lk_lookup_ctx *ctx) {
+    if (!lk_is_dict_valid(dict) || word == NULL || ctx == NULL)
+        return NULL;
+
+    return find_word(dict, word, strlen(word), ctx);
+}
+
 /**
  * Lookup the word in a dictionary and returns th elist of all possible words
- *  that can replace the original one if it is incorrect
+ *  that can replace the original one if it is incorrect. For a dictionary
+ *  opened with lk_dict_open_image the list is valid until the next call.
+ *  The function uses buffers of the dictionary, so it must not be called
+ *  from different threads at the same time, use lk_dict_find_word_r instead
  *
  *  @return NULL if no suggestion was found
  */
 const struct lk_word_ptr* lk_dict_find_word(const struct lk_dictionary *dict, const char *word) {
-    if (!lk_is_dict_valid(dict) || word == NULL)
+    if (dict == NULL)
         return NULL;
 
-    static char low_word[LK_MAX_WORD_LEN];
-    lk_result r = lk_to_low_case(word, low_word, LK_MAX_WORD_LEN);
-    if (r != LK_OK)
+    return lk_dict_find_word_r(dict, word, (struct lk_lookup_ctx*)&dict->ctx);
+}
+
+/**
+ * Length-delimited version of lk_dict_find_word: the word is len bytes long
+ *  and does not have to end with zero, so a word is looked up right in the
+ *  text without copying it
+ *
+ * @sa lk_dict_find_word
+ */
+const struct lk_word_ptr* lk_dict_find_word_n(const struct lk_dictionary *dict, const char *word,
+        size_t len) {
+    if (!lk_is_dict_valid(dict) || word == NULL)
         return NULL;
 
-    return lk_tree_search(dict->tree, low_word);
+    return find_word(dict, word, len, (struct lk_lookup_ctx*)&dict->ctx);
 }
 
-static int lk_suggestions_no(const struct lk_word_ptr *words, const char *word) {
+static int lk_suggestions_no(const struct lk_dictionary *dict, const struct lk_word_ptr *words,
+        const char *word, size_t len) {
     int total = 0;
 
     while (words) {
         total++;
-        if (strcmp(words->word->word, word) == 0) {
+        const char *str = word_str(dict, words->word);
+        if (strlen(str) == len && memcmp(str, word, len) == 0) {
             total = 0;
             break;
         }
@@ -80,42 +474,70 @@ static int lk_suggestions_no(const struct lk_word_ptr *words, const char *word)
     return total;
 }
 
-static lk_result lk_add_to_suggestions(char **suggestions, size_t idx, const char *word) {
-    /* skip duplicates */
-    int already_used = 0;
-    for (size_t chk = 0; chk < idx; ++chk) {
-        if (strcmp(suggestions[chk], word) == 0) {
-            already_used = 1;
-            break;
-        }
-    }
-    if (already_used)
-        return LK_EXACT_MATCH;
+/* writes the distinct forms of the found words to out and returns their
+ * number. Forms that do not fit cap items are only counted */
+static size_t list_suggestions(const struct lk_dictionary *dict, const struct lk_word_ptr *match,
+        const char **out, size_t cap) {
+    size_t cnt = 0;
+    for (const struct lk_word_ptr *cw = match; cw != NULL; cw = cw->next) {
+        /* equal forms have the same offset in the string pool */
+        const struct lk_word_ptr *prev = match;
+        while (prev != cw && prev->word->str != cw->word->str)
+            prev = prev->next;
+        if (prev != cw)
+            continue;
 
-    suggestions[idx] = (char*)calloc(strlen(word) + 1, sizeof(char));
-    if (suggestions[idx] == NULL)
-        return LK_OUT_OF_MEMORY;
+        if (cnt < cap)
+            out[cnt] = word_str(dict, cw->word);
+        cnt++;
+    }
 
-    strcpy(suggestions[idx], word);
-    return LK_OK;
+    return cnt;
 }
 
-static void lk_free_suggestions(char **suggestions) {
-    if (suggestions == NULL)
-        return;
+/* checks the word the way lk_dict_exact_lookup does. If the word is not
+ * correct but it is found, match receives the words to suggest */
+static lk_result check_word(const struct lk_dictionary *dict, const char *word, size_t len,
+        struct lk_lookup_ctx *ctx, const struct lk_word_ptr **match) {
+    /* all forms needed for both lookups are built in one pass */
+    struct lk_forms *forms = &ctx->forms;
+    unsigned int kinds = LK_FORM_BIT(LK_FORM_LOW) | LK_FORM_BIT(LK_FORM_DESTRESSED_LOW);
+    if (dict->index == LK_INDEX_FOLDED)
+        kinds |= LK_FORM_BIT(LK_FORM_ASCII_NO_STOP);
+    if (lk_normalize_forms_n(word, len, kinds, forms) != LK_OK)
+        return LK_WORD_NOT_FOUND;
+
+    /* the found words are compared with the word itself or with its form
+     * without stress marks if the word has invalid stress */
+    const char *checked = word;
+    size_t checked_len = len;
+    *match = NULL;
+    if (forms->valid & LK_FORM_BIT(LK_FORM_LOW))
+        *match = find_low_word(dict, forms->form[LK_FORM_LOW], folded_key(forms), ctx);
+    if (*match == NULL && forms->stressed > 0) {
+        /* process invalid word stressing */
+        if ((forms->valid & LK_FORM_BIT(LK_FORM_DESTRESSED)) == 0)
+            return LK_INVALID_STRING;
 
-    char *f = *suggestions;
-    while (f) {
-        free(f);
-        f++;
+        /* invalid stress detected - used unstressed word instead of user's one */
+        if (forms->valid & LK_FORM_BIT(LK_FORM_DESTRESSED_LOW))
+            *match = find_low_word(dict, forms->form[LK_FORM_DESTRESSED_LOW],
+                    folded_key(forms), ctx);
+        checked = forms->form[LK_FORM_DESTRESSED];
+        checked_len = strlen(checked);
     }
 
-    free(suggestions);
+    if (*match == NULL)
+        return LK_WORD_NOT_FOUND;
+    return (lk_suggestions_no(dict, *match, checked, checked_len) == 0) ? LK_EXACT_MATCH : LK_OK;
 }
 
 /**
  * Returns a list of words that may be a valid form of the original one. Do not
- *  free the list manually, use lk_exact_lookup_free.
+ *  free the list manually, use lk_exact_lookup_free. The function uses
+ *  buffers of the dictionary, so it must not be called from different
+ *  threads at the same time, use lk_dict_exact_lookup_r instead.
+ *  lk_dict_lookup_view gives the same list without allocating memory
  *
  * @param[in] dict is initialized dictionary to lookup
  * @param[in] word is the word to check whether it has correct spelling
@@ -134,84 +556,288 @@ static void lk_free_suggestions(char **suggestions) {
  *   count contains the number of suggestions
  *
  * @sa lk_exact_lookup_free
+ * @sa lk_dict_exact_lookup_r
+ * @sa lk_dict_lookup_view
  */
 char** lk_dict_exact_lookup(const struct lk_dictionary *dict, const char *word, int *count) {
-    char** suggestions = NULL;
-    static char unstressed[LK_MAX_WORD_LEN];
-
-    if (count == NULL)
-        return NULL;
-
-    if (word == NULL || !lk_is_dict_valid(dict)) {
-        *count = -LK_INVALID_ARG;
+    if (dict == NULL) {
+        if (count != NULL)
+            *count = -LK_INVALID_ARG;
         return NULL;
     }
 
-    /* lookup the main word */
-    /* if not found - return NULL & count = -LK_WORD_NOT_FOUND */
-    const struct lk_word_ptr *match = lk_dict_find_word(dict, word);
-    if (match == NULL && lk_stressed_vowels_no(word) > 0) {
-        /* process invalid word stressing */
-        lk_result r = lk_destress(word, unstressed, LK_MAX_WORD_LEN);
-        if (r != LK_OK) {
-            *count = -LK_INVALID_STRING;
-            return NULL;
-        }
+    return lk_dict_exact_lookup_r(dict, word, count, (struct lk_lookup_ctx*)&dict->ctx);
+}
 
-        /* invalid stress detected - used unstressed word instead of user's one */
-        match = lk_dict_find_word(dict, unstressed);
-        if (match != NULL)
-            word = unstressed;
+/* checks the word of len bytes for lk_dict_lookup_view_r and
+ * lk_dict_lookup_view_n, the arguments are already checked */
+static lk_result lookup_view(const struct lk_dictionary *dict, const char *word, size_t len,
+        const char **suggestions, size_t *count, struct lk_lookup_ctx *ctx) {
+    size_t cap = *count;
+    *count = 0;
+
+    /* cached results are valid only for the dictionary they came from */
+    struct lk_cache *cache = &ctx->cache;
+    if (cache->items != NULL && cache->generation != dict->generation) {
+        lk_cache_clear(cache);
+        cache->generation = dict->generation;
+    }
+    const struct lk_cache_item *hit = lk_cache_get(cache, word, len);
+    if (hit != NULL) {
+        *count = hit->count;
+        for (size_t idx = 0; idx < hit->count && idx < cap; idx++)
+            suggestions[idx] = hit->sugg[idx];
+        return (*count > cap) ? LK_BUFFER_SMALL : hit->status;
     }
 
-    if (match == NULL) {
-        *count = -LK_WORD_NOT_FOUND;
-        return NULL;
+    const struct lk_word_ptr *match = NULL;
+    lk_result r = check_word(dict, word, len, ctx, &match);
+    if (r == LK_OK)
+        *count = list_suggestions(dict, match, suggestions, cap);
+    if (cache->items != NULL && *count <= LK_CACHE_SUGG) {
+        struct lk_cache_item *item = lk_cache_put(cache, word, len);
+        if (item != NULL) {
+            item->status = r;
+            item->count = (unsigned int)*count;
+            if (r == LK_OK)
+                list_suggestions(dict, match, item->sugg, LK_CACHE_SUGG);
+        }
     }
 
-    int total = lk_suggestions_no(match, word);
-    if (total == 0) {
+    if (r != LK_OK)
+        return r;
+    return (*count > cap) ? LK_BUFFER_SMALL : LK_OK;
+}
+
+/* builds the list of lk_dict_exact_lookup_r and lk_dict_exact_lookup_n for
+ * the word of len bytes, the arguments are already checked */
+static char** exact_lookup(const struct lk_dictionary *dict, const char *word, size_t len,
+        int *count, struct lk_lookup_ctx *ctx) {
+    const char *view[LK_CACHE_SUGG];
+    size_t total = LK_CACHE_SUGG;
+    lk_result r = lookup_view(dict, word, len, view, &total, ctx);
+    if (r == LK_EXACT_MATCH) {
         *count = 0;
         return NULL;
     }
-    int skip_match = total == 0;
-
-    struct lk_word_form *w_list = NULL;
+    if (r != LK_OK && r != LK_BUFFER_SMALL) {
+        *count = -r;
+        return NULL;
+    }
 
     /* add extra for NULL tail */
-    total++;
-    /* generate and return all the list */
-    suggestions = (char**)calloc(total, sizeof(char*));
+    char **suggestions = (char**)calloc(total + 1, sizeof(char*));
     if (suggestions == NULL) {
         *count = -LK_OUT_OF_MEMORY;
         return NULL;
     }
 
-    size_t idx = 0;
-    lk_result final = LK_OK;
-    if (!skip_match) {
-        const struct lk_word_ptr *cw = match;
-        while (final == LK_OK && cw) {
-            lk_result res = lk_add_to_suggestions(suggestions, idx, cw->word->word);
-            if (res == LK_OUT_OF_MEMORY) {
-                final = res;
-            } else if (res == LK_OK) {
-                ++idx;
-            }
-
-            cw = cw->next;
+    const char **list = view;
+    if (r == LK_BUFFER_SMALL) {
+        /* a long list is built again right in the result */
+        const struct lk_word_ptr *match;
+        check_word(dict, word, len, ctx, &match);
+        list_suggestions(dict, match, (const char**)suggestions, total);
+        list = (const char**)suggestions;
+    }
+    for (size_t idx = 0; idx < total; idx++) {
+        const char *str = list[idx];
+        size_t sz = strlen(str) + 1;
+        suggestions[idx] = (char*)malloc(sz);
+        if (suggestions[idx] == NULL) {
+            /* the list ends at the failed item */
+            lk_exact_lookup_free(suggestions);
+            *count = -LK_OUT_OF_MEMORY;
+            return NULL;
         }
+        memcpy(suggestions[idx], str, sz);
     }
 
-    if (final != LK_OK) {
-        lk_free_suggestions(suggestions);
-        *count = -LK_OUT_OF_MEMORY;
+    *count = (int)total;
+    return suggestions;
+}
+
+/**
+ * Reentrant version of lk_dict_exact_lookup: all temporary data is kept in
+ *  the lookup context, so threads with different contexts can call it for
+ *  the same dictionary at the same time. If ctx is NULL count is set
+ *  to -LK_INVALID_ARG
+ *
+ * @sa lk_dict_exact_lookup
+ * @sa lk_lookup_ctx_init
+ */
+char** lk_dict_exact_lookup_r(const struct lk_dictionary *dict, const char *word, int *count,
+        struct lk_lookup_ctx *ctx) {
+    if (count == NULL)
+        return NULL;
+
+    if (word == NULL || ctx == NULL || !lk_is_dict_valid(dict)) {
+        *count = -LK_INVALID_ARG;
         return NULL;
     }
 
-    *count = idx;
+    return exact_lookup(dict, word, strlen(word), count, ctx);
+}
+
+/**
+ * Length-delimited version of lk_dict_exact_lookup: the word is len bytes
+ *  long and does not have to end with zero, so a word is checked right in
+ *  the text without copying it
+ *
+ * @sa lk_dict_exact_lookup
+ */
+char** lk_dict_exact_lookup_n(const struct lk_dictionary *dict, const char *word, size_t len,
+        int *count) {
+    if (count == NULL)
+        return NULL;
 
-    return suggestions;
+    if (word == NULL || !lk_is_dict_valid(dict)) {
+        *count = -LK_INVALID_ARG;
+        return NULL;
+    }
+
+    return exact_lookup(dict, word, len, count, (struct lk_lookup_ctx*)&dict->ctx);
+}
+
+/**
+ * Checks the word like lk_dict_exact_lookup but does not allocate memory:
+ *  suggestions point to the word forms kept by the dictionary and they are
+ *  written to the caller's array. Every form is listed once. The function
+ *  uses buffers of the dictionary, so it must not be called from different
+ *  threads at the same time, use lk_dict_lookup_view_r instead.
+ *
+ * @param[in] dict is initialized dictionary to lookup
+ * @param[in] word is the word to check whether it has correct spelling
+ * @param[out] suggestions receives the suggestions, do not free them.
+ *  Items point to the dictionary strings, so they become invalid when words
+ *  are added with lk_parse_word or lk_read_dictionary and when the
+ *  dictionary is closed. It can be NULL if *count is 0
+ * @param[in,out] count is the number of items in suggestions. It receives
+ *  the number of suggestions of the word
+ *
+ * @return the result of operation:
+ *  LK_EXACT_MATCH - the word was found in the dictionary, count is 0
+ *  LK_OK - the word has count suggestions
+ *  LK_BUFFER_SMALL - the suggestions did not fit the array. The array is
+ *   filled up to its size and count receives the required size
+ *  LK_WORD_NOT_FOUND - the dictionary does not contain the word
+ *  LK_INVALID_STRING - the word has invalid stress marks
+ *  LK_INVALID_ARG - dict is not valid, word or count is NULL
+ *
+ * @sa lk_dict_lookup_view_r
+ * @sa lk_dict_exact_lookup
+ */
+lk_result lk_dict_lookup_view(const struct lk_dictionary *dict, const char *word,
+        const char **suggestions, size_t *count) {
+    if (dict == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_dict_lookup_view_r(dict, word, suggestions, count, (struct lk_lookup_ctx*)&dict->ctx);
+}
+
+/**
+ * Reentrant version of lk_dict_lookup_view: all temporary data is kept in
+ *  the lookup context, so threads with different contexts can call it for
+ *  the same dictionary at the same time
+ *
+ * @sa lk_dict_lookup_view
+ * @sa lk_lookup_ctx_init
+ */
+lk_result lk_dict_lookup_view_r(const struct lk_dictionary *dict, const char *word,
+        const char **suggestions, size_t *count, struct lk_lookup_ctx *ctx) {
+    if (word == NULL || ctx == NULL || count == NULL || !lk_is_dict_valid(dict)
+        || (suggestions == NULL && *count != 0))
+        return LK_INVALID_ARG;
+
+    return lookup_view(dict, word, strlen(word), suggestions, count, ctx);
+}
+
+/**
+ * Length-delimited version of lk_dict_lookup_view: the word is len bytes
+ *  long and does not have to end with zero
+ *
+ * @sa lk_dict_lookup_view
+ */
+lk_result lk_dict_lookup_view_n(const struct lk_dictionary *dict, const char *word, size_t len,
+        const char **suggestions, size_t *count) {
+    if (word == NULL || count == NULL || !lk_is_dict_valid(dict)
+        || (suggestions == NULL && *count != 0))
+        return LK_INVALID_ARG;
+
+    return lookup_view(dict, word, len, suggestions, count, (struct lk_lookup_ctx*)&dict->ctx);
+}
+
+/**
+ * Enables the cache of recent lookup results in the context. Text has many
+ *  repeated words, so lk_dict_lookup_view_r and lk_dict_exact_lookup_r
+ *  return the result of a word that was checked recently without looking
+ *  it up again. When the cache is full the least recently used word is
+ *  dropped. The cache is cleared when the context is used with another
+ *  dictionary or when words are added to the dictionary
+ *
+ * @param[in] ctx is the context to change
+ * @param[in] entries is the maximum number of cached words. 0 disables the
+ *  cache
+ *
+ * @return the result of operation:
+ *  LK_OK - the cache was changed. Cached words and counters are reset
+ *  LK_INVALID_ARG - ctx is NULL or entries is too big
+ *  LK_OUT_OF_MEMORY - failed to allocate memory, the cache is disabled
+ *
+ * @sa lk_lookup_ctx_cache_stats
+ * @sa lk_dict_set_cache
+ */
+lk_result lk_lookup_ctx_set_cache(struct lk_lookup_ctx *ctx, size_t entries) {
+    if (ctx == NULL)
+        return LK_INVALID_ARG;
+
+    lk_cache_free(&ctx->cache);
+    if (entries == 0)
+        return LK_OK;
+    return lk_cache_init(&ctx->cache, entries);
+}
+
+/**
+ * Fills the usage counters of the context cache. All values are 0 if the
+ *  cache is disabled
+ *
+ * @sa lk_lookup_ctx_set_cache
+ */
+lk_result lk_lookup_ctx_cache_stats(const struct lk_lookup_ctx *ctx, struct lk_cache_stats *stats) {
+    if (ctx == NULL || stats == NULL)
+        return LK_INVALID_ARG;
+
+    stats->hits = ctx->cache.hits;
+    stats->misses = ctx->cache.misses;
+    stats->entries = ctx->cache.used;
+    stats->capacity = ctx->cache.cap;
+    return LK_OK;
+}
+
+/**
+ * Enables the cache of recent lookup results for lookup functions without
+ *  _r suffix, see lk_lookup_ctx_set_cache
+ *
+ * @sa lk_dict_cache_stats
+ */
+lk_result lk_dict_set_cache(struct lk_dictionary *dict, size_t entries) {
+    if (dict == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_lookup_ctx_set_cache(&dict->ctx, entries);
+}
+
+/**
+ * Fills the usage counters of the cache used by lookup functions without
+ *  _r suffix
+ *
+ * @sa lk_dict_set_cache
+ */
+lk_result lk_dict_cache_stats(const struct lk_dictionary *dict, struct lk_cache_stats *stats) {
+    if (dict == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_lookup_ctx_cache_stats(&dict->ctx, stats);
 }
 
 /**
@@ -232,141 +858,614 @@ void lk_exact_lookup_free(char** lookup) {
     free(lookup);
 }
 
-static lk_result dict_add_word(struct lk_dictionary* dict, const struct lk_word *word) {
-    if (!lk_is_dict_valid(dict) || word == NULL)
-        return LK_INVALID_ARG;
+/* makes room for n words in the batch buffers of the context */
+static lk_result reserve_batch(struct lk_lookup_ctx *ctx, size_t n) {
+    if (n <= ctx->batch_cap)
+        return LK_OK;
 
-    if (dict->head == NULL) {
-        dict->head = (struct lk_word*)word;
-        dict->tail = (struct lk_word*)word;
-    } else {
-        dict->tail->next = (struct lk_word*)word;
-        dict->tail = (struct lk_word*)word;
+    struct lk_batch_key *keys = (struct lk_batch_key*)realloc(ctx->keys, n * sizeof(*keys));
+    if (keys == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->keys = keys;
+    keys = (struct lk_batch_key*)realloc(ctx->sorted, n * sizeof(*keys));
+    if (keys == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->sorted = keys;
+    struct lk_batch_word *batch = (struct lk_batch_word*)realloc(ctx->batch, n * sizeof(*batch));
+    if (batch == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->batch = batch;
+    const char **paths = (const char**)realloc((void*)ctx->paths, n * sizeof(*paths));
+    if (paths == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->paths = paths;
+    struct lk_tree_pos *pos = (struct lk_tree_pos*)realloc(ctx->pos, n * sizeof(*pos));
+    if (pos == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->pos = pos;
+    size_t *retry = (size_t*)realloc(ctx->retry, n * sizeof(*retry));
+    if (retry == NULL)
+        return LK_OUT_OF_MEMORY;
+    ctx->retry = retry;
+    ctx->batch_cap = n;
+    return LK_OK;
+}
+
+/* copies a form to the batch text and sets off to its offset. off is
+ * LK_NO_TEXT if the form was not built */
+static lk_result add_batch_text(struct lk_lookup_ctx *ctx, const struct lk_forms *forms,
+        lk_form kind, size_t *off) {
+    *off = LK_NO_TEXT;
+    if ((forms->valid & LK_FORM_BIT(kind)) == 0)
+        return LK_OK;
+
+    const char *form = forms->form[kind];
+    size_t len = strlen(form) + 1;
+    if (ctx->text_size + len > ctx->text_cap) {
+        size_t cap = ctx->text_cap < 4096 ? 4096 : ctx->text_cap * 2;
+        while (cap < ctx->text_size + len)
+            cap *= 2;
+        char *text = (char*)realloc(ctx->text, cap);
+        if (text == NULL)
+            return LK_OUT_OF_MEMORY;
+        ctx->text = text;
+        ctx->text_cap = cap;
     }
+
+    memcpy(ctx->text + ctx->text_size, form, len);
+    *off = ctx->text_size;
+    ctx->text_size += len;
     return LK_OK;
 }
 
-static const char* skip_spaces(const char *s) {
-    if (s == NULL)
-        return s;
-    while (*s == ' ')
-        s++;
-    return s;
+static void set_batch_key(struct lk_batch_key *bk, const char *key, size_t word) {
+    unsigned long long prefix = 0;
+    const char *c = key;
+    for (size_t pos = 0; pos < 8; pos++) {
+        prefix <<= 8;
+        if (*c != '\0')
+            prefix |= (unsigned char)*c++;
+    }
+
+    bk->prefix = prefix;
+    bk->key = key;
+    bk->word = word;
+}
+
+static int cmp_batch_key(const struct lk_batch_key *a, const struct lk_batch_key *b) {
+    if (a->prefix != b->prefix)
+        return (a->prefix < b->prefix) ? -1 : 1;
+    /* the keys are equal if the prefix ends with NUL */
+    if ((a->prefix & 0xFF) == 0)
+        return 0;
+    return strcmp(a->key + 8, b->key + 8);
+}
+
+/* qsort callback for keys with the same prefix: equal keys are ordered by
+ * their index in the batch to keep the sort stable */
+static int cmp_batch_key_stable(const void *a, const void *b) {
+    const struct lk_batch_key *ka = a, *kb = b;
+    int r = cmp_batch_key(ka, kb);
+    if (r != 0)
+        return r;
+    return (ka->word < kb->word) ? -1 : (ka->word > kb->word);
 }
 
-static void free_word(struct lk_word* word) {
-    if (word == NULL)
+/* sorts the batch keys by their prefixes with a radix sort and then sorts
+ * every group of keys with the same prefix by the rest of the key. The sort
+ * is stable, so the first of equal keys is the first of them in the batch */
+static void sort_batch_keys(struct lk_lookup_ctx *ctx, size_t cnt) {
+    if (cnt < 2)
         return;
-    if (word->word)
-        free(word->word);
-    free(word);
+
+    size_t count[256];
+    for (int shift = 0; shift < 64; shift += 8) {
+        memset(count, 0, sizeof(count));
+        for (size_t idx = 0; idx < cnt; idx++)
+            count[(ctx->keys[idx].prefix >> shift) & 0xFF]++;
+        /* all keys have the same byte */
+        if (count[(ctx->keys[0].prefix >> shift) & 0xFF] == cnt)
+            continue;
+
+        size_t sum = 0;
+        for (size_t b = 0; b < 256; b++) {
+            size_t c = count[b];
+            count[b] = sum;
+            sum += c;
+        }
+        for (size_t idx = 0; idx < cnt; idx++)
+            ctx->sorted[count[(ctx->keys[idx].prefix >> shift) & 0xFF]++] = ctx->keys[idx];
+
+        struct lk_batch_key *tmp = ctx->keys;
+        ctx->keys = ctx->sorted;
+        ctx->sorted = tmp;
+    }
+
+    /* only long keys with the same prefix are out of order. Keys with a
+     * prefix ending with NUL are equal and already in batch order */
+    size_t first = 0;
+    while (first < cnt) {
+        size_t last = first + 1;
+        while (last < cnt && ctx->keys[last].prefix == ctx->keys[first].prefix)
+            last++;
+        if (last - first > 1 && (ctx->keys[first].prefix & 0xFF) != 0)
+            qsort(ctx->keys + first, last - first, sizeof(struct lk_batch_key),
+                    cmp_batch_key_stable);
+        first = last;
+    }
 }
 
-static lk_result add_without_stop(struct lk_tree *tree, const char *word, const struct lk_word *base) {
-    static char gs[LK_MAX_WORD_LEN];
+/* sets the result of a batch word from the words found for it. Suggestions
+ * that do not fit the caller's array are only counted */
+static void set_batch_result(const struct lk_dictionary *dict, const struct lk_word_ptr *match,
+        const char *word, struct lk_lookup_result *res, const char **suggestions, size_t cap,
+        size_t *used) {
+    if (match == NULL) {
+        res->status = LK_WORD_NOT_FOUND;
+        return;
+    }
+    if (lk_suggestions_no(dict, match, word, strlen(word)) == 0) {
+        res->status = LK_EXACT_MATCH;
+        return;
+    }
 
-    lk_result res = lk_remove_glottal_stop(word, gs, LK_MAX_WORD_LEN);
-    if (res == LK_OK)
-        res = lk_tree_add_word(tree, gs, base);
+    res->status = LK_OK;
+    res->first = *used;
+    if (*used < cap)
+        res->count = list_suggestions(dict, match, suggestions + *used, cap - *used);
+    else
+        res->count = list_suggestions(dict, match, NULL, 0);
+    *used += res->count;
+}
 
-    return res;
+/**
+ * Checks many words at once. It gives the same answers as
+ *  lk_dict_exact_lookup for every word but it is faster for a whole
+ *  document: the words are sorted, so every distinct word is looked up
+ *  once, many words are walked in the tree at the same time to hide memory
+ *  latency, and nothing is allocated per word. The function uses buffers
+ *  of the dictionary, so it must not be called from different threads at
+ *  the same time, use lk_dict_lookup_batch_r instead.
+ *
+ * @param[in] dict is initialized dictionary to lookup
+ * @param[in] words is an array of n words to check
+ * @param[in] n is the number of words
+ * @param[out] results is an array of n items that receives the result of
+ *  every word in the same order:
+ *   LK_EXACT_MATCH - the word was found in the dictionary
+ *   LK_OK - the word has count suggestions starting from suggestions[first]
+ *   LK_WORD_NOT_FOUND - the dictionary does not contain the word or the
+ *    word is not a valid UTF8 string, as lk_dict_exact_lookup reports it
+ *   LK_INVALID_ARG - the word is NULL
+ * @param[out] suggestions receives suggestions of all words. Items point to
+ *  the dictionary strings, so they become invalid when words are added with
+ *  lk_parse_word or lk_read_dictionary and when the dictionary is closed.
+ *  It can be NULL if *sugg_count is 0
+ * @param[in,out] sugg_count is the number of items in suggestions. It
+ *  receives the number of suggestions of all words
+ *
+ * @return the result of operation:
+ *  LK_OK - all words were checked
+ *  LK_BUFFER_SMALL - all words were checked but suggestions did not fit the
+ *   array. Results are complete, suggestions are filled up to the array
+ *   size and sugg_count receives the required size
+ *  LK_OUT_OF_MEMORY - failed to allocate batch buffers
+ *  LK_INVALID_ARG - dict is not valid or any array is NULL
+ *
+ * @sa lk_dict_lookup_batch_r
+ * @sa lk_dict_exact_lookup
+ */
+lk_result lk_dict_lookup_batch(const struct lk_dictionary *dict, const char **words, size_t n,
+        struct lk_lookup_result *results, const char **suggestions, size_t *sugg_count) {
+    if (dict == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_dict_lookup_batch_r(dict, words, n, results, suggestions, sugg_count,
+            (struct lk_lookup_ctx*)&dict->ctx);
 }
 
-static lk_result generate_ascii_forms(struct lk_tree *tree, const char *word, const struct lk_word *base) {
-    static char buf[LK_MAX_WORD_LEN], tmp[LK_MAX_WORD_LEN];
+/**
+ * Reentrant version of lk_dict_lookup_batch: all temporary data is kept in
+ *  the lookup context, so threads with different contexts can call it for
+ *  the same dictionary at the same time. The context keeps the buffers of
+ *  the largest batch for the next calls
+ *
+ * @sa lk_dict_lookup_batch
+ * @sa lk_lookup_ctx_init
+ */
+lk_result lk_dict_lookup_batch_r(const struct lk_dictionary *dict, const char **words, size_t n,
+        struct lk_lookup_result *results, const char **suggestions, size_t *sugg_count,
+        struct lk_lookup_ctx *ctx) {
+    if (!lk_is_dict_valid(dict) || ctx == NULL || sugg_count == NULL
+        || (n != 0 && (words == NULL || results == NULL))
+        || (suggestions == NULL && *sugg_count != 0))
+        return LK_INVALID_ARG;
 
-    int has_stop = lk_has_glottal_stop(word);
-    int vcnt = lk_stressed_vowels_no(word);
-    /* add low case form */
-    lk_result res = lk_to_low_case(word, tmp, LK_MAX_WORD_LEN);
-    if (res != LK_OK)
-        return res;
-    if (strcmp(tmp, word) != 0) {
-        res = lk_tree_add_word(tree, tmp, base);
-        if (res != LK_OK)
-            return res;
+    size_t cap = *sugg_count, used = 0;
+    if (reserve_batch(ctx, n) != LK_OK)
+        return LK_OUT_OF_MEMORY;
+
+    size_t key_cnt = 0;
+    for (size_t idx = 0; idx < n; idx++) {
+        results[idx].status = LK_WORD_NOT_FOUND;
+        results[idx].first = 0;
+        results[idx].count = 0;
+        if (words[idx] == NULL)
+            results[idx].status = LK_INVALID_ARG;
+        else
+            set_batch_key(&ctx->keys[key_cnt++], words[idx], idx);
     }
-    if (has_stop) {
-        res = add_without_stop(tree, tmp, base);
-        if (res != LK_OK)
-            return res;
+    sort_batch_keys(ctx, key_cnt);
+
+    /* build the forms of every distinct word */
+    struct lk_forms *forms = &ctx->forms;
+    unsigned int kinds = LK_FORM_BIT(LK_FORM_LOW) | LK_FORM_BIT(LK_FORM_DESTRESSED_LOW);
+    if (dict->index == LK_INDEX_FOLDED)
+        kinds |= LK_FORM_BIT(LK_FORM_ASCII_NO_STOP);
+    size_t batch_cnt = 0;
+    ctx->text_size = 0;
+    for (size_t idx = 0; idx < key_cnt; idx++) {
+        if (idx > 0 && cmp_batch_key(&ctx->keys[idx - 1], &ctx->keys[idx]) == 0)
+            continue;
+
+        size_t word = ctx->keys[idx].word;
+        if (lk_normalize_forms(words[word], kinds, forms) != LK_OK)
+            continue;
+
+        struct lk_batch_word *bw = &ctx->batch[batch_cnt++];
+        bw->word = word;
+        bw->stress = 0;
+        if (forms->stressed > 0)
+            bw->stress = (forms->valid & LK_FORM_BIT(LK_FORM_DESTRESSED)) ? 1 : -1;
+        if (add_batch_text(ctx, forms, LK_FORM_LOW, &bw->low) != LK_OK
+            || add_batch_text(ctx, forms, LK_FORM_DESTRESSED_LOW, &bw->dlow) != LK_OK
+            || add_batch_text(ctx, forms, LK_FORM_DESTRESSED, &bw->dword) != LK_OK)
+            return LK_OUT_OF_MEMORY;
+
+        bw->key = bw->low;
+        if (dict->index == LK_INDEX_FOLDED && bw->low != LK_NO_TEXT
+            && folded_key(forms) != forms->form[LK_FORM_LOW]
+            && add_batch_text(ctx, forms, LK_FORM_ASCII_NO_STOP, &bw->key) != LK_OK)
+            return LK_OUT_OF_MEMORY;
+    }
+
+    /* look up the words as they are */
+    size_t path_cnt = 0;
+    for (size_t idx = 0; idx < batch_cnt; idx++) {
+        if (ctx->batch[idx].key != LK_NO_TEXT)
+            ctx->paths[path_cnt++] = ctx->text + ctx->batch[idx].key;
     }
-    if (lk_is_ascii(word) && !has_stop)
+    lk_tree_walk_many(dict->tree, ctx->paths, path_cnt, ctx->pos);
+
+    size_t retry_cnt = 0;
+    path_cnt = 0;
+    for (size_t idx = 0; idx < batch_cnt; idx++) {
+        const struct lk_batch_word *bw = &ctx->batch[idx];
+        struct lk_lookup_result *res = &results[bw->word];
+        const struct lk_tree_pos *pos = NULL;
+        const struct lk_word_ptr *match = NULL;
+        if (bw->key != LK_NO_TEXT) {
+            pos = &ctx->pos[path_cnt++];
+            match = words_at_pos(dict, pos, ctx->text + bw->low, ctx);
+        }
+        if (match != NULL || bw->stress == 0) {
+            set_batch_result(dict, match, words[bw->word], res, suggestions, cap, &used);
+            continue;
+        }
+
+        /* invalid word stressing: look up the word without stress marks */
+        if (bw->stress < 0) {
+            res->status = LK_INVALID_STRING;
+            continue;
+        }
+        if (bw->dlow == LK_NO_TEXT)
+            continue;
+        if (dict->index == LK_INDEX_FOLDED) {
+            /* the folded key does not depend on stress marks */
+            if (pos != NULL)
+                match = words_at_pos(dict, pos, ctx->text + bw->dlow, ctx);
+            else
+                match = find_low_word(dict, ctx->text + bw->dlow, NULL, ctx);
+            set_batch_result(dict, match, ctx->text + bw->dword, res, suggestions, cap, &used);
+            continue;
+        }
+
+        /* the words before this one are checked, so their items of the
+         * buffers are reused for the second lookup */
+        ctx->retry[retry_cnt] = idx;
+        ctx->paths[retry_cnt++] = ctx->text + bw->dlow;
+    }
+
+    lk_tree_walk_many(dict->tree, ctx->paths, retry_cnt, ctx->pos);
+    for (size_t idx = 0; idx < retry_cnt; idx++) {
+        const struct lk_batch_word *bw = &ctx->batch[ctx->retry[idx]];
+        const struct lk_word_ptr *match = words_at_pos(dict, &ctx->pos[idx],
+                ctx->text + bw->dlow, ctx);
+        set_batch_result(dict, match, ctx->text + bw->dword, &results[bw->word],
+                suggestions, cap, &used);
+    }
+
+    /* equal words share the result and the suggestions */
+    for (size_t idx = 1; idx < key_cnt; idx++) {
+        if (cmp_batch_key(&ctx->keys[idx - 1], &ctx->keys[idx]) == 0)
+            results[ctx->keys[idx].word] = results[ctx->keys[idx - 1].word];
+    }
+
+    *sugg_count = used;
+    return (used > cap) ? LK_BUFFER_SMALL : LK_OK;
+}
+
+/* makes room for one more word record and len bytes of strings */
+static lk_result reserve_word(struct lk_dictionary *dict, size_t len) {
+    /* offsets of words are 32-bit */
+    if (dict->strings_size + len > 0xFFFFFFFFu)
+        return LK_OUT_OF_MEMORY;
+    if (dict->strings_size + len > dict->strings_cap) {
+        size_t cap = dict->strings_cap == 0 ? 65536 : dict->strings_cap * 2;
+        while (cap < dict->strings_size + len)
+            cap *= 2;
+        char *strings = (char*)realloc(dict->strings, cap);
+        if (strings == NULL)
+            return LK_OUT_OF_MEMORY;
+        dict->strings = strings;
+        dict->strings_cap = cap;
+    }
+
+    size_t chunk = dict->word_cnt >> LK_WORD_CHUNK_BITS;
+    if ((dict->word_cnt & (LK_WORD_CHUNK - 1)) != 0)
         return LK_OK;
+    if (dict->word_cnt >= LK_NO_BASE)
+        return LK_OUT_OF_MEMORY;
+    if (chunk == dict->chunk_cap) {
+        size_t cap = dict->chunk_cap == 0 ? 16 : dict->chunk_cap * 2;
+        struct lk_word **chunks = (struct lk_word**)realloc(dict->chunks, cap * sizeof(*chunks));
+        if (chunks == NULL)
+            return LK_OUT_OF_MEMORY;
+        dict->chunks = chunks;
+        dict->chunk_cap = cap;
+    }
+    dict->chunks[chunk] = (struct lk_word*)malloc(LK_WORD_CHUNK * sizeof(struct lk_word));
+    if (dict->chunks[chunk] == NULL)
+        return LK_OUT_OF_MEMORY;
+
+    return LK_OK;
+}
 
-    if (vcnt > 0) {
-        /* add a form without any stressed vowel */
-        res = lk_destress(tmp, buf, LK_MAX_WORD_LEN);
-        if (res == LK_OK && strcmp(buf, tmp) != 0) {
-            res = lk_tree_add_word(tree, buf, base);
-            if (res == LK_OK && has_stop)
-                res = add_without_stop(tree, buf, base);
+/* FNV-1a hash of a word form */
+static size_t hash_str(const char *word, size_t len) {
+    size_t h = 2166136261u;
+    for (size_t idx = 0; idx < len; idx++)
+        h = (h ^ (unsigned char)word[idx]) * 16777619u;
+    return h;
+}
+
+/* doubles the string index, so it is never more than half full */
+static lk_result grow_str_index(struct lk_dictionary *dict) {
+    size_t cap = dict->str_index_cap == 0 ? 4096 : dict->str_index_cap * 2;
+    unsigned int *index = (unsigned int*)malloc(cap * sizeof(*index));
+    if (index == NULL)
+        return LK_OUT_OF_MEMORY;
+
+    memset(index, 0xFF, cap * sizeof(*index));
+    for (size_t idx = 0; idx < dict->str_index_cap; idx++) {
+        unsigned int str = dict->str_index[idx];
+        if (str == LK_NO_STR)
+            continue;
+        const char *form = dict->strings + str;
+        size_t slot = hash_str(form, strlen(form)) & (cap - 1);
+        while (index[slot] != LK_NO_STR)
+            slot = (slot + 1) & (cap - 1);
+        index[slot] = str;
+    }
+
+    free(dict->str_index);
+    dict->str_index = index;
+    dict->str_index_cap = cap;
+    return LK_OK;
+}
+
+/* returns the offset of the form in the string pool. A new form is
+ * appended, the room for it must be reserved */
+static unsigned int dict_add_str(struct lk_dictionary *dict, const char *word, size_t len) {
+    size_t mask = dict->str_index_cap - 1;
+    size_t slot = hash_str(word, len) & mask;
+    for (; dict->str_index[slot] != LK_NO_STR; slot = (slot + 1) & mask) {
+        const char *form = dict->strings + dict->str_index[slot];
+        if (strncmp(form, word, len) == 0 && form[len] == '\0')
+            return dict->str_index[slot];
+    }
+
+    unsigned int str = (unsigned int)dict->strings_size;
+    memcpy(dict->strings + dict->strings_size, word, len);
+    dict->strings[dict->strings_size + len] = '\0';
+    dict->strings_size += len + 1;
+    dict->str_index[slot] = str;
+    dict->str_cnt++;
+    return str;
+}
+
+/* appends a word form of len bytes to the dictionary */
+static struct lk_word* dict_add_word(struct lk_dictionary *dict, const char *word, size_t len,
+        unsigned int base) {
+    if ((dict->str_cnt + 1) * 2 > dict->str_index_cap && grow_str_index(dict) != LK_OK)
+        return NULL;
+    if (reserve_word(dict, len + 1) != LK_OK)
+        return NULL;
+
+    size_t idx = dict->word_cnt++;
+    struct lk_word *out = &dict->chunks[idx >> LK_WORD_CHUNK_BITS][idx & (LK_WORD_CHUNK - 1)];
+    out->str = dict_add_str(dict, word, len);
+    out->base = base;
+    out->forms = 0;
+    if (base == LK_NO_BASE)
+        dict->base_cnt++;
+
+    return out;
+}
+
+/* frees all word records and strings of a dictionary loaded from text */
+static void free_words(struct lk_dictionary *dict) {
+    size_t chunks = (dict->word_cnt + LK_WORD_CHUNK - 1) >> LK_WORD_CHUNK_BITS;
+    for (size_t idx = 0; idx < chunks; idx++)
+        free(dict->chunks[idx]);
+    free(dict->chunks);
+    free(dict->strings);
+    free(dict->str_index);
+    dict->chunks = NULL;
+    dict->chunk_cap = 0;
+    dict->strings = NULL;
+    dict->strings_size = 0;
+    dict->strings_cap = 0;
+    dict->str_index = NULL;
+    dict->str_index_cap = 0;
+    dict->str_cnt = 0;
+    dict->word_cnt = 0;
+    dict->base_cnt = 0;
+}
+
+static const char* skip_spaces(const char *s) {
+    if (s == NULL)
+        return s;
+    while (*s == ' ')
+        s++;
+    return s;
+}
+
+/**
+ * @struct lk_key
+ * A lookup key generated while parsing a word article
+ */
+struct lk_key {
+    size_t offset; /*!< position of the key in lk_key_run pool */
+    size_t word; /*!< index of the word to add to the tree in the
+                   dictionary of the chunk */
+    utf8proc_int32_t first; /*!< the first character, -1 if the key is not
+                              added to the tree */
+    int part; /*!< the tree that the key is added to by the parallel loader */
+};
+
+/**
+ * @struct lk_key_run
+ * All lookup keys generated for a chunk of dictionary in the order they are
+ *  added to the tree by the sequential loader
+ */
+struct lk_key_run {
+    struct lk_key *keys;
+    size_t cnt; /*!< number of items in keys */
+    size_t cap; /*!< capacity of keys */
+    char *pool; /*!< NUL-terminated keys */
+    size_t pool_len; /*!< number of used bytes in pool */
+    size_t pool_cap; /*!< size of pool */
+};
+
+static lk_result run_add_key(struct lk_key_run *run, const char *key, size_t word) {
+    if (*key == '\0')
+        return LK_OK;
+
+    /* check the key the same way lk_tree_add_word does, so loading stops at
+     * the same place as sequential loading */
+    lk_result res = LK_OK;
+    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)key;
+    utf8proc_int32_t cp, first = -1;
+    while (*usrc) {
+        size_t len = lk_utf8_decode(usrc, -1, &cp);
+        if (cp == -1) {
+            res = LK_INVALID_STRING;
+            break;
         }
+        if (first == -1)
+            first = cp;
+        usrc += len;
+    }
 
-        if (res != LK_OK)
-            return res;
-    } else {
-        strcpy(buf, tmp);
+    size_t len = strlen(key) + 1;
+    if (run->cnt == run->cap) {
+        size_t cap = run->cap == 0 ? 1024 : run->cap * 2;
+        struct lk_key *keys = (struct lk_key*)realloc(run->keys, cap * sizeof(*keys));
+        if (keys == NULL)
+            return LK_OUT_OF_MEMORY;
+        run->keys = keys;
+        run->cap = cap;
+    }
+    if (run->pool_len + len > run->pool_cap) {
+        size_t cap = run->pool_cap == 0 ? 16384 : run->pool_cap * 2;
+        while (cap < run->pool_len + len)
+            cap *= 2;
+        char *pool = (char*)realloc(run->pool, cap);
+        if (pool == NULL)
+            return LK_OUT_OF_MEMORY;
+        run->pool = pool;
+        run->pool_cap = cap;
     }
 
-    lk_to_ascii(buf, tmp, LK_MAX_WORD_LEN);
-    if (strcmp(buf, tmp) != 0) {
-        res = lk_tree_add_word(tree, tmp, base);
-        if (res == LK_OK && has_stop)
-            res = add_without_stop(tree, tmp, base);
+    struct lk_key *k = &run->keys[run->cnt++];
+    k->offset = run->pool_len;
+    k->word = word;
+    k->first = first;
+    k->part = -1;
+    memcpy(run->pool + run->pool_len, key, len);
+    run->pool_len += len;
 
-        if (res != LK_OK)
-            return res;
-    }
-
-    char *aph = strchr(tmp, '\'');
-    if (aph == NULL)
-        return LK_OK;
+    return res;
+}
 
-    /* replace aphostrophes with tildes */
-    while (aph != NULL) {
-        *aph = '`';
-        aph = strchr(aph, '\'');
-    }
+static lk_result dict_add_key(struct lk_dictionary *dict, const char *key, const struct lk_word *word) {
+    /* keys are always generated for the last added word */
+    if (dict->run != NULL)
+        return run_add_key(dict->run, key, dict->word_cnt - 1);
 
-    return lk_tree_add_word(tree, tmp, base);
+    return lk_tree_add_word(dict->tree, key, word);
 }
 
-static lk_result add_word_ascii_forms(struct lk_tree *tree, const struct lk_word *base) {
-    /* add the word */
-    const char *base_word = base->word;
-    lk_result res = lk_tree_add_word(tree, base_word, base);
-    if (res == LK_OK)
-        res = generate_ascii_forms(tree, base_word, base);
+/* adds all forms of the word that differ from the word itself */
+static lk_result generate_forms(struct lk_dictionary *dict, const struct lk_word *base) {
+    struct lk_forms forms;
+
+    lk_result res = lk_normalize_forms(word_str(dict, base), LK_FORMS_DICT, &forms);
+    if (res != LK_OK)
+        return res;
+    if ((forms.valid & LK_FORM_BIT(LK_FORM_LOW)) == 0)
+        return LK_BUFFER_SMALL;
+
+    for (int f = LK_FORM_LOW; f <= LK_FORM_ASCII_GRAVE && res == LK_OK; f++) {
+        if (forms.distinct & LK_FORM_BIT(f))
+            res = dict_add_key(dict, forms.form[f], base);
+    }
 
     return res;
 }
 
-static lk_result add_word_to_tree(struct lk_dictionary *dict, const struct lk_word *base) {
-    return add_word_ascii_forms(dict->tree, base);
+/* adds the only key of the word to LK_INDEX_FOLDED dictionary */
+static lk_result add_folded_key(struct lk_dictionary *dict, struct lk_word *word) {
+    struct lk_forms forms;
+
+    lk_result res = lk_normalize_forms(word_str(dict, word), LK_FORMS_DICT, &forms);
+    if (res != LK_OK)
+        return res;
+    const char *key = folded_key(&forms);
+    if (key == NULL)
+        return LK_BUFFER_SMALL;
+
+    word->forms = forms.distinct;
+    return dict_add_key(dict, key, word);
 }
 
 static lk_result add_all_forms_to_dict(struct lk_dictionary *dict, struct lk_word *word) {
-    lk_result res = lk_tree_add_word(dict->tree, word->word, word);
+    if (dict->index == LK_INDEX_FOLDED)
+        return add_folded_key(dict, word);
+
+    lk_result res = dict_add_key(dict, word_str(dict, word), word);
     if (res == LK_OK)
-        res = add_word_to_tree(dict, word);
+        res = generate_forms(dict, word);
 
     return res;
 }
 
 static struct lk_word* lk_add_form_as_is(struct lk_dictionary *dict, const char *word,
-       struct lk_word *base) {
-    struct lk_word *out = (struct lk_word*)calloc(1, sizeof(struct lk_word));
+       unsigned int base) {
+    struct lk_word *out = dict_add_word(dict, word, strlen(word), base);
     if (out == NULL)
         return NULL;
-    out->word = (char *)calloc(1, strlen(word) + 1);
-    if (out->word == NULL) {
-        free(out);
-        return NULL;
-    }
-    strcpy(out->word, word);
-    out->base = base;
-    dict_add_word(dict, out);
 
     lk_result res = add_all_forms_to_dict(dict, out);
     if (res != LK_OK)
@@ -376,12 +1475,13 @@ static struct lk_word* lk_add_form_as_is(struct lk_dictionary *dict, const char
 }
 
 static lk_result lk_iterate_forms(struct lk_dictionary *dict,
-        char *start, struct lk_word *base) {
+        char *start, unsigned int base) {
     const char *spc = skip_spaces(start);
-    static char buf[LK_MAX_WORD_LEN];
-    static char base_unstressed[LK_MAX_WORD_LEN];
+    char buf[LK_MAX_WORD_LEN];
+    char base_unstressed[LK_MAX_WORD_LEN];
 
-    lk_result res = lk_destress(base->word, base_unstressed, LK_MAX_WORD_LEN);
+    lk_result res = lk_destress(word_str(dict, word_at(dict, base)), base_unstressed,
+            LK_MAX_WORD_LEN);
     if (res != LK_OK)
         return res;
 
@@ -409,26 +1509,17 @@ static lk_result lk_iterate_forms(struct lk_dictionary *dict,
     return LK_OK;
 }
 
-static lk_result lk_read_base_form(struct lk_dictionary *dict, const char *s,
-        struct lk_word *base) {
+static lk_result lk_read_base_form(struct lk_dictionary *dict, const char *s) {
     char *start = strchr(s, ' ');
     size_t len = (start == NULL)? strlen(s) : start - s;
-    if (len == 0) {
-        free(base);
+    if (len == 0)
         return LK_INVALID_STRING;
-    }
-    base->word = (char*)calloc(len + 1, sizeof(char));
-    if (base->word == NULL) {
-        free(base);
-        return LK_OUT_OF_MEMORY;
-    }
-    strncpy(base->word, s, len);
 
-    lk_result res = dict_add_word(dict, base);
-    if (res == LK_OK)
-        res = add_all_forms_to_dict(dict, base);
+    struct lk_word *base = dict_add_word(dict, s, len, LK_NO_BASE);
+    if (base == NULL)
+        return LK_OUT_OF_MEMORY;
 
-    return res;
+    return add_all_forms_to_dict(dict, base);
 }
 
 /**
@@ -441,7 +1532,8 @@ static lk_result lk_read_base_form(struct lk_dictionary *dict, const char *s,
  *
  * @return the result of adding word to dictionary:
  *  LK_OK - the word was successfully added to the dictionary
- *  LK_INVALID_ARG - dictionary is not initialized or info is NULL
+ *  LK_INVALID_ARG - dictionary is not initialized or info is NULL, or the
+ *   dictionary is frozen
  *  LK_OUT_OF_MEMORY - failed to allocate memory
  *  LK_INVALID_STRING - info is not UTF8-encoded string or string does not
  *   have correct format
@@ -459,21 +1551,21 @@ static lk_result lk_read_base_form(struct lk_dictionary *dict, const char *s,
  * @sa lk_dict_init
  */
 lk_result lk_parse_word(const char *info, struct lk_dictionary* dict) {
-    if (!lk_is_dict_valid(dict) || info == NULL)
+    if (!lk_is_dict_valid(dict) || info == NULL || lk_tree_is_frozen(dict->tree))
         return LK_INVALID_ARG;
 
     if (*info == '#')
         return LK_COMMENT;
 
-    struct lk_word *base = (struct lk_word*)calloc(1, sizeof(struct lk_word));
-    if (base == NULL)
-        return LK_OUT_OF_MEMORY;
+    /* the word strings can move, so cached lookup results become invalid */
+    dict->generation = lk_unique_id();
 
     lk_result res;
     const char *spc = info;
 
     /* read the word base form */
-    res = lk_read_base_form(dict, spc, base);
+    unsigned int base = (unsigned int)dict->word_cnt;
+    res = lk_read_base_form(dict, spc);
     if (res != LK_OK)
         return res;
 
@@ -490,10 +1582,8 @@ lk_result lk_parse_word(const char *info, struct lk_dictionary* dict) {
 int lk_is_dict_valid(const struct lk_dictionary *dict) {
     if (dict == NULL)
         return 0;
-    if ((dict->head != NULL && dict->tail == NULL) ||
-        (dict->head == NULL && dict->tail != NULL)) {
+    if (dict->word_cnt != 0 && dict->strings == NULL)
         return 0;
-    }
     return 1;
 }
 
@@ -505,14 +1595,340 @@ size_t lk_word_count(const struct lk_dictionary *dict) {
     if (!lk_is_dict_valid(dict))
         return 0;
 
-    size_t cnt = 0;
-    struct lk_word *word = dict->head;
-    while (word != NULL) {
-        cnt++;
-        word = word->next;
+    return dict->word_cnt;
+}
+
+/**
+ * Selects what keys the dictionary adds to its lookup tree for every word
+ *  form. LK_INDEX_ALL_FORMS is the default. LK_INDEX_FOLDED adds only one
+ *  key per form: the form in low case without stress marks, diacritics and
+ *  glottal stops. Lookups fold the word the same way and then keep only the
+ *  forms that the word matches, so all lookup functions return the same
+ *  results in both modes while the tree has several times fewer nodes.
+ *  Lists returned by lk_dict_find_word_r for LK_INDEX_FOLDED dictionary are
+ *  kept in the lookup context and they are valid until the next lookup.
+ *  The mode must be set before the first word is added
+ *
+ * @param[in] dict is an empty dictionary
+ * @param[in] mode is the index mode
+ *
+ * @return the result of operation:
+ *  LK_OK - the mode was set
+ *  LK_INVALID_ARG - dictionary is not initialized or it is not empty,
+ *   frozen or opened with lk_dict_open_image, or the mode is unknown
+ */
+lk_result lk_dict_set_index_mode(struct lk_dictionary *dict, lk_index_mode mode) {
+    if (!lk_is_dict_valid(dict) || dict->word_cnt != 0 || dict->map.data != NULL
+        || lk_tree_is_frozen(dict->tree))
+        return LK_INVALID_ARG;
+    if (mode != LK_INDEX_ALL_FORMS && mode != LK_INDEX_FOLDED)
+        return LK_INVALID_ARG;
+
+    dict->index = mode;
+    return LK_OK;
+}
+
+/**
+ * Makes the dictionary read-only and compiles its suffix tree into a compact
+ *  double-array trie, so every lookup takes constant time per character.
+ *  Call it after all words are loaded: a frozen dictionary rejects new words
+ *  with LK_INVALID_ARG. Lists returned by lk_dict_find_word before freezing
+ *  become invalid
+ *
+ * @return the result of operation:
+ *  LK_OK - the dictionary was frozen or it had been frozen before
+ *  LK_INVALID_ARG - dictionary is not initialized
+ *  LK_OUT_OF_MEMORY - failed to allocate memory. The dictionary is still
+ *   usable and it is not frozen
+ *
+ * @sa lk_read_dictionary
+ */
+lk_result lk_dict_freeze(struct lk_dictionary *dict) {
+    if (!lk_is_dict_valid(dict))
+        return LK_INVALID_ARG;
+
+    return lk_tree_freeze(dict->tree);
+}
+
+/**
+ * Makes the dictionary read-only and minimizes its suffix tree into a
+ *  directed acyclic word graph: word variants that have the same ending and
+ *  point to the same words share the tree nodes. Lookup results do not
+ *  change but the tree takes several times less memory. It is an alternative
+ *  to lk_dict_freeze: a minimized dictionary can be frozen but the double
+ *  array expands all shared nodes back, so it does not save memory.
+ *  Lists returned by lk_dict_find_word before minimizing become invalid
+ *
+ * @return the result of operation:
+ *  LK_OK - the dictionary was minimized or it had been minimized before
+ *  LK_INVALID_ARG - dictionary is not initialized or it is frozen
+ *  LK_OUT_OF_MEMORY - failed to allocate memory. The dictionary is still
+ *   usable and it is not minimized
+ *
+ * @sa lk_dict_freeze
+ */
+lk_result lk_dict_minimize(struct lk_dictionary *dict) {
+    if (!lk_is_dict_valid(dict))
+        return LK_INVALID_ARG;
+
+    return lk_tree_minimize(dict->tree);
+}
+
+/**
+ * Fills the structure with the dictionary size information
+ *
+ * @return LK_INVALID_ARG if dictionary is not initialized or stats is NULL
+ *  and LK_OK otherwise
+ */
+lk_result lk_dict_get_stats(const struct lk_dictionary *dict, struct lk_dict_stats *stats) {
+    if (!lk_is_dict_valid(dict) || stats == NULL)
+        return LK_INVALID_ARG;
+
+    struct lk_tree_stats tstats;
+    lk_result res = lk_tree_get_stats(dict->tree, &tstats);
+    if (res != LK_OK)
+        return res;
+
+    stats->words = dict->word_cnt;
+    stats->bases = dict->base_cnt;
+    stats->keys = tstats.keys;
+    stats->nodes = tstats.nodes;
+    stats->tree_memory = tstats.memory;
+    return LK_OK;
+}
+
+/**
+ * @struct lk_id_chunk
+ * Maps word pointers to their indices while saving an image: chunks of word
+ *  records sorted by address
+ */
+struct lk_id_chunk {
+    const struct lk_word *words; /*!< the first record of the chunk */
+    size_t first; /*!< index of the first record */
+};
+
+static int cmp_id_chunk(const void *a, const void *b) {
+    const struct lk_word *wa = ((const struct lk_id_chunk*)a)->words;
+    const struct lk_word *wb = ((const struct lk_id_chunk*)b)->words;
+    return (wa > wb) - (wa < wb);
+}
+
+/**
+ * @struct lk_id_table
+ * All chunks of word records sorted with cmp_id_chunk
+ */
+struct lk_id_table {
+    struct lk_id_chunk *chunks;
+    size_t cnt;
+};
+
+static unsigned int id_of_word(const struct lk_word *word, void *arg) {
+    const struct lk_id_table *t = (const struct lk_id_table*)arg;
+    const struct lk_id_chunk *chunks = t->chunks;
+    size_t lo = 0, hi = t->cnt;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (chunks[mid].words <= word)
+            lo = mid;
+        else
+            hi = mid;
     }
+    return (unsigned int)(chunks[lo].first + (size_t)(word - chunks[lo].words));
+}
 
-    return cnt;
+static lk_result write_padding(FILE *fh, unsigned long long *pos) {
+    static const char zeroes[8] = {0};
+    size_t pad = (size_t)((8 - *pos % 8) % 8);
+    if (pad != 0 && fwrite(zeroes, 1, pad, fh) != pad)
+        return LK_FILE_WRITE_ERR;
+    *pos += pad;
+    return LK_OK;
+}
+
+static lk_result write_words(const struct lk_dictionary *dict, FILE *fh,
+        struct lk_id_table *t, struct lk_image_header *hdr) {
+    unsigned long long pos = sizeof(*hdr);
+
+    /* strings */
+    hdr->strings_offset = pos;
+    hdr->strings_size = dict->strings_size;
+    if (dict->strings_size != 0
+        && fwrite(dict->strings, 1, dict->strings_size, fh) != dict->strings_size)
+        return LK_FILE_WRITE_ERR;
+    pos += dict->strings_size;
+    if (write_padding(fh, &pos) != LK_OK)
+        return LK_FILE_WRITE_ERR;
+
+    /* words table */
+    hdr->words_offset = pos;
+    hdr->words = (unsigned int)dict->word_cnt;
+    hdr->bases = (unsigned int)dict->base_cnt;
+    for (size_t c = 0; c < t->cnt; c++) {
+        size_t cnt = dict->word_cnt - c * LK_WORD_CHUNK;
+        if (cnt > LK_WORD_CHUNK)
+            cnt = LK_WORD_CHUNK;
+        if (fwrite(dict->chunks[c], sizeof(struct lk_word), cnt, fh) != cnt)
+            return LK_FILE_WRITE_ERR;
+        pos += cnt * sizeof(struct lk_word);
+    }
+    if (write_padding(fh, &pos) != LK_OK)
+        return LK_FILE_WRITE_ERR;
+
+    /* trie */
+    qsort(t->chunks, t->cnt, sizeof(*t->chunks), cmp_id_chunk);
+    size_t trie_size;
+    hdr->trie_offset = pos;
+    lk_result res = lk_tree_save(dict->tree, fh, id_of_word, t, &trie_size);
+    hdr->trie_size = trie_size;
+    return res;
+}
+
+/**
+ * Writes the dictionary to a binary image that can be opened later with
+ *  lk_dict_open_image much faster than the text dictionary is read. The
+ *  dictionary is frozen before writing, so it becomes read-only. Images are
+ *  not portable between machines with different byte order
+ *
+ * @param[in] dict is a dictionary to write
+ * @param[in] path is a path to the image file. The file is overwritten
+ *
+ * @return the result of operation:
+ *  LK_OK - the image was written successfully
+ *  LK_INVALID_ARG - dictionary is not initialized or path is NULL
+ *  LK_INVALID_FILE - failed to create the file
+ *  LK_FILE_WRITE_ERR - failed to write the file
+ *  LK_OUT_OF_MEMORY - failed to allocate memory
+ *
+ * @sa lk_dict_open_image
+ * @sa lk_dict_freeze
+ */
+lk_result lk_dict_save_image(struct lk_dictionary *dict, const char *path) {
+    if (!lk_is_dict_valid(dict) || path == NULL)
+        return LK_INVALID_ARG;
+
+    lk_result res = lk_dict_freeze(dict);
+    if (res != LK_OK)
+        return res;
+
+#ifdef _WIN32
+    int bufsz = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+    wchar_t *wpath = (wchar_t*)malloc((bufsz + 1) * sizeof(wchar_t));
+    if (wpath == NULL)
+        return LK_OUT_OF_MEMORY;
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, bufsz);
+    FILE *fh = _wfopen(wpath, L"wb");
+    free(wpath);
+#else
+    FILE *fh = fopen(path, "wb");
+#endif
+    if (fh == NULL)
+        return LK_INVALID_FILE;
+
+    if (dict->map.data != NULL) {
+        /* the dictionary is an image itself */
+        res = (fwrite(dict->map.data, 1, dict->map.size, fh) == dict->map.size) ?
+            LK_OK : LK_FILE_WRITE_ERR;
+        if (fclose(fh) != 0 && res == LK_OK)
+            res = LK_FILE_WRITE_ERR;
+        return res;
+    }
+
+    struct lk_id_table t;
+    t.cnt = (dict->word_cnt + LK_WORD_CHUNK - 1) >> LK_WORD_CHUNK_BITS;
+    t.chunks = (struct lk_id_chunk*)malloc((t.cnt + 1) * sizeof(*t.chunks));
+    for (size_t c = 0; t.chunks != NULL && c < t.cnt; c++) {
+        t.chunks[c].words = dict->chunks[c];
+        t.chunks[c].first = c * LK_WORD_CHUNK;
+    }
+
+    struct lk_image_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (t.chunks == NULL)
+        res = LK_OUT_OF_MEMORY;
+    /* the header is written twice: the first one reserves space */
+    if (res == LK_OK && fwrite(&hdr, sizeof(hdr), 1, fh) != 1)
+        res = LK_FILE_WRITE_ERR;
+    if (res == LK_OK)
+        res = write_words(dict, fh, &t, &hdr);
+    if (res == LK_OK) {
+        hdr.magic = LK_IMAGE_MAGIC;
+        hdr.version = LK_IMAGE_VERSION;
+        hdr.byte_order = LK_IMAGE_BYTE_ORDER;
+        hdr.index = dict->index;
+        if (fseek(fh, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, fh) != 1)
+            res = LK_FILE_WRITE_ERR;
+    }
+
+    free(t.chunks);
+    if (fclose(fh) != 0 && res == LK_OK)
+        res = LK_FILE_WRITE_ERR;
+    if (res != LK_OK)
+        remove(path);
+
+    return res;
+}
+
+static int image_section_valid(const struct lk_map *map, unsigned long long offset,
+        unsigned long long size) {
+    return offset % 8 == 0 && offset <= map->size && size <= map->size - offset;
+}
+
+/**
+ * Opens a dictionary image written by lk_dict_save_image. The image is mapped
+ *  into memory read-only and it is used as is: nothing is parsed or copied,
+ *  so opening takes almost no time and processes that open the same image
+ *  share its memory. The dictionary is read-only: lk_parse_word fails with
+ *  LK_INVALID_ARG. Close it with lk_dict_close
+ *
+ * @param[in] path is a path to the image file
+ *
+ * @return NULL if the file cannot be opened or it is not a valid image,
+ *  or pointer to the dictionary
+ *
+ * @sa lk_dict_save_image
+ * @sa lk_dict_close
+ */
+struct lk_dictionary* lk_dict_open_image(const char *path) {
+    struct lk_dictionary *dict = lk_dict_init();
+    if (dict == NULL)
+        return NULL;
+
+    if (lk_map_open(&dict->map, path) != LK_OK) {
+        lk_dict_close(dict);
+        return NULL;
+    }
+
+    const struct lk_map *map = &dict->map;
+    const struct lk_image_header *hdr = (const struct lk_image_header*)map->data;
+    if (map->size < sizeof(*hdr) || hdr->magic != LK_IMAGE_MAGIC
+        || hdr->version != LK_IMAGE_VERSION || hdr->byte_order != LK_IMAGE_BYTE_ORDER
+        || hdr->index > LK_INDEX_FOLDED
+        || !image_section_valid(map, hdr->strings_offset, hdr->strings_size)
+        || !image_section_valid(map, hdr->words_offset,
+            (unsigned long long)hdr->words * sizeof(struct lk_word))
+        || !image_section_valid(map, hdr->trie_offset, hdr->trie_size)
+        || (hdr->strings_size != 0
+            && map->data[hdr->strings_offset + hdr->strings_size - 1] != '\0')) {
+        lk_dict_close(dict);
+        return NULL;
+    }
+
+    struct lk_tree *tree = lk_tree_open_image(map->data + hdr->trie_offset,
+            (size_t)hdr->trie_size);
+    if (tree == NULL) {
+        lk_dict_close(dict);
+        return NULL;
+    }
+
+    lk_tree_free(dict->tree);
+    dict->tree = tree;
+    dict->strings = (char*)map->data + hdr->strings_offset;
+    dict->strings_size = (size_t)hdr->strings_size;
+    dict->image_words = (const struct lk_word*)(map->data + hdr->words_offset);
+    dict->word_cnt = hdr->words;
+    dict->base_cnt = hdr->bases;
+    dict->index = (lk_index_mode)hdr->index;
+    return dict;
 }
 
 /**
@@ -533,6 +1949,7 @@ struct lk_dictionary* lk_dict_init() {
         free(dict);
         return NULL;
     }
+    dict->generation = lk_unique_id();
 
     return dict;
 }
@@ -548,13 +1965,10 @@ void lk_dict_close(struct lk_dictionary* dict) {
     if (dict->tree != NULL)
         lk_tree_free(dict->tree);
 
-    struct lk_word *wr = dict->head, *wr_next;
-    while (wr != NULL) {
-        wr_next = wr->next;
-        free_word(wr);
-        wr = wr_next;
-    }
-
+    if (dict->map.data == NULL)
+        free_words(dict);
+    lk_map_close(&dict->map);
+    free_ctx_buffers(&dict->ctx);
     free(dict);
 }
 
@@ -577,14 +1991,14 @@ void lk_dict_close(struct lk_dictionary* dict) {
  * @sa lk_parse_word
  */
 lk_result lk_read_dictionary(struct lk_dictionary *dict, const char *path) {
-    char buf[4096];
-    struct lk_file *file = lk_file_open(path);
+    struct lk_file *file = lk_file_open_ex(path, LK_FILE_MMAP);
     if (file == NULL)
         return LK_INVALID_FILE;
 
-    lk_result res = LK_OK, file_res = LK_OK;
-    while (file_res == LK_OK) {
-        file_res = lk_file_read(file, buf, 4096);
+    lk_result res = LK_OK;
+    for (;;) {
+        const char *line;
+        lk_result file_res = lk_file_read_line(file, &line, NULL);
         if (file_res == LK_EOF)
             break;
 
@@ -593,7 +2007,7 @@ lk_result lk_read_dictionary(struct lk_dictionary *dict, const char *path) {
             break;
         }
 
-        res = lk_parse_word(buf, dict);
+        res = lk_parse_word(line, dict);
         if (res != LK_OK)
             break;
     }
@@ -603,3 +2017,400 @@ lk_result lk_read_dictionary(struct lk_dictionary *dict, const char *path) {
     return res;
 }
 
+
+/**
+ * @struct lk_parse_job
+ * A chunk of dictionary lines parsed by one thread of the parallel loader
+ */
+struct lk_parse_job {
+    const char *lines; /*!< the first line, lines are separated with NUL */
+    size_t cnt; /*!< number of lines */
+    struct lk_dictionary part; /*!< words of the chunk, keys go to run */
+    struct lk_key_run run; /*!< lookup keys of the chunk */
+    size_t first_word; /*!< index of the first word of the chunk in
+                         the final dictionary */
+    lk_result res; /*!< the result of the first failed line or LK_OK */
+};
+
+/**
+ * @struct lk_tree_job
+ * A part of the tree built by one thread of the parallel loader: the paths
+ *  that start with the characters assigned to the part
+ */
+struct lk_tree_job {
+    const struct lk_dictionary *dict; /*!< the dictionary with all words */
+    const struct lk_parse_job *chunks;
+    size_t chunk_cnt;
+    int part; /*!< the index of the part */
+    struct lk_tree *tree;
+    lk_result res;
+};
+
+static void parse_chunk(void *arg) {
+    struct lk_parse_job *job = (struct lk_parse_job*)arg;
+    const char *line = job->lines;
+
+    job->res = LK_OK;
+    for (size_t idx = 0; idx < job->cnt; idx++) {
+        job->res = lk_parse_word(line, &job->part);
+        if (job->res != LK_OK)
+            break;
+        line += strlen(line) + 1;
+    }
+}
+
+static void build_tree_part(void *arg) {
+    struct lk_tree_job *job = (struct lk_tree_job*)arg;
+
+    job->res = LK_OK;
+    for (size_t c = 0; c < job->chunk_cnt; c++) {
+        const struct lk_key_run *run = &job->chunks[c].run;
+        size_t first = job->chunks[c].first_word;
+        for (size_t idx = 0; idx < run->cnt; idx++) {
+            const struct lk_key *k = &run->keys[idx];
+            if (k->part != job->part)
+                continue;
+            /* the last key of a failed chunk can be invalid, the tree
+             * keeps its valid beginning like in the sequential load */
+            const struct lk_word *word = word_at(job->dict, first + k->word);
+            if (lk_tree_add_word(job->tree, run->pool + k->offset, word) == LK_OUT_OF_MEMORY) {
+                job->res = LK_OUT_OF_MEMORY;
+                return;
+            }
+        }
+    }
+}
+
+/* runs fn for every job in its own thread. If a thread cannot be started
+ * the job runs in the calling thread */
+static void run_jobs(struct lk_thread *threads, lk_thread_func fn, char *jobs,
+        size_t job_size, size_t cnt) {
+    int *started = (int*)calloc(cnt, sizeof(*started));
+    for (size_t idx = 0; idx < cnt; idx++) {
+        void *job = jobs + idx * job_size;
+        if (started != NULL && lk_thread_start(&threads[idx], fn, job) == LK_OK)
+            started[idx] = 1;
+        else
+            fn(job);
+    }
+    for (size_t idx = 0; idx < cnt; idx++) {
+        if (started != NULL && started[idx])
+            lk_thread_join(&threads[idx]);
+    }
+    free(started);
+}
+
+/* reads all lines of the file the same way lk_read_dictionary does */
+static lk_result read_lines(const char *path, char **lines, size_t *size, size_t *cnt) {
+    *lines = NULL;
+    *size = 0;
+    *cnt = 0;
+    struct lk_file *file = lk_file_open_ex(path, LK_FILE_MMAP);
+    if (file == NULL)
+        return LK_INVALID_FILE;
+
+    size_t cap = 0;
+    lk_result res = LK_OK;
+    for (;;) {
+        const char *line;
+        size_t len;
+        lk_result file_res = lk_file_next_line_view(file, &line, &len);
+        if (file_res == LK_EOF)
+            break;
+        if (file_res != LK_OK) {
+            res = file_res;
+            break;
+        }
+
+        while (*size + len + 1 > cap) {
+            cap = (cap == 0) ? 65536 : cap * 2;
+            char *p = (char*)realloc(*lines, cap);
+            if (p == NULL) {
+                res = LK_OUT_OF_MEMORY;
+                break;
+            }
+            *lines = p;
+        }
+        if (res != LK_OK)
+            break;
+        memcpy(*lines + *size, line, len);
+        (*lines)[*size + len] = '\0';
+        *size += len + 1;
+        (*cnt)++;
+    }
+
+    lk_file_close(file);
+    return res;
+}
+
+static void free_parse_job(struct lk_parse_job *job) {
+    free(job->run.keys);
+    free(job->run.pool);
+    free_words(&job->part);
+}
+
+/* appends all words of a chunk to the dictionary */
+static lk_result append_words(struct lk_dictionary *dict, struct lk_parse_job *job) {
+    const struct lk_dictionary *part = &job->part;
+
+    job->first_word = dict->word_cnt;
+    for (size_t idx = 0; idx < part->word_cnt; idx++) {
+        const struct lk_word *w = word_at(part, idx);
+        const char *str = word_str(part, w);
+        unsigned int base = (w->base == LK_NO_BASE) ?
+            LK_NO_BASE : (unsigned int)(w->base + job->first_word);
+        struct lk_word *out = dict_add_word(dict, str, strlen(str), base);
+        if (out == NULL)
+            return LK_OUT_OF_MEMORY;
+        out->forms = w->forms;
+    }
+
+    return LK_OK;
+}
+
+/**
+ * @struct lk_first_char
+ * The number of lookup keys that start with a character
+ */
+struct lk_first_char {
+    utf8proc_int32_t cp;
+    size_t cnt;
+    int part;
+};
+
+static int cmp_first_char(const void *a, const void *b) {
+    const struct lk_first_char *fa = (const struct lk_first_char*)a;
+    const struct lk_first_char *fb = (const struct lk_first_char*)b;
+    return (fa->cnt < fb->cnt) - (fa->cnt > fb->cnt);
+}
+
+/* splits keys into parts by their first characters, so every part gets
+ * about the same number of keys. order receives the first characters in
+ * the order they appear in keys */
+static lk_result split_keys(struct lk_parse_job *chunks, size_t chunk_cnt, int parts,
+        char **order) {
+    size_t cap = 64, cnt = 0;
+    struct lk_first_char *chars = (struct lk_first_char*)malloc(cap * sizeof(*chars));
+    size_t *direct = (size_t*)calloc(0x800, sizeof(*direct));
+    size_t *load = (size_t*)calloc(parts, sizeof(*load));
+    if (chars == NULL || direct == NULL || load == NULL) {
+        free(chars);
+        free(direct);
+        free(load);
+        return LK_OUT_OF_MEMORY;
+    }
+
+    /* the first pass: count keys, chars is in order of appearance.
+     * k->part temporarily keeps the index in chars */
+    lk_result res = LK_OK;
+    for (size_t c = 0; c < chunk_cnt && res == LK_OK; c++) {
+        struct lk_key_run *run = &chunks[c].run;
+        for (size_t idx = 0; idx < run->cnt; idx++) {
+            struct lk_key *k = &run->keys[idx];
+            if (k->first == -1)
+                continue;
+
+            size_t pos = cnt;
+            if (k->first < 0x800 && direct[k->first] != 0) {
+                pos = direct[k->first] - 1;
+            } else if (k->first >= 0x800) {
+                for (pos = 0; pos < cnt && chars[pos].cp != k->first; pos++)
+                    ;
+            }
+            if (pos == cnt) {
+                if (cnt == cap) {
+                    struct lk_first_char *p = (struct lk_first_char*)realloc(chars,
+                            cap * 2 * sizeof(*chars));
+                    if (p == NULL) {
+                        res = LK_OUT_OF_MEMORY;
+                        break;
+                    }
+                    chars = p;
+                    cap *= 2;
+                }
+                chars[cnt].cp = k->first;
+                chars[cnt].cnt = 0;
+                chars[cnt].part = (int)cnt;
+                if (k->first < 0x800)
+                    direct[k->first] = cnt + 1;
+                cnt++;
+            }
+            chars[pos].cnt++;
+            k->part = (int)pos;
+        }
+    }
+
+    free(direct);
+    char *str = (res == LK_OK) ? (char*)malloc(cnt * 4 + 1) : NULL;
+    int *part_of = (res == LK_OK) ? (int*)malloc((cnt + 1) * sizeof(*part_of)) : NULL;
+    if (str == NULL || part_of == NULL) {
+        free(str);
+        free(part_of);
+        free(chars);
+        free(load);
+        return LK_OUT_OF_MEMORY;
+    }
+
+    size_t len = 0;
+    for (size_t idx = 0; idx < cnt; idx++)
+        len += lk_utf8_encode(chars[idx].cp, (utf8proc_uint8_t*)str + len);
+    str[len] = '\0';
+
+    /* the biggest groups first, each goes to the least loaded part */
+    qsort(chars, cnt, sizeof(*chars), cmp_first_char);
+    for (size_t idx = 0; idx < cnt; idx++) {
+        int best = 0;
+        for (int p = 1; p < parts; p++) {
+            if (load[p] < load[best])
+                best = p;
+        }
+        load[best] += chars[idx].cnt;
+        /* chars[idx].part is the original index of the character */
+        part_of[chars[idx].part] = best;
+    }
+
+    /* the second pass: replace the character index with the part */
+    for (size_t c = 0; c < chunk_cnt; c++) {
+        struct lk_key_run *run = &chunks[c].run;
+        for (size_t idx = 0; idx < run->cnt; idx++) {
+            struct lk_key *k = &run->keys[idx];
+            if (k->first != -1)
+                k->part = part_of[k->part];
+        }
+    }
+
+    free(chars);
+    free(part_of);
+    free(load);
+    *order = str;
+    return LK_OK;
+}
+
+/**
+ * Reads dictionary from a text file like lk_read_dictionary does but uses
+ *  several threads: lines are parsed and word forms are generated in
+ *  parallel, then every thread builds a part of the suffix tree for words
+ *  that start with its own set of characters, and the parts are merged.
+ *  The result is identical to lk_read_dictionary: the same words in the
+ *  same order, the same tree, and loading stops at the same line with the
+ *  same result if the file contains an invalid article.
+ *  If the dictionary is not empty or threads is 1 the function just calls
+ *  lk_read_dictionary
+ *
+ * @param[in] dict must be initialized before calling the function
+ * @param[in] path is a path to the dictionary file, see lk_read_dictionary
+ * @param[in] threads is the number of threads to use. 0 means the number
+ *  of processors
+ *
+ * @return the result of operation, see lk_read_dictionary. If it failed to
+ *  allocate memory (LK_OUT_OF_MEMORY) the dictionary is left unchanged
+ *
+ * @sa lk_read_dictionary
+ */
+lk_result lk_read_dictionary_parallel(struct lk_dictionary *dict, const char *path, size_t threads) {
+    if (threads == 0)
+        threads = lk_cpu_count();
+    if (threads > 256)
+        threads = 256;
+    if (threads == 1 || !lk_is_dict_valid(dict) || dict->word_cnt != 0
+        || dict->run != NULL || lk_tree_is_frozen(dict->tree))
+        return lk_read_dictionary(dict, path);
+
+    char *lines = NULL;
+    size_t size = 0, line_cnt = 0;
+    lk_result read_res = read_lines(path, &lines, &size, &line_cnt);
+    if (read_res == LK_OUT_OF_MEMORY || line_cnt == 0) {
+        free(lines);
+        return read_res;
+    }
+    if (threads > line_cnt)
+        threads = line_cnt;
+
+    struct lk_parse_job *chunks = (struct lk_parse_job*)calloc(threads, sizeof(*chunks));
+    struct lk_tree_job *parts = (struct lk_tree_job*)calloc(threads, sizeof(*parts));
+    struct lk_tree **trees = (struct lk_tree**)calloc(threads, sizeof(*trees));
+    struct lk_thread *th = (struct lk_thread*)calloc(threads, sizeof(*th));
+    if (chunks == NULL || parts == NULL || trees == NULL || th == NULL) {
+        free(chunks);
+        free(parts);
+        free((void*)trees);
+        free(th);
+        free(lines);
+        return LK_OUT_OF_MEMORY;
+    }
+
+    /* chunks of about the same size */
+    const char *line = lines;
+    size_t line_no = 0;
+    for (size_t c = 0; c < threads; c++) {
+        size_t limit = size / threads * (c + 1);
+        chunks[c].lines = line;
+        chunks[c].part.run = &chunks[c].run;
+        chunks[c].part.index = dict->index;
+        while (line_no < line_cnt && (c + 1 == threads || (size_t)(line - lines) < limit
+                    || chunks[c].cnt == 0)) {
+            line += strlen(line) + 1;
+            line_no++;
+            chunks[c].cnt++;
+        }
+    }
+
+    run_jobs(th, parse_chunk, (char*)chunks, sizeof(*chunks), threads);
+
+    /* like the sequential loader stop at the first failed line */
+    lk_result res = read_res;
+    size_t used = threads;
+    for (size_t c = 0; c < threads; c++) {
+        if (chunks[c].res != LK_OK) {
+            res = chunks[c].res;
+            used = c + 1;
+            break;
+        }
+    }
+
+    /* words of the chunks go to the dictionary in file order */
+    dict->generation = lk_unique_id();
+    lk_result build_res = LK_OK;
+    for (size_t c = 0; c < used && build_res == LK_OK; c++)
+        build_res = append_words(dict, &chunks[c]);
+
+    char *order = NULL;
+    if (build_res == LK_OK)
+        build_res = split_keys(chunks, used, (int)threads, &order);
+    for (size_t p = 0; p < threads && build_res == LK_OK; p++) {
+        parts[p].dict = dict;
+        parts[p].chunks = chunks;
+        parts[p].chunk_cnt = used;
+        parts[p].part = (int)p;
+        parts[p].tree = trees[p] = lk_tree_init();
+        if (trees[p] == NULL)
+            build_res = LK_OUT_OF_MEMORY;
+    }
+    if (build_res == LK_OK) {
+        run_jobs(th, build_tree_part, (char*)parts, sizeof(*parts), threads);
+        for (size_t p = 0; p < threads; p++) {
+            if (parts[p].res != LK_OK)
+                build_res = parts[p].res;
+        }
+    }
+    if (build_res == LK_OK)
+        build_res = lk_tree_merge(dict->tree, trees, threads, order);
+
+    if (build_res != LK_OK) {
+        for (size_t p = 0; p < threads; p++)
+            lk_tree_free(trees[p]);
+        free_words(dict);
+        res = build_res;
+    }
+
+    for (size_t c = 0; c < threads; c++)
+        free_parse_job(&chunks[c]);
+
+    free(order);
+    free(chunks);
+    free(parts);
+    free((void*)trees);
+    free(th);
+    free(lines);
+    return res;
+}
@@ -1,14 +1,55 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LK_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LK_SSE2 1
 #endif
 #include "lk_common.h"
 #include "lk_file.h"
+#include "lk_map.h"
+#include "lk_thread.h"
+#include "lk_utf8.h"
 
 #define LK_BUFFER_SIZE 65536
+/* default block size and number of blocks of a read-ahead ring */
+#define LK_AHEAD_BLOCK_SIZE (1024 * 1024)
+#define LK_AHEAD_BLOCKS 4
+
+/**
+ * @struct lk_ring
+ * Blocks that a background thread reads ahead of the reader of a file opened
+ *  with LK_FILE_READ_AHEAD. The thread fills free blocks in order and the
+ *  reader takes filled blocks in the same order
+ */
+struct lk_ring {
+    FILE *fh; /*!< the file, only the thread reads it */
+    char **blocks; /*!< the blocks */
+    size_t *lens; /*!< number of bytes read to every block */
+    size_t depth; /*!< number of blocks */
+    size_t block_size; /*!< size of a block */
+    size_t head; /*!< the first filled block */
+    size_t count; /*!< number of filled blocks including the one the reader uses */
+    int held; /*!< true if the reader uses the head block */
+    int done; /*!< true after the thread reached the end of file or failed */
+    int stop; /*!< true when the file is closed before the thread is done */
+    lk_result res; /*!< LK_OK or the error the thread got */
+    struct lk_mutex lock; /*!< protects all fields above except blocks */
+    struct lk_cond filled; /*!< signaled when a block is filled or the thread is done */
+    struct lk_cond freed; /*!< signaled when the reader frees a block or stops the thread */
+    struct lk_thread thread;
+};
 
 /**
  * @struct lk_file
@@ -16,13 +57,35 @@
  *  line feed and carriage returns
  */
 struct lk_file {
-    FILE* fh;/*!< opened file handle */
-    char *buffer;/*!< local buffer to read files */
+    FILE* fh;/*!< opened file handle, NULL for a mapped file */
+    char *buffer;/*!< local buffer to read files or the mapped file */
     size_t len;/*!< current length of the buffer */
     size_t cap;/*!< current buffer capacity */
     size_t pos;/*!< position in the buffer */
     int bom_checked; /*!< false until the first file read and skipping the first
                        bytes that are BOM (if any exists) */
+    size_t bom_len; /*!< number of bytes of BOM that were skipped */
+    int eol_pending; /*!< true if the line feeds after the last line returned
+                       by lk_file_next_line_view are not skipped yet */
+    struct lk_map map; /*!< the mapped file, map.data is NULL if the file is
+                         read with the buffer */
+    char *line; /*!< a line of lk_file_next_line_view that did not fit
+                  the buffer */
+    size_t line_cap; /*!< size of line */
+    struct lk_ring *ring; /*!< the read-ahead ring, NULL if the file is read
+                            by the caller thread */
+    unsigned long long block_start; /*!< file offset of the first byte of buffer */
+    unsigned long long end; /*!< lines that start at or after this offset are
+                              not read, ULLONG_MAX for the whole file */
+    struct lk_file_stats stats; /*!< reading statistics */
+    int check_utf8; /*!< true if lines are checked to be correct UTF8 */
+    int line_trusted; /*!< true if the last line is checked and correct */
+    size_t checked; /*!< bytes of the buffer before this position are checked */
+    size_t bad_pos; /*!< position of an invalid sequence in the buffer that
+                      stops checking, SIZE_MAX if there is none */
+    unsigned long long bad_offset; /*!< file offset of the first invalid
+                                     sequence, ULLONG_MAX if there is none */
+    int partial; /*!< true if lk_file_read returned a part of a line */
 };
 
 /**
@@ -39,7 +102,7 @@ struct lk_file {
  * @sa lk_file_close
  */
 struct lk_file* lk_file_open(const char* path) {
-    struct lk_file *f = (struct lk_file*)malloc(sizeof(*f));
+    struct lk_file *f = (struct lk_file*)calloc(1, sizeof(*f));
     if (!f)
         return NULL;
 
@@ -54,6 +117,9 @@ struct lk_file* lk_file_open(const char* path) {
     f->cap = LK_BUFFER_SIZE;
     f->len = 0;
     f->bom_checked = 0;
+    f->end = ULLONG_MAX;
+    f->bad_pos = SIZE_MAX;
+    f->bad_offset = ULLONG_MAX;
 #ifdef _WIN32
     wchar_t *wpath;
     int bufsz;
@@ -86,6 +152,207 @@ struct lk_file* lk_file_open(const char* path) {
     return f;
 }
 
+/* the background thread of a read-ahead ring */
+static void lk_read_ahead(void *arg) {
+    struct lk_ring *ring = (struct lk_ring*)arg;
+
+    for (;;) {
+        lk_mutex_lock(&ring->lock);
+        while (ring->count == ring->depth && !ring->stop)
+            lk_cond_wait(&ring->freed, &ring->lock);
+        size_t tail = (ring->head + ring->count) % ring->depth;
+        int stop = ring->stop;
+        lk_mutex_unlock(&ring->lock);
+        if (stop)
+            return;
+
+        /* the tail block is free, so the reader does not touch it */
+        size_t readbytes = fread(ring->blocks[tail], sizeof(char), ring->block_size, ring->fh);
+        int failed = readbytes != ring->block_size && ferror(ring->fh);
+
+        lk_mutex_lock(&ring->lock);
+        if (failed) {
+            ring->res = LK_FILE_READ_ERR;
+        } else if (readbytes != 0) {
+            ring->lens[tail] = readbytes;
+            ring->count++;
+        }
+        /* a short block is the last one */
+        ring->done = failed || readbytes != ring->block_size;
+        lk_cond_signal(&ring->filled);
+        lk_mutex_unlock(&ring->lock);
+        if (ring->done)
+            return;
+    }
+}
+
+static void lk_ring_free(struct lk_ring *ring) {
+    if (ring->blocks) {
+        for (size_t i = 0; i < ring->depth; i++)
+            free(ring->blocks[i]);
+    }
+    free(ring->blocks);
+    free(ring->lens);
+    free(ring);
+}
+
+/* stops the thread of a ring and frees it */
+static void lk_ring_close(struct lk_ring *ring) {
+    lk_mutex_lock(&ring->lock);
+    ring->stop = 1;
+    lk_cond_signal(&ring->freed);
+    lk_mutex_unlock(&ring->lock);
+    lk_thread_join(&ring->thread);
+
+    lk_cond_free(&ring->freed);
+    lk_cond_free(&ring->filled);
+    lk_mutex_free(&ring->lock);
+    lk_ring_free(ring);
+}
+
+/* creates a ring for an opened file and starts its thread */
+static struct lk_ring* lk_ring_open(FILE *fh, size_t block_size, size_t blocks) {
+    struct lk_ring *ring = (struct lk_ring*)calloc(1, sizeof(*ring));
+    if (ring == NULL)
+        return NULL;
+
+    ring->fh = fh;
+    ring->depth = blocks;
+    ring->block_size = block_size;
+    ring->blocks = (char**)calloc(blocks, sizeof(*ring->blocks));
+    ring->lens = (size_t*)calloc(blocks, sizeof(*ring->lens));
+    if (ring->blocks == NULL || ring->lens == NULL) {
+        lk_ring_free(ring);
+        return NULL;
+    }
+    for (size_t i = 0; i < blocks; i++) {
+        ring->blocks[i] = (char*)malloc(block_size);
+        if (ring->blocks[i] == NULL) {
+            lk_ring_free(ring);
+            return NULL;
+        }
+    }
+
+    if (lk_mutex_init(&ring->lock) != LK_OK) {
+        lk_ring_free(ring);
+        return NULL;
+    }
+    if (lk_cond_init(&ring->filled) != LK_OK) {
+        lk_mutex_free(&ring->lock);
+        lk_ring_free(ring);
+        return NULL;
+    }
+    if (lk_cond_init(&ring->freed) != LK_OK) {
+        lk_cond_free(&ring->filled);
+        lk_mutex_free(&ring->lock);
+        lk_ring_free(ring);
+        return NULL;
+    }
+    if (lk_thread_start(&ring->thread, lk_read_ahead, ring) != LK_OK) {
+        lk_cond_free(&ring->freed);
+        lk_cond_free(&ring->filled);
+        lk_mutex_free(&ring->lock);
+        lk_ring_free(ring);
+        return NULL;
+    }
+
+    return ring;
+}
+
+static void lk_start_read_ahead(struct lk_file *f, size_t block_size, size_t blocks);
+
+/**
+ * Opens a file that a background thread reads ahead of the caller, so
+ *  reading the file overlaps processing its lines. The thread fills a ring
+ *  of blocks and waits when all blocks are filled. If the thread cannot be
+ *  started the file is read as lk_file_open does
+ *
+ * @param[in] path is a path to file to read or NULL to use LK_DICTIONARY
+ * @param[in] block_size is the size of a block in bytes, 0 means 1 MiB
+ * @param[in] blocks is the number of blocks in the ring, 0 means 4. The
+ *  ring has at least 2 blocks: the thread fills one while the caller reads
+ *  another
+ *
+ * @return a pointer to allocated structure or NULL
+ *
+ * @sa lk_file_open_ex
+ * @sa lk_file_get_stats
+ */
+struct lk_file* lk_file_open_read_ahead(const char* path, size_t block_size, size_t blocks) {
+    struct lk_file *f = lk_file_open(path);
+    if (f != NULL && f->fh != NULL)
+        lk_start_read_ahead(f, block_size, blocks);
+    return f;
+}
+
+/* starts reading a file opened with lk_file_open ahead from the current
+ * position of the file. The file is read by the caller if it fails */
+static void lk_start_read_ahead(struct lk_file *f, size_t block_size, size_t blocks) {
+    if (block_size == 0)
+        block_size = LK_AHEAD_BLOCK_SIZE;
+    if (blocks == 0)
+        blocks = LK_AHEAD_BLOCKS;
+    else if (blocks < 2)
+        blocks = 2;
+
+    struct lk_ring *ring = lk_ring_open(f->fh, block_size, blocks);
+    if (ring == NULL)
+        return;
+
+    free(f->buffer);
+    f->ring = ring;
+    f->buffer = ring->blocks[0];
+    f->cap = block_size;
+}
+
+/**
+ * Opens a file like lk_file_open but lets a caller choose how the file is
+ *  read. A file that cannot be mapped (e.g, a pipe or an empty file) is read
+ *  with the buffer as lk_file_open does
+ *
+ * @param[in] path is a path to file to read or NULL to use LK_DICTIONARY
+ * @param[in] mode is the way to read the file:
+ *  LK_FILE_BUFFERED - the same as lk_file_open
+ *  LK_FILE_MMAP - the file is mapped into memory, so lk_file_next_line_view
+ *   returns lines without copying them. The system is advised that the
+ *   file is read sequentially
+ *  LK_FILE_READ_AHEAD - a background thread reads the file ahead by blocks
+ *   of the default size, see lk_file_open_read_ahead
+ *
+ * @return a pointer to allocated structure or NULL
+ *
+ * @sa lk_file_open
+ * @sa lk_file_open_read_ahead
+ * @sa lk_file_next_line_view
+ */
+struct lk_file* lk_file_open_ex(const char* path, lk_file_mode mode) {
+    if (mode == LK_FILE_READ_AHEAD)
+        return lk_file_open_read_ahead(path, 0, 0);
+    if (mode != LK_FILE_MMAP)
+        return lk_file_open(path);
+
+    const char *filepath = (path == NULL) ? getenv("LK_DICTIONARY") : path;
+    struct lk_map map;
+    if (filepath == NULL || lk_map_open(&map, filepath) != LK_OK)
+        return lk_file_open(path);
+
+    struct lk_file *f = (struct lk_file*)calloc(1, sizeof(*f));
+    if (!f) {
+        lk_map_close(&map);
+        return NULL;
+    }
+
+    lk_map_advise_sequential(&map);
+    f->end = ULLONG_MAX;
+    f->bad_pos = SIZE_MAX;
+    f->bad_offset = ULLONG_MAX;
+    f->map = map;
+    f->buffer = (char*)map.data;
+    f->len = map.size;
+    f->cap = map.size;
+    return f;
+}
+
 /**
  * Frees all resources allocated for a file reader. If file is NULL the function
  *  does nothing.
@@ -98,12 +365,18 @@ void lk_file_close(struct lk_file *file) {
     if (! file)
         return;
 
+    /* the thread must finish before the file is closed */
+    if (file->ring)
+        lk_ring_close(file->ring);
+    else if (file->map.data)
+        lk_map_close(&file->map);
+    else if (file->cap)
+        free(file->buffer);
+
     if (file->fh)
         fclose(file->fh);
 
-    if (file->cap)
-        free(file->buffer);
-
+    free(file->line);
     free(file);
 }
 
@@ -119,16 +392,161 @@ void lk_file_close(struct lk_file *file) {
  * @see lk_file_open
  */
 int lk_file_is_valid(const struct lk_file const *file) {
-    return (file && file->fh && file->buffer && file->cap);
+    return (file && (file->fh || file->map.data) && file->buffer && file->cap);
+}
+
+/**
+ * Returns statistics of reading a file. For a file opened with
+ *  LK_FILE_READ_AHEAD the wait time is the time the caller waited for the
+ *  background thread; for a file read with the buffer it is the time spent
+ *  in reading blocks. A mapped file has no blocks to wait for
+ *
+ * @param[in] file is a pointer to a file reader
+ * @param[out] stats receives the statistics
+ *
+ * @return LK_OK, LK_INVALID_FILE if file is not valid, or LK_INVALID_ARG if
+ *  stats is NULL
+ *
+ * @sa lk_file_open_read_ahead
+ */
+lk_result lk_file_get_stats(const struct lk_file *file, struct lk_file_stats *stats) {
+    if (!lk_file_is_valid(file))
+        return LK_INVALID_FILE;
+    if (stats == NULL)
+        return LK_INVALID_ARG;
+
+    *stats = file->stats;
+    return LK_OK;
+}
+
+/**
+ * Turns on or off checking that the lines of a file are correct UTF8. The
+ *  lines are checked by blocks of about 64 KiB as they are read, so a line
+ *  is decoded without any check afterwards if lk_file_line_trusted confirms
+ *  it, e.g. with lk_to_low_case_trusted. The first invalid sequence is
+ *  reported by lk_file_utf8_error
+ *
+ * @param[in] file is a pointer to a file reader
+ * @param[in] enable is non-zero to check the lines that are read next
+ *
+ * @return LK_OK or LK_INVALID_FILE if file is not valid
+ *
+ * @sa lk_file_line_trusted
+ * @sa lk_file_utf8_error
+ */
+lk_result lk_file_check_utf8(struct lk_file *file, int enable) {
+    if (!lk_file_is_valid(file))
+        return LK_INVALID_FILE;
+
+    file->check_utf8 = enable != 0;
+    file->line_trusted = 0;
+    return LK_OK;
+}
+
+/**
+ * Returns non-zero if the last line read from a file was checked and it
+ *  is correct UTF8. It is always 0 if checking is off, after the end of
+ *  file, and for a part of a line that did not fit the buffer of
+ *  lk_file_read
+ *
+ * @sa lk_file_check_utf8
+ */
+int lk_file_line_trusted(const struct lk_file *file) {
+    return lk_file_is_valid(file) && file->line_trusted;
+}
+
+/**
+ * Reports the first invalid UTF8 sequence that checking found in the part
+ *  of the file read so far. Checking goes a bit ahead of the read lines, so
+ *  the sequence can be in a line that is not read yet
+ *
+ * @param[in] file is a pointer to a file reader
+ * @param[out] offset receives the byte offset of the invalid sequence from
+ *  the beginning of the file
+ *
+ * @return the result:
+ *  LK_OK - no invalid sequence was found
+ *  LK_INVALID_STRING - an invalid sequence was found at offset
+ *  LK_INVALID_FILE - file is not valid
+ *  LK_INVALID_ARG - offset is NULL
+ *
+ * @sa lk_file_check_utf8
+ */
+lk_result lk_file_utf8_error(const struct lk_file *file, unsigned long long *offset) {
+    if (!lk_file_is_valid(file))
+        return LK_INVALID_FILE;
+    if (offset == NULL)
+        return LK_INVALID_ARG;
+
+    if (file->bad_offset == ULLONG_MAX)
+        return LK_OK;
+    *offset = file->bad_offset;
+    return LK_INVALID_STRING;
+}
+
+/* frees the block the caller has read and takes the next filled block */
+static lk_result lk_next_ahead_block(struct lk_file *file) {
+    struct lk_ring *ring = file->ring;
+    lk_result res = LK_OK;
+
+    lk_mutex_lock(&ring->lock);
+    if (ring->held) {
+        ring->held = 0;
+        ring->head = (ring->head + 1) % ring->depth;
+        ring->count--;
+        lk_cond_signal(&ring->freed);
+    }
+    if (ring->count == 0 && !ring->done) {
+        unsigned long long start = lk_time_ns();
+        while (ring->count == 0 && !ring->done)
+            lk_cond_wait(&ring->filled, &ring->lock);
+        file->stats.wait_ns += lk_time_ns() - start;
+        file->stats.stalls++;
+    }
+
+    file->pos = 0;
+    file->len = 0;
+    if (ring->count != 0) {
+        ring->held = 1;
+        file->buffer = ring->blocks[ring->head];
+        file->len = ring->lens[ring->head];
+        file->stats.blocks++;
+        file->stats.bytes += file->len;
+    } else {
+        res = ring->res;
+    }
+    lk_mutex_unlock(&ring->lock);
+
+    return res;
 }
 
 static lk_result lk_read_block(struct lk_file *file) {
+    file->block_start += file->len;
+    file->checked = 0;
+    file->bad_pos = SIZE_MAX;
+    if (file->ring)
+        return lk_next_ahead_block(file);
+
+    if (file->map.data) {
+        /* the whole mapped file is the only block */
+        file->pos = 0;
+        file->len = 0;
+        return LK_OK;
+    }
+
+    unsigned long long start = lk_time_ns();
     size_t readbytes = fread(file->buffer, sizeof(char), file->cap, file->fh);
+    file->stats.wait_ns += lk_time_ns() - start;
+    file->stats.stalls++;
     if (readbytes != file->cap && ferror(file->fh))
             return LK_FILE_READ_ERR;
 
     file->pos = 0;
     file->len = readbytes;
+    if (readbytes != 0) {
+        file->stats.blocks++;
+        file->stats.bytes += readbytes;
+    }
     return LK_OK;
 }
 
@@ -138,8 +556,155 @@ static void lk_skip_bom(struct lk_file *file) {
     if (file->len < 3)
         return;
 
-    if (file->buffer[0] == 0xEF && file->buffer[1] == 0xBB && file->buffer[2] == 0xBF)
+    const unsigned char *b = (const unsigned char*)file->buffer;
+    if (b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF) {
         file->pos = 3;
+        file->bom_len = 3;
+    }
+}
+
+/* returns true if the next line starts after the range of the file. BOM
+ * belongs to the first line, so the first line starts at offset 0 */
+static int lk_past_end(const struct lk_file *file) {
+    unsigned long long start = file->block_start + file->pos;
+    if (start == file->bom_len)
+        start = 0;
+    return start >= file->end;
+}
+
+/* skips line feeds after the line returned by lk_file_next_line_view */
+static lk_result lk_skip_eol(struct lk_file *file) {
+    file->eol_pending = 0;
+    for (;;) {
+        while (file->pos < file->len
+            && (file->buffer[file->pos] == '\n' || file->buffer[file->pos] == '\r'))
+            file->pos++;
+        if (file->pos < file->len || file->len == 0)
+            return LK_OK;
+
+        lk_result lk = lk_read_block(file);
+        if (lk != LK_OK)
+            return lk;
+    }
+}
+
+#ifdef LK_SSE2
+/* returns the index of the lowest set bit of a non-zero mask */
+static unsigned int lk_first_bit(unsigned int mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+/* returns the number of bytes before the first line feed. Blocks of 32 or
+ * 16 bytes are compared with both line feed characters at once */
+static size_t lk_line_end(const char *s, size_t len) {
+    size_t idx = 0;
+#ifdef __AVX2__
+    const __m256i lf32 = _mm256_set1_epi8('\n');
+    const __m256i cr32 = _mm256_set1_epi8('\r');
+    for (; idx + 32 <= len; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + idx));
+        __m256i eol = _mm256_or_si256(_mm256_cmpeq_epi8(v, lf32), _mm256_cmpeq_epi8(v, cr32));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(eol);
+        if (mask != 0)
+            return idx + lk_first_bit(mask);
+    }
+#endif
+#ifdef LK_SSE2
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; idx + 16 <= len; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + idx));
+        __m128i eol = _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(eol);
+        if (mask != 0)
+            return idx + lk_first_bit(mask);
+    }
+#endif
+    while (idx < len && s[idx] != '\n' && s[idx] != '\r')
+        idx++;
+    return idx;
+}
+
+/* appends len bytes to the line of lk_file_next_line_view */
+static lk_result lk_append_line(struct lk_file *file, size_t used, const char *s, size_t len) {
+    if (used + len > file->line_cap) {
+        size_t cap = file->line_cap == 0 ? LK_BUFFER_SIZE : file->line_cap;
+        while (cap < used + len)
+            cap *= 2;
+        char *line = (char*)realloc(file->line, cap);
+        if (line == NULL)
+            return LK_OUT_OF_MEMORY;
+        file->line = line;
+        file->line_cap = cap;
+    }
+
+    memcpy(file->line + used, s, len);
+    return LK_OK;
+}
+
+/* returns the position after the last line feed in [from, to) of the
+ * buffer, or from if there is none */
+static size_t lk_last_line_end(const struct lk_file *file, size_t from, size_t to) {
+    while (to > from && file->buffer[to - 1] != '\n' && file->buffer[to - 1] != '\r')
+        to--;
+    return to;
+}
+
+/* remembers an invalid sequence at a file offset if it is the first one */
+static void lk_set_bad(struct lk_file *file, unsigned long long offset) {
+    if (offset < file->bad_offset)
+        file->bad_offset = offset;
+}
+
+/* checks that a line at [start, end) of the buffer is correct UTF8. The
+ * buffer is checked by windows of whole lines, so a line is usually
+ * checked before it is read. A UTF8 sequence never contains a line feed,
+ * so lines are checked separately. Checking stops at an invalid sequence
+ * until the line that contains it is read */
+static int lk_check_view(struct lk_file *file, size_t start, size_t end) {
+    if (file->checked < start) {
+        /* the line with the invalid sequence is passed */
+        file->checked = start;
+        file->bad_pos = SIZE_MAX;
+    }
+    if (end <= file->checked)
+        return 1;
+    if (file->bad_pos != SIZE_MAX)
+        return 0;
+
+    size_t to = file->checked + LK_BUFFER_SIZE;
+    if (to > file->len)
+        to = file->len;
+    to = (to > end) ? lk_last_line_end(file, end, to) : end;
+
+    size_t n = lk_utf8_valid_len((const utf8proc_uint8_t*)file->buffer + file->checked,
+            to - file->checked);
+    file->checked += n;
+    if (file->checked == to)
+        return 1;
+
+    file->bad_pos = file->checked;
+    lk_set_bad(file, file->block_start + file->checked);
+    return file->checked >= end;
+}
+
+/* checks a line that is not a part of the buffer: it was joined from
+ * several blocks. offset is the file offset of the line */
+static int lk_check_copy(struct lk_file *file, const char *line, size_t len,
+        unsigned long long offset) {
+    size_t n = lk_utf8_valid_len((const utf8proc_uint8_t*)line, len);
+    if (n == len)
+        return 1;
+
+    lk_set_bad(file, offset + n);
+    return 0;
 }
 
 /**
@@ -173,9 +738,16 @@ lk_result lk_file_read(struct lk_file *file, char *buffer, size_t buf_size) {
     if (!lk_file_is_valid(file))
         return LK_INVALID_FILE;
 
+    file->line_trusted = 0;
     if (buffer == NULL || buf_size == 0)
         return LK_BUFFER_SMALL;
 
+    if (file->eol_pending) {
+        lk_result lk = lk_skip_eol(file);
+        if (lk != LK_OK)
+            return lk;
+    }
+
     if (file->len == 0 || file->pos >= file->len) {
         lk_result lk = lk_read_block(file);
         if (lk != LK_OK)
@@ -189,38 +761,229 @@ lk_result lk_file_read(struct lk_file *file, char *buffer, size_t buf_size) {
 
     if (!file->bom_checked && file->pos == 0)
         lk_skip_bom(file);
+    if (lk_past_end(file))
+        return LK_EOF;
 
-    while (buf_size > 0) {
-        char c = file->buffer[file->pos];
-        if (c == '\n' || c == '\r') {
-            *b = '\0';
-            break;
-        }
+    /* a part of a long line is not checked: it can cut a UTF8 sequence */
+    int check = file->check_utf8 && !file->partial;
+    size_t start = file->pos;
+    unsigned long long offset = file->block_start + file->pos;
+    int joined = 0;
+    file->partial = 0;
 
-        *b++ = c;
-        buf_size--;
-        file->pos++;
-        if (buf_size == 0)
+    /* the line is copied by one move per block */
+    for (;;) {
+        size_t avail = file->len - file->pos;
+        size_t n = lk_line_end(file->buffer + file->pos, avail);
+        if (n >= buf_size) {
+            memcpy(b, file->buffer + file->pos, buf_size);
+            file->pos += buf_size;
+            file->partial = 1;
             return LK_BUFFER_SMALL;
-
-        if (file->pos >= file->len) {
-            lk_result lk = lk_read_block(file);
-            if (lk != LK_OK)
-                return lk;
-            if (file->len == 0) {
-                *b = '\0';
-                break;
-            }
         }
+
+        memcpy(b, file->buffer + file->pos, n);
+        b += n;
+        buf_size -= n;
+        file->pos += n;
+        if (n < avail)
+            break;
+
+        lk_result lk = lk_read_block(file);
+        if (lk != LK_OK)
+            return lk;
+        joined = 1;
+        if (file->len == 0)
+            break;
+    }
+    *b = '\0';
+
+    if (check) {
+        file->line_trusted = joined ? lk_check_copy(file, buffer, b - buffer, offset)
+            : lk_check_view(file, start, file->pos);
+    }
+
+    return lk_skip_eol(file);
+}
+
+
+/**
+ * Returns the next line of the file without copying it. Lines have no length
+ *  limit. Line feeds are handled the same way as lk_file_read does, so both
+ *  functions return the same lines
+ *
+ * @param[in] file is a pointer to a file reader
+ * @param[out] line receives the first byte of the line. The line does NOT
+ *  end with zero character. It points to the mapped file or to the buffer
+ *  of the reader and it is valid until the next read or until the file is
+ *  closed
+ * @param[out] len receives the length of the line in bytes
+ *
+ * @return the result of read operation:
+ *  LK_OK - the next line was read
+ *  LK_EOF - the end of file is reached, line is NULL and len is 0
+ *  LK_INVALID_FILE - file was not opened or file is NULL
+ *  LK_INVALID_ARG - line or len is NULL
+ *  LK_FILE_READ_ERR - failed to read the file
+ *  LK_OUT_OF_MEMORY - a line is longer than the buffer and it failed to
+ *   allocate memory for it
+ *
+ * @sa lk_file_open_ex
+ * @sa lk_file_read
+ */
+lk_result lk_file_next_line_view(struct lk_file *file, const char **line, size_t *len) {
+    if (!lk_file_is_valid(file))
+        return LK_INVALID_FILE;
+    if (line == NULL || len == NULL)
+        return LK_INVALID_ARG;
+
+    *line = NULL;
+    *len = 0;
+    file->line_trusted = 0;
+    lk_result lk;
+    if (file->len == 0 || file->pos >= file->len) {
+        lk = lk_read_block(file);
+        if (lk != LK_OK)
+            return lk;
+    }
+    if (!file->bom_checked && file->pos == 0)
+        lk_skip_bom(file);
+    if (file->eol_pending) {
+        lk = lk_skip_eol(file);
+        if (lk != LK_OK)
+            return lk;
     }
+    if (file->pos >= file->len || lk_past_end(file))
+        return LK_EOF;
 
+    size_t n = lk_line_end(file->buffer + file->pos, file->len - file->pos);
+    const char *start = file->buffer + file->pos;
+    file->pos += n;
+    file->eol_pending = 1;
+    if (file->pos < file->len || file->map.data) {
+        if (file->check_utf8)
+            file->line_trusted = lk_check_view(file, file->pos - n, file->pos);
+        *line = start;
+        *len = n;
+        return LK_OK;
+    }
+
+    /* the line continues in the next block */
+    unsigned long long offset = file->block_start + (file->pos - n);
+    size_t used = 0;
     for (;;) {
-        char c = file->buffer[file->pos];
-        if (c != '\n' && c != '\r') {
+        lk = lk_append_line(file, used, start, n);
+        if (lk != LK_OK)
+            return lk;
+        used += n;
+
+        lk = lk_read_block(file);
+        if (lk != LK_OK)
+            return lk;
+        if (file->len == 0)
+            break;
+        start = file->buffer;
+        n = lk_line_end(start, file->len);
+        file->pos = n;
+        if (n < file->len) {
+            lk = lk_append_line(file, used, start, n);
+            if (lk != LK_OK)
+                return lk;
+            used += n;
             break;
         }
+    }
+
+    if (file->check_utf8)
+        file->line_trusted = lk_check_copy(file, file->line, used, offset);
+    *line = file->line;
+    *len = used;
+    return LK_OK;
+}
+
+/**
+ * Returns the next line of the file as a C string of any length. The line
+ *  is terminated in the reader buffer when it is possible, otherwise it is
+ *  copied to a buffer of the reader that grows when a longer line comes and
+ *  is reused for the next lines. So a caller does not need a buffer of its
+ *  own and does not get LK_BUFFER_SMALL for long lines as with lk_file_read
+ *
+ * @param[in] file is a pointer to a file reader
+ * @param[out] line receives the line that ends with zero character. It is
+ *  valid until the next read or until the file is closed
+ * @param[out] len receives the length of the line in bytes, it can be NULL
+ *
+ * @return the result of read operation:
+ *  LK_OK - the next line was read
+ *  LK_EOF - the end of file is reached, line is NULL
+ *  LK_INVALID_FILE - file was not opened or file is NULL
+ *  LK_INVALID_ARG - line is NULL
+ *  LK_FILE_READ_ERR - failed to read the file
+ *  LK_OUT_OF_MEMORY - failed to grow the buffer for the line
+ *
+ * @sa lk_file_next_line_view
+ */
+lk_result lk_file_read_line(struct lk_file *file, const char **line, size_t *len) {
+    if (line == NULL)
+        return LK_INVALID_ARG;
+
+    const char *view;
+    size_t view_len;
+    lk_result lk = lk_file_next_line_view(file, &view, &view_len);
+    *line = NULL;
+    if (len != NULL)
+        *len = 0;
+    if (lk != LK_OK)
+        return lk;
+
+    if (view == file->buffer + file->pos - view_len && !file->map.data) {
+        /* the line feed after the line is replaced with zero in the buffer
+         * of the reader, it is skipped before the next line anyway */
+        file->buffer[file->pos++] = '\0';
+    } else {
+        /* the mapped file is read-only and a joined line is in file->line */
+        if (view != file->line)
+            lk = lk_append_line(file, 0, view, view_len);
+        if (lk == LK_OK)
+            lk = lk_append_line(file, view_len, "", 1);
+        if (lk != LK_OK)
+            return lk;
+        view = file->line;
+    }
+
+    *line = view;
+    if (len != NULL)
+        *len = view_len;
+    return LK_OK;
+}
+
+/* sets the file position to a byte offset, it is used before reading */
+static lk_result lk_seek(struct lk_file *file, unsigned long long offset) {
+    file->pos = 0;
+    file->len = 0;
+    file->eol_pending = 0;
+    file->checked = 0;
+    file->bad_pos = SIZE_MAX;
+    if (file->map.data) {
+        file->buffer = (char*)file->map.data;
+        file->len = file->map.size;
+        file->block_start = 0;
+        file->pos = offset < file->map.size ? (size_t)offset : file->map.size;
+        return LK_OK;
+    }
 
-        file->pos++;
+    file->block_start = offset;
+#ifdef _WIN32
+    int failed = _fseeki64(file->fh, (__int64)offset, SEEK_SET);
+#else
+    int failed = fseeko(file->fh, (off_t)offset, SEEK_SET);
+#endif
+    return failed ? LK_FILE_READ_ERR : LK_OK;
+}
+
+/* skips bytes up to the end of the current line */
+static lk_result lk_skip_line(struct lk_file *file) {
+    for (;;) {
         if (file->pos >= file->len) {
             lk_result lk = lk_read_block(file);
             if (lk != LK_OK)
@@ -228,8 +991,127 @@ lk_result lk_file_read(struct lk_file *file, char *buffer, size_t buf_size) {
             if (file->len == 0)
                 break;
         }
+        file->pos += lk_line_end(file->buffer + file->pos, file->len - file->pos);
+        if (file->pos < file->len)
+            break;
     }
-
+    file->eol_pending = 1;
     return LK_OK;
 }
 
+/* moves the file to the first line that starts at or after the offset */
+static lk_result lk_seek_line(struct lk_file *file, unsigned long long offset) {
+    if (offset == 0)
+        return lk_seek(file, 0);
+
+    /* a line starts at the offset only if the previous byte is a line feed */
+    file->bom_checked = 1;
+    lk_result lk = lk_seek(file, offset - 1);
+    if (lk == LK_OK)
+        lk = lk_skip_line(file);
+    return lk;
+}
+
+/**
+ * Opens a part of a file to process a big file by several threads. The part
+ *  consists of the lines that start in the range [begin, end), so a line that
+ *  crosses end is read up to its last byte, and a line that starts before
+ *  begin is skipped. Parts of adjacent ranges never share or lose a line.
+ *  The boundaries are usually from lk_file_plan_chunks, but any offsets work
+ *
+ * @param[in] path is a path to file to read or NULL to use LK_DICTIONARY
+ * @param[in] mode is the way to read the file, see lk_file_open_ex. A file
+ *  that cannot be positioned (e.g, a pipe) fails to open unless begin is 0
+ * @param[in] begin is the byte offset of the range
+ * @param[in] end is the byte offset after the range, ULLONG_MAX or any value
+ *  greater than the file size means the end of the file
+ *
+ * @return a pointer to allocated structure or NULL
+ *
+ * @sa lk_file_plan_chunks
+ * @sa lk_file_open_ex
+ */
+struct lk_file* lk_file_open_range(const char* path, lk_file_mode mode,
+        unsigned long long begin, unsigned long long end) {
+    struct lk_file *f = lk_file_open_ex(path, mode == LK_FILE_MMAP ? LK_FILE_MMAP : LK_FILE_BUFFERED);
+    if (!lk_file_is_valid(f))
+        return f;
+
+    f->end = end;
+    /* the file is positioned before the thread starts reading it */
+    lk_result lk = begin == 0 ? LK_OK : lk_seek(f, begin - 1);
+    if (lk == LK_OK && mode == LK_FILE_READ_AHEAD)
+        lk_start_read_ahead(f, 0, 0);
+    if (lk == LK_OK && begin != 0) {
+        f->bom_checked = 1;
+        lk = lk_skip_line(f);
+    }
+    if (lk != LK_OK) {
+        lk_file_close(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+/**
+ * Splits a file into ranges of about the same size for lk_file_open_range.
+ *  Every range begins at the first byte of a line, so the ranges are
+ *  aligned to line boundaries. A range is empty (begin == end) if the file
+ *  has too few lines for all ranges
+ *
+ * @param[in] path is a path to file or NULL to use LK_DICTIONARY
+ * @param[out] ranges receives count ranges that cover the whole file in order
+ * @param[in] count is the number of ranges
+ *
+ * @return the result:
+ *  LK_OK - the ranges are filled
+ *  LK_INVALID_ARG - ranges is NULL or count is 0
+ *  LK_INVALID_FILE - failed to open the file
+ *  LK_FILE_READ_ERR - failed to read the file or to get its size
+ *
+ * @sa lk_file_open_range
+ */
+lk_result lk_file_plan_chunks(const char *path, struct lk_file_range *ranges, size_t count) {
+    if (ranges == NULL || count == 0)
+        return LK_INVALID_ARG;
+
+    struct lk_file *f = lk_file_open(path);
+    if (!lk_file_is_valid(f)) {
+        lk_file_close(f);
+        return LK_INVALID_FILE;
+    }
+
+#ifdef _WIN32
+    int failed = _fseeki64(f->fh, 0, SEEK_END);
+    long long size = failed ? -1 : _ftelli64(f->fh);
+#else
+    int failed = fseeko(f->fh, 0, SEEK_END);
+    long long size = failed ? -1 : (long long)ftello(f->fh);
+#endif
+    lk_result lk = size < 0 ? LK_FILE_READ_ERR : LK_OK;
+
+    unsigned long long total = size < 0 ? 0 : (unsigned long long)size;
+    unsigned long long prev = 0;
+    for (size_t idx = 0; idx < count && lk == LK_OK; idx++) {
+        unsigned long long next = total;
+        if (idx + 1 < count) {
+            /* total * (idx + 1) / count without overflow */
+            next = total / count * (idx + 1) + total % count * (idx + 1) / count;
+            if (next <= prev) {
+                next = prev;
+            } else {
+                lk = lk_seek_line(f, next);
+                if (lk == LK_OK)
+                    lk = lk_skip_eol(f);
+                next = f->block_start + f->pos;
+            }
+        }
+        ranges[idx].begin = prev;
+        ranges[idx].end = next;
+        prev = next;
+    }
+
+    lk_file_close(f);
+    return lk;
+}
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "lk_common.h"
+#include "lk_map.h"
+
+/**
+ * Maps the whole file into memory for reading. The mapping is shared, so
+ *  all processes that map the same file use the same pages of page cache
+ *
+ * @param[out] map is a structure to fill
+ * @param[in] path is a path to a file. File name is always UTF8-string
+ *
+ * @return the result of operation:
+ *  LK_OK - the file is mapped, map->data points to its first byte
+ *  LK_INVALID_ARG - map or path is NULL
+ *  LK_INVALID_FILE - failed to open the file, or the file is empty, or it
+ *   cannot be mapped (e.g, it is a pipe)
+ *  LK_OUT_OF_MEMORY - failed to allocate memory
+ *
+ * @sa lk_map_close
+ */
+lk_result lk_map_open(struct lk_map *map, const char *path) {
+    if (map == NULL || path == NULL)
+        return LK_INVALID_ARG;
+
+    map->data = NULL;
+    map->size = 0;
+#ifdef _WIN32
+    map->file = NULL;
+    map->mapping = NULL;
+
+    int bufsz = MultiByteToWideChar(CP_UTF8, 0, path, -1, NULL, 0);
+    wchar_t *wpath = (wchar_t*)malloc((bufsz + 1) * sizeof(wchar_t));
+    if (wpath == NULL)
+        return LK_OUT_OF_MEMORY;
+    MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, bufsz);
+
+    HANDLE fh = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+    free(wpath);
+    if (fh == INVALID_HANDLE_VALUE)
+        return LK_INVALID_FILE;
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(fh, &sz) || sz.QuadPart == 0) {
+        CloseHandle(fh);
+        return LK_INVALID_FILE;
+    }
+
+    HANDLE mh = CreateFileMappingW(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mh == NULL) {
+        CloseHandle(fh);
+        return LK_INVALID_FILE;
+    }
+
+    void *data = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mh);
+        CloseHandle(fh);
+        return LK_INVALID_FILE;
+    }
+
+    map->file = fh;
+    map->mapping = mh;
+    map->data = (const char*)data;
+    map->size = (size_t)sz.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return LK_INVALID_FILE;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return LK_INVALID_FILE;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return LK_INVALID_FILE;
+
+    map->data = (const char*)data;
+    map->size = (size_t)st.st_size;
+#endif
+
+    return LK_OK;
+}
+
+/**
+ * Unmaps the file. If map is NULL or it was not opened the function
+ *  does nothing
+ */
+void lk_map_close(struct lk_map *map) {
+    if (map == NULL || map->data == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+    map->file = NULL;
+    map->mapping = NULL;
+#else
+    munmap((void*)map->data, map->size);
+#endif
+
+    map->data = NULL;
+    map->size = 0;
+}
+
+/**
+ * Tells the system that the mapped file is read from the beginning to the
+ *  end, so it reads pages ahead and drops the pages that were read. The
+ *  function does nothing if the system has no such hint
+ */
+void lk_map_advise_sequential(const struct lk_map *map) {
+    if (map == NULL || map->data == NULL)
+        return;
+
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+    madvise((void*)map->data, map->size, MADV_SEQUENTIAL);
+#endif
+}
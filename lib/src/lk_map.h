@@ -0,0 +1,29 @@
+#ifndef LKCHECKER_MAP
+#define LKCHECKER_MAP
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct lk_map
+ * Read-only memory mapping of a whole file
+ */
+struct lk_map {
+    const char *data; /*!< the first byte of the file */
+    size_t size; /*!< file size in bytes */
+#ifdef _WIN32
+    void *file; /*!< file handle */
+    void *mapping; /*!< file mapping handle */
+#endif
+};
+
+lk_result lk_map_open(struct lk_map *map, const char *path);
+void lk_map_close(struct lk_map *map);
+void lk_map_advise_sequential(const struct lk_map *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#include "lk_common.h"
+#include "lk_thread.h"
+
+#ifdef _WIN32
+static DWORD WINAPI thread_main(LPVOID param) {
+    struct lk_thread *th = (struct lk_thread*)param;
+    th->fn(th->arg);
+    return 0;
+}
+#else
+static void* thread_main(void *param) {
+    struct lk_thread *th = (struct lk_thread*)param;
+    th->fn(th->arg);
+    return NULL;
+}
+#endif
+
+/**
+ * Starts a new thread that calls fn(arg)
+ *
+ * @return the result of operation:
+ *  LK_OK - the thread was started, call lk_thread_join to wait for it
+ *  LK_INVALID_ARG - th or fn is NULL
+ *  LK_OUT_OF_MEMORY - the system failed to create a thread
+ */
+lk_result lk_thread_start(struct lk_thread *th, lk_thread_func fn, void *arg) {
+    if (th == NULL || fn == NULL)
+        return LK_INVALID_ARG;
+
+    th->fn = fn;
+    th->arg = arg;
+#ifdef _WIN32
+    th->handle = CreateThread(NULL, 0, thread_main, th, 0, NULL);
+    if (th->handle == NULL)
+        return LK_OUT_OF_MEMORY;
+#else
+    if (pthread_create(&th->handle, NULL, thread_main, th) != 0)
+        return LK_OUT_OF_MEMORY;
+#endif
+
+    return LK_OK;
+}
+
+/**
+ * Waits until the thread started with lk_thread_start finishes
+ */
+void lk_thread_join(struct lk_thread *th) {
+    if (th == NULL)
+        return;
+
+#ifdef _WIN32
+    WaitForSingleObject(th->handle, INFINITE);
+    CloseHandle(th->handle);
+#else
+    pthread_join(th->handle, NULL);
+#endif
+}
+
+/**
+ * @return the number of online processors, at least 1
+ */
+size_t lk_cpu_count() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+    long cnt = sysconf(_SC_NPROCESSORS_ONLN);
+    return cnt > 0 ? (size_t)cnt : 1;
+#endif
+}
+
+/**
+ * Returns a number that was not returned before in the process. It is safe
+ *  to call it from different threads at the same time
+ */
+unsigned long long lk_unique_id() {
+#ifdef _WIN32
+    static volatile LONG64 last = 0;
+    return (unsigned long long)InterlockedIncrement64(&last);
+#else
+    static unsigned long long last = 0;
+    return __sync_add_and_fetch(&last, 1);
+#endif
+}
+
+/**
+ * @return the time of a monotonic clock in nanoseconds, it is used to
+ *  measure intervals
+ */
+unsigned long long lk_time_ns() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, cnt;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&cnt);
+    return (unsigned long long)(cnt.QuadPart / freq.QuadPart) * 1000000000ull
+        + (unsigned long long)(cnt.QuadPart % freq.QuadPart) * 1000000000ull / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Initializes a mutex
+ *
+ * @return LK_OK or LK_OUT_OF_MEMORY if the system failed to create it
+ */
+lk_result lk_mutex_init(struct lk_mutex *m) {
+#ifdef _WIN32
+    InitializeCriticalSection(&m->cs);
+#else
+    if (pthread_mutex_init(&m->m, NULL) != 0)
+        return LK_OUT_OF_MEMORY;
+#endif
+    return LK_OK;
+}
+
+void lk_mutex_free(struct lk_mutex *m) {
+#ifdef _WIN32
+    DeleteCriticalSection(&m->cs);
+#else
+    pthread_mutex_destroy(&m->m);
+#endif
+}
+
+void lk_mutex_lock(struct lk_mutex *m) {
+#ifdef _WIN32
+    EnterCriticalSection(&m->cs);
+#else
+    pthread_mutex_lock(&m->m);
+#endif
+}
+
+void lk_mutex_unlock(struct lk_mutex *m) {
+#ifdef _WIN32
+    LeaveCriticalSection(&m->cs);
+#else
+    pthread_mutex_unlock(&m->m);
+#endif
+}
+
+/**
+ * Initializes a condition variable
+ *
+ * @return LK_OK or LK_OUT_OF_MEMORY if the system failed to create it
+ */
+lk_result lk_cond_init(struct lk_cond *c) {
+#ifdef _WIN32
+    InitializeConditionVariable(&c->cv);
+#else
+    if (pthread_cond_init(&c->c, NULL) != 0)
+        return LK_OUT_OF_MEMORY;
+#endif
+    return LK_OK;
+}
+
+void lk_cond_free(struct lk_cond *c) {
+#ifdef _WIN32
+    (void)c;
+#else
+    pthread_cond_destroy(&c->c);
+#endif
+}
+
+/**
+ * Unlocks the mutex and waits until the condition is signaled. The mutex
+ *  is locked again when the function returns. The wait can end without a
+ *  signal, so the caller checks its condition in a loop
+ */
+void lk_cond_wait(struct lk_cond *c, struct lk_mutex *m) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&c->cv, &m->cs, INFINITE);
+#else
+    pthread_cond_wait(&c->c, &m->m);
+#endif
+}
+
+/**
+ * Wakes up a thread that waits for the condition
+ */
+void lk_cond_signal(struct lk_cond *c) {
+#ifdef _WIN32
+    WakeConditionVariable(&c->cv);
+#else
+    pthread_cond_signal(&c->c);
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef LKCHECKER_THREAD
+#define LKCHECKER_THREAD
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*lk_thread_func)(void *arg);
+
+/**
+ * @struct lk_thread
+ * A thread used internally by the library. The structure must stay valid
+ *  until lk_thread_join returns
+ */
+struct lk_thread {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    lk_thread_func fn; /*!< the function the thread runs */
+    void *arg; /*!< the argument of fn */
+};
+
+/**
+ * @struct lk_mutex
+ * A mutex used internally by the library
+ */
+struct lk_mutex {
+#ifdef _WIN32
+    CRITICAL_SECTION cs;
+#else
+    pthread_mutex_t m;
+#endif
+};
+
+/**
+ * @struct lk_cond
+ * A condition variable used together with lk_mutex
+ */
+struct lk_cond {
+#ifdef _WIN32
+    CONDITION_VARIABLE cv;
+#else
+    pthread_cond_t c;
+#endif
+};
+
+lk_result lk_thread_start(struct lk_thread *th, lk_thread_func fn, void *arg);
+void lk_thread_join(struct lk_thread *th);
+size_t lk_cpu_count();
+unsigned long long lk_unique_id();
+unsigned long long lk_time_ns();
+
+lk_result lk_mutex_init(struct lk_mutex *m);
+void lk_mutex_free(struct lk_mutex *m);
+void lk_mutex_lock(struct lk_mutex *m);
+void lk_mutex_unlock(struct lk_mutex *m);
+lk_result lk_cond_init(struct lk_cond *c);
+void lk_cond_free(struct lk_cond *c);
+void lk_cond_wait(struct lk_cond *c, struct lk_mutex *m);
+void lk_cond_signal(struct lk_cond *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
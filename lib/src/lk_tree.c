@@ -1,9 +1,12 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <utf8proc.h>
 #include "lk_common.h"
 #include "lk_tree.h"
+#include "lk_arena.h"
+#include "lk_utf8.h"
 
 /**
  * @struct lk_leaf
@@ -20,12 +23,64 @@ struct lk_leaf {
                                of a word then the value is NULL */
 };
 
+/* number of paths that lk_tree_walk_many walks at the same time */
+#define LK_WALK_GROUP 16
+
+#if defined(__GNUC__)
+#define LK_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define LK_PREFETCH(addr) ((void)(addr))
+#endif
+
+/**
+ * Code points below this value are mapped to trie symbols with a direct
+ *  table lookup. It covers all 1- and 2-byte UTF8 characters, so all Lakota
+ *  letters. Rare characters above it are looked up in a small sorted array
+ */
+#define LK_SYM_DIRECT 0x800
+
+/**
+ * @struct lk_datrie
+ * Read-only double-array trie compiled from the linked tree by
+ *  lk_tree_freeze. Every code point is mapped to a dense symbol number
+ *  (starting from 1) and transition from state s by symbol c leads to
+ *  state t = base[s] + c if check[t] == s. Root is state 0
+ */
+struct lk_datrie {
+    utf8proc_int32_t *base; /*!< base offset for children of a state */
+    utf8proc_int32_t *check; /*!< parent state of a state, -1 for free cells */
+    const struct lk_word_ptr **value; /*!< word list of a state, NULL for non-final states */
+    size_t size; /*!< number of cells in all three arrays */
+
+    unsigned short *sym; /*!< LK_SYM_DIRECT items: code point to symbol, 0 - no symbol */
+    utf8proc_uint32_t *wide_cp; /*!< sorted code points that are >= LK_SYM_DIRECT */
+    unsigned short *wide_sym; /*!< symbols for wide_cp items */
+    size_t wide_cnt; /*!< number of items in wide_cp */
+
+    /* the trie opened with lk_tree_open_image keeps word ids instead of lists */
+    const unsigned int *ref; /*!< position of the word list of a state in
+                               payload, 0 for non-final states */
+    const unsigned int *payload; /*!< word lists: the number of words
+                                   followed by their ids */
+    size_t payload_cnt; /*!< number of items in payload */
+    int mapped; /*!< all arrays point to read-only memory of an image and
+                  must be neither changed nor freed */
+};
+
 /**
  * @struct lk_tree
- * Suffix tree of all words read from file
+ * Suffix tree of all words read from file. All leaves and word lists are
+ *  allocated from the tree arena, so they are freed all at once
  */
 struct lk_tree {
     struct lk_leaf *head;
+    struct lk_arena arena; /*!< storage for leaves and word lists */
+    struct lk_datrie *frozen; /*!< compiled trie, if it is not NULL the tree
+                                is read-only and head is always NULL */
+    int minimized; /*!< non-zero if leaves are shared by lk_tree_minimize,
+                     such tree is read-only */
+    size_t nodes; /*!< number of leaves or trie states */
+    size_t keys; /*!< number of paths that have words */
 };
 
 /**
@@ -41,29 +96,27 @@ struct lk_tree* lk_tree_init() {
         return NULL;
 
     tree->head = NULL;
+    tree->frozen = NULL;
+    tree->minimized = 0;
+    tree->nodes = 0;
+    tree->keys = 0;
+    lk_arena_init(&tree->arena, LK_ARENA_CHUNK_SIZE);
     return tree;
 }
 
-static void free_leaf(struct lk_leaf *leaf) {
-    if (leaf == NULL)
+static void free_datrie(struct lk_datrie *da) {
+    if (da == NULL)
         return;
 
-    struct lk_word_ptr *w = leaf->word;
-    while (w) {
-        struct lk_word_ptr *next = w->next;
-        free(w);
-        w = next;
-    }
-}
-
-static void free_tree(struct lk_leaf *leaf) {
-    while (leaf) {
-        if (leaf->sibling)
-            free_tree(leaf->sibling);
-        struct lk_leaf *next = leaf;
-        free_leaf(leaf);
-        leaf = next->next;
+    if (!da->mapped) {
+        free(da->base);
+        free(da->check);
+        free((void*)da->value);
+        free(da->sym);
+        free(da->wide_cp);
+        free(da->wide_sym);
     }
+    free(da);
 }
 
 /**
@@ -72,13 +125,29 @@ static void free_tree(struct lk_leaf *leaf) {
  * @sa lk_tree_init
  */
 void lk_tree_free(struct lk_tree *tree) {
-    if (tree == NULL || tree->head == NULL)
+    if (tree == NULL)
         return;
 
-    free_tree(tree->head);
+    free_datrie(tree->frozen);
+    lk_arena_free(&tree->arena);
+    free(tree);
 }
 
-static struct lk_leaf* add_char_to_level(struct lk_leaf *start, utf8proc_uint32_t c) {
+static struct lk_leaf* new_leaf(struct lk_tree *tree, utf8proc_uint32_t c) {
+    struct lk_leaf *n = (struct lk_leaf*)lk_arena_alloc(&tree->arena, sizeof(*n));
+    if (n == NULL)
+        return NULL;
+
+    n->c = c;
+    n->sibling = NULL;
+    n->next = NULL;
+    n->word = NULL;
+    tree->nodes++;
+    return n;
+}
+
+static struct lk_leaf* add_char_to_level(struct lk_tree *tree, struct lk_leaf *start,
+        utf8proc_uint32_t c) {
     struct lk_leaf *n = start, *p = start;
     while (n) {
         if (n->c == c)
@@ -87,27 +156,25 @@ static struct lk_leaf* add_char_to_level(struct lk_leaf *start, utf8proc_uint32_
         n = n->sibling;
     }
 
-    n = (struct lk_leaf*)malloc(sizeof(*n));
+    n = new_leaf(tree, c);
     if (n == NULL)
         return NULL;
 
     p->sibling = n;
-    n->c = c;
-    n->sibling = NULL;
-    n->next = NULL;
-    n->word = NULL;
     return n;
 }
 
-static lk_result put_word_to_list(struct lk_leaf *leaf, const struct lk_word *word) {
+static lk_result put_word_to_list(struct lk_tree *tree, struct lk_leaf *leaf,
+        const struct lk_word *word) {
     if (leaf->word == NULL) {
-        struct lk_word_ptr *ptr = (struct lk_word_ptr*)malloc(sizeof(*ptr));
+        struct lk_word_ptr *ptr = (struct lk_word_ptr*)lk_arena_alloc(&tree->arena, sizeof(*ptr));
         if (ptr == NULL)
             return LK_OUT_OF_MEMORY;
 
         ptr->word = word;
         ptr->next = NULL;
         leaf->word = ptr;
+        tree->keys++;
     } else {
         struct lk_word_ptr *ptr = leaf->word, *prev = NULL;
         while (ptr != NULL) {
@@ -117,7 +184,7 @@ static lk_result put_word_to_list(struct lk_leaf *leaf, const struct lk_word *wo
             ptr = ptr->next;
         }
 
-        ptr = (struct lk_word_ptr*)malloc(sizeof(*ptr));
+        ptr = (struct lk_word_ptr*)lk_arena_alloc(&tree->arena, sizeof(*ptr));
         if (ptr == NULL)
             return LK_OUT_OF_MEMORY;
 
@@ -139,7 +206,8 @@ static lk_result put_word_to_list(struct lk_leaf *leaf, const struct lk_word *wo
  *  nothing
  *
  * @return the result of operation:
- *  LK_INVALID_ARG - tree is not initialized or any argument is NULL
+ *  LK_INVALID_ARG - tree is not initialized or any argument is NULL, or
+ *   the tree is frozen or minimized
  *  LK_INVALID_STRING - path is not UTF8 string
  *  LK_OUT_OF_MEMORY - failed to allocated memory for new data
  *  LK_OK - the word was successfully added to the tree
@@ -147,7 +215,7 @@ static lk_result put_word_to_list(struct lk_leaf *leaf, const struct lk_word *wo
  *   or the path was empty
  */
 lk_result lk_tree_add_word(struct lk_tree *tree, const char *path, const struct lk_word *word) {
-    if (tree == NULL || path == NULL || word == NULL)
+    if (tree == NULL || path == NULL || word == NULL || lk_tree_is_frozen(tree))
         return LK_INVALID_ARG;
     if (*path == '\0')
         return LK_OK;
@@ -158,20 +226,16 @@ lk_result lk_tree_add_word(struct lk_tree *tree, const char *path, const struct
 
     struct lk_leaf *leaf = tree->head, *prev_leaf = NULL;
     while (*usrc) {
-        len = utf8proc_iterate(usrc, -1, &cp);
+        len = lk_utf8_decode(usrc, -1, &cp);
         if (cp == -1)
             return LK_INVALID_STRING;
         usrc += len;
 
         if (leaf == NULL) {
-            struct lk_leaf *n = (struct lk_leaf*)malloc(sizeof(*n));
+            struct lk_leaf *n = new_leaf(tree, cp);
             if (n == NULL)
                 return LK_OUT_OF_MEMORY;
 
-            n->c = cp;
-            n->sibling = NULL;
-            n->next = NULL;
-            n->word = NULL;
             if (prev_leaf == NULL) {
                 tree->head = n;
             } else {
@@ -181,7 +245,7 @@ lk_result lk_tree_add_word(struct lk_tree *tree, const char *path, const struct
             prev_leaf = n;
             leaf = NULL;
         } else {
-            struct lk_leaf *search = add_char_to_level(leaf, cp);
+            struct lk_leaf *search = add_char_to_level(tree, leaf, cp);
             if (search == NULL)
                 return LK_OUT_OF_MEMORY;
 
@@ -190,7 +254,224 @@ lk_result lk_tree_add_word(struct lk_tree *tree, const char *path, const struct
         }
     }
 
-    return put_word_to_list(prev_leaf, word);
+    return put_word_to_list(tree, prev_leaf, word);
+}
+
+static int cmp_leaf_char(const void *a, const void *b) {
+    const struct lk_leaf *la = *(const struct lk_leaf* const*)a;
+    const struct lk_leaf *lb = *(const struct lk_leaf* const*)b;
+    return (la->c > lb->c) - (la->c < lb->c);
+}
+
+/* finds the root leaf for a character in the array sorted by cmp_leaf_char */
+static size_t find_root_leaf(struct lk_leaf **sorted, size_t cnt, utf8proc_uint32_t c) {
+    size_t lo = 0, hi = cnt;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid]->c < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < cnt && sorted[lo]->c == c) ? lo : cnt;
+}
+
+/**
+ * Moves all paths of other trees to the tree. It is used to build parts of
+ *  a big tree in parallel: the trees must not share the first characters of
+ *  paths, so subtrees are moved as is, without walking them. Leaves and word
+ *  lists are not copied, the tree takes over the memory of the parts
+ *
+ * @param[in] tree is a tree to move paths to
+ * @param[in] parts is an array of trees to merge. All trees are freed on
+ *  success and they must not be used after that
+ * @param[in] cnt is the number of items in parts
+ * @param[in] order is UTF8 string of the first characters in the order they
+ *  must be on the first level of the merged tree, so the merged tree can be
+ *  made identical to the tree built by adding all paths one by one.
+ *  Characters that are missing in order go after in the order of parts (the
+ *  tree first). It can be NULL
+ *
+ * @return the result of operation:
+ *  LK_OK - all paths are moved to the tree
+ *  LK_INVALID_ARG - any tree is NULL, frozen or minimized, or two trees
+ *   contain paths that start with the same character
+ *  LK_INVALID_STRING - order is not UTF8 string
+ *  LK_OUT_OF_MEMORY - failed to allocate memory
+ *  No tree is changed if the function fails
+ */
+lk_result lk_tree_merge(struct lk_tree *tree, struct lk_tree **parts, size_t cnt, const char *order) {
+    if (tree == NULL || lk_tree_is_frozen(tree) || (parts == NULL && cnt != 0))
+        return LK_INVALID_ARG;
+
+    size_t total = 0;
+    for (const struct lk_leaf *l = tree->head; l != NULL; l = l->sibling)
+        total++;
+    for (size_t idx = 0; idx < cnt; idx++) {
+        if (parts[idx] == NULL || parts[idx] == tree || lk_tree_is_frozen(parts[idx]))
+            return LK_INVALID_ARG;
+        for (const struct lk_leaf *l = parts[idx]->head; l != NULL; l = l->sibling)
+            total++;
+    }
+    if (total == 0)
+        return LK_OK;
+
+    /* all first level leaves: in the order of trees, sorted by character,
+     * and in the order of the merged tree */
+    struct lk_leaf **roots = (struct lk_leaf**)malloc(3 * total * sizeof(*roots));
+    char *used = (char*)calloc(total, sizeof(*used));
+    if (roots == NULL || used == NULL) {
+        free((void*)roots);
+        free(used);
+        return LK_OUT_OF_MEMORY;
+    }
+    struct lk_leaf **sorted = roots + total, **chain = roots + 2 * total;
+
+    size_t n = 0;
+    for (struct lk_leaf *l = tree->head; l != NULL; l = l->sibling)
+        roots[n++] = l;
+    for (size_t idx = 0; idx < cnt; idx++) {
+        for (struct lk_leaf *l = parts[idx]->head; l != NULL; l = l->sibling)
+            roots[n++] = l;
+    }
+    memcpy((void*)sorted, (void*)roots, total * sizeof(*roots));
+    qsort((void*)sorted, total, sizeof(*sorted), cmp_leaf_char);
+
+    lk_result res = LK_OK;
+    for (size_t idx = 1; idx < total; idx++) {
+        if (sorted[idx]->c == sorted[idx - 1]->c)
+            res = LK_INVALID_ARG;
+    }
+
+    /* leaves from order go first */
+    n = 0;
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)order;
+    while (res == LK_OK && usrc != NULL && *usrc) {
+        utf8proc_int32_t cp;
+        size_t len = lk_utf8_decode(usrc, -1, &cp);
+        if (cp == -1) {
+            res = LK_INVALID_STRING;
+            break;
+        }
+        usrc += len;
+
+        size_t pos = find_root_leaf(sorted, total, (utf8proc_uint32_t)cp);
+        if (pos == total || used[pos])
+            continue;
+        used[pos] = 1;
+        chain[n++] = sorted[pos];
+    }
+
+    if (res != LK_OK) {
+        free((void*)roots);
+        free(used);
+        return res;
+    }
+
+    for (size_t idx = 0; idx < total; idx++) {
+        if (!used[find_root_leaf(sorted, total, roots[idx]->c)])
+            chain[n++] = roots[idx];
+    }
+    for (size_t idx = 0; idx + 1 < total; idx++)
+        chain[idx]->sibling = chain[idx + 1];
+    chain[total - 1]->sibling = NULL;
+    tree->head = chain[0];
+
+    for (size_t idx = 0; idx < cnt; idx++) {
+        struct lk_tree *part = parts[idx];
+        lk_arena_merge(&tree->arena, &part->arena);
+        tree->nodes += part->nodes;
+        tree->keys += part->keys;
+        part->head = NULL;
+        lk_tree_free(part);
+    }
+
+    free((void*)roots);
+    free(used);
+    return LK_OK;
+}
+
+static unsigned short datrie_symbol(const struct lk_datrie *da, utf8proc_int32_t cp) {
+    if ((utf8proc_uint32_t)cp < LK_SYM_DIRECT)
+        return da->sym[cp];
+
+    size_t lo = 0, hi = da->wide_cnt;
+    while (lo < hi) {
+        size_t md = lo + (hi - lo) / 2;
+        if (da->wide_cp[md] == (utf8proc_uint32_t)cp)
+            return da->wide_sym[md];
+        if (da->wide_cp[md] < (utf8proc_uint32_t)cp)
+            lo = md + 1;
+        else
+            hi = md;
+    }
+
+    return 0;
+}
+
+/* returns the child state of the trie state by the code point or -1 */
+static utf8proc_int32_t datrie_next(const struct lk_datrie *da, utf8proc_int32_t state,
+        utf8proc_int32_t cp) {
+    unsigned short sym = datrie_symbol(da, cp);
+    if (sym == 0)
+        return -1;
+
+    size_t t = (size_t)da->base[state] + sym;
+    if (t >= da->size || da->check[t] != state)
+        return -1;
+    return (utf8proc_int32_t)t;
+}
+
+/* returns the state of the trie that corresponds to the path or -1 */
+static utf8proc_int32_t datrie_walk(const struct lk_datrie *da, const char *path) {
+    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)path;
+    utf8proc_int32_t cp, state = 0;
+
+    while (*usrc) {
+        size_t len = lk_utf8_decode(usrc, -1, &cp);
+        if (cp == -1)
+            return -1;
+        usrc += len;
+
+        state = datrie_next(da, state, cp);
+        if (state == -1)
+            return -1;
+    }
+
+    return state;
+}
+
+/* returns the leaf of the level that contains the code point or NULL */
+static const struct lk_leaf* find_in_level(const struct lk_leaf *level, utf8proc_int32_t cp) {
+    while (level != NULL) {
+        if (level->c == (utf8proc_uint32_t)cp)
+            return level;
+        level = level->sibling;
+    }
+    return NULL;
+}
+
+/* returns the ids of the word list of an image trie state */
+static lk_result datrie_ids(const struct lk_datrie *da, utf8proc_int32_t state,
+        const unsigned int **ids, size_t *count) {
+    if (state <= 0 || da->ref[state] == 0)
+        return LK_WORD_NOT_FOUND;
+
+    size_t pos = da->ref[state];
+    if (pos >= da->payload_cnt || da->payload[pos] > da->payload_cnt - pos - 1)
+        return LK_WORD_NOT_FOUND;
+
+    *count = da->payload[pos];
+    *ids = da->payload + pos + 1;
+    return LK_OK;
+}
+
+static const struct lk_word_ptr* datrie_search(const struct lk_datrie *da, const char *path) {
+    if (da->mapped)
+        return NULL;
+
+    utf8proc_int32_t state = datrie_walk(da, path);
+    return (state == -1) ? NULL : da->value[state];
 }
 
 /**
@@ -200,30 +481,26 @@ lk_result lk_tree_add_word(struct lk_tree *tree, const char *path, const struct
  *  @returns NULL in case of error or if the path was not found in the tree.
  *   In case of success it returns the list of associated structs.
  *   DO NOT free or modify the result - it points to internal data.
+ *   A tree opened with lk_tree_open_image always returns NULL, use
+ *   lk_tree_search_ids for it
  */
 const struct lk_word_ptr* lk_tree_search(const struct lk_tree *tree, const char *path) {
     if (tree == NULL || path == NULL || *path == '\0')
         return NULL;
+    if (tree->frozen != NULL)
+        return datrie_search(tree->frozen, path);
 
     utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)path;
     utf8proc_int32_t cp;
     const struct lk_leaf *leaf = tree->head;
 
     while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cp);
+        size_t len = lk_utf8_decode(usrc, -1, &cp);
         if (cp == -1)
             return NULL;
         usrc += len;
 
-        const struct lk_leaf *search = NULL, *item = leaf;
-        while (item != NULL) {
-            if (item->c == cp) {
-                search = item;
-                break;
-            }
-            item = item->sibling;
-        }
-
+        const struct lk_leaf *search = find_in_level(leaf, cp);
         if (search == NULL)
             return NULL;
 
@@ -236,3 +513,1291 @@ const struct lk_word_ptr* lk_tree_search(const struct lk_tree *tree, const char
     return leaf->word;
 }
 
+/**
+ * Length-delimited version of lk_tree_search: the path is len bytes long and
+ *  does not have to end with zero, so a word is looked up right in the text
+ *
+ * @sa lk_tree_search
+ */
+const struct lk_word_ptr* lk_tree_search_n(const struct lk_tree *tree, const char *path, size_t len) {
+    if (tree == NULL || path == NULL || len == 0)
+        return NULL;
+
+    struct lk_tree_pos pos;
+    lk_tree_root(tree, &pos);
+    if (lk_tree_step(tree, &pos, path, len, NULL) != LK_OK)
+        return NULL;
+    return lk_tree_pos_words(tree, &pos);
+}
+
+/**
+ * Sets the position to the root of the tree, so lk_tree_step starts
+ *  walking a path from its first character
+ *
+ * @sa lk_tree_step
+ */
+void lk_tree_root(const struct lk_tree *tree, struct lk_tree_pos *pos) {
+    if (pos == NULL)
+        return;
+
+    pos->leaf = NULL;
+    pos->state = (tree == NULL) ? -1 : 0;
+}
+
+/* moves the position that is in the tree to the child by the code point */
+static void step_char(const struct lk_tree *tree, struct lk_tree_pos *pos, utf8proc_int32_t cp) {
+    if (tree->frozen != NULL) {
+        pos->state = datrie_next(tree->frozen, (utf8proc_int32_t)pos->state, cp);
+        return;
+    }
+
+    const struct lk_leaf *level = (pos->leaf == NULL) ? tree->head
+        : ((const struct lk_leaf*)pos->leaf)->next;
+    pos->leaf = find_in_level(level, cp);
+    if (pos->leaf == NULL)
+        pos->state = -1;
+}
+
+/**
+ * Moves the position down the tree by len bytes of the path. A caller that
+ *  looks up many paths with a common prefix walks the prefix once and then
+ *  continues from a copy of its position or from a position saved in trail.
+ *  The part of the path must contain only whole UTF8 characters
+ *
+ * @param[in] tree is the tree to walk
+ * @param[in,out] pos is a position set by lk_tree_root or lk_tree_step
+ * @param[in] path is the next part of the path
+ * @param[in] len is the length of the part in bytes
+ * @param[out] trail is NULL or an array of len items. trail[i] receives the
+ *  position after byte i if the byte ends a character. When the path leaves
+ *  the tree, positions of all the rest characters are set as well
+ *
+ * @return the result of operation:
+ *  LK_OK - the tree contains the path up to the new position
+ *  LK_WORD_NOT_FOUND - the tree has no such path. All further steps from
+ *   the position fail as well
+ *  LK_INVALID_STRING - the part is not a valid UTF8 string
+ *  LK_INVALID_ARG - any argument is NULL
+ */
+lk_result lk_tree_step(const struct lk_tree *tree, struct lk_tree_pos *pos,
+        const char *path, size_t len, struct lk_tree_pos *trail) {
+    if (tree == NULL || pos == NULL || path == NULL)
+        return LK_INVALID_ARG;
+
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)path;
+    lk_result res = LK_OK;
+    size_t done = 0;
+    utf8proc_int32_t cp;
+    while (done < len && pos->state != -1) {
+        utf8proc_ssize_t clen = 1;
+        if (usrc[done] < 0x80) {
+            cp = usrc[done];
+        } else {
+            clen = lk_utf8_decode(usrc + done, (utf8proc_ssize_t)(len - done), &cp);
+            if (clen <= 0 || cp == -1) {
+                pos->leaf = NULL;
+                pos->state = -1;
+                res = LK_INVALID_STRING;
+                break;
+            }
+        }
+        done += (size_t)clen;
+
+        step_char(tree, pos, cp);
+        if (trail != NULL)
+            trail[done - 1] = *pos;
+    }
+
+    if (pos->state == -1 && res == LK_OK)
+        res = LK_WORD_NOT_FOUND;
+    if (trail != NULL) {
+        /* the rest of the path is not in the tree */
+        for (; done < len; done++) {
+            if (done + 1 == len || (usrc[done + 1] & 0xC0) != 0x80)
+                trail[done] = *pos;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Moves the position down the tree by one character. It is lk_tree_step
+ *  for a caller that has already decoded the path, e.g. to convert the
+ *  characters on the way
+ *
+ * @param[in] tree is the tree to walk
+ * @param[in,out] pos is a position set by lk_tree_root or lk_tree_step
+ * @param[in] cp is the code point of the character
+ *
+ * @return LK_OK, LK_WORD_NOT_FOUND if the tree has no such path, or
+ *  LK_INVALID_ARG if tree or pos is NULL
+ *
+ * @sa lk_tree_step
+ */
+lk_result lk_tree_step_char(const struct lk_tree *tree, struct lk_tree_pos *pos, unsigned int cp) {
+    if (tree == NULL || pos == NULL)
+        return LK_INVALID_ARG;
+
+    if (pos->state != -1)
+        step_char(tree, pos, (utf8proc_int32_t)cp);
+    return pos->state == -1 ? LK_WORD_NOT_FOUND : LK_OK;
+}
+
+/**
+ * Returns the list of words associated with the path that leads to the
+ *  position. The rules are the same as for lk_tree_search: NULL for the root,
+ *  for a path without words and for a tree opened with lk_tree_open_image
+ *
+ * @sa lk_tree_step
+ * @sa lk_tree_search
+ */
+const struct lk_word_ptr* lk_tree_pos_words(const struct lk_tree *tree,
+        const struct lk_tree_pos *pos) {
+    if (tree == NULL || pos == NULL || pos->state == -1)
+        return NULL;
+
+    if (tree->frozen != NULL) {
+        if (tree->frozen->mapped || pos->state == 0)
+            return NULL;
+        return tree->frozen->value[pos->state];
+    }
+
+    return (pos->leaf == NULL) ? NULL : ((const struct lk_leaf*)pos->leaf)->word;
+}
+
+/**
+ * @struct lk_walk
+ * One path of lk_tree_walk_many that is being walked
+ */
+struct lk_walk {
+    const utf8proc_uint8_t *rest; /*!< the part of the path after cp */
+    utf8proc_int32_t cp; /*!< the character the walk looks for */
+    const struct lk_leaf *leaf; /*!< linked tree: the leaf to compare with cp */
+    utf8proc_int32_t state; /*!< trie: the current state */
+    size_t cell; /*!< trie: the cell of the child state by cp */
+    size_t idx; /*!< index of the path */
+};
+
+/* decodes the next character of the walk. Returns 0 at the end of the path
+ * and -1 for an invalid string */
+static int walk_next_char(struct lk_walk *w) {
+    if (*w->rest == '\0')
+        return 0;
+    if (*w->rest < 0x80) {
+        w->cp = *w->rest++;
+        return 1;
+    }
+
+    utf8proc_ssize_t len = lk_utf8_decode(w->rest, -1, &w->cp);
+    if (len <= 0 || w->cp == -1)
+        return -1;
+    w->rest += len;
+    return 1;
+}
+
+/* marks the position of the walk as not in the tree, the same way as
+ * lk_tree_step does */
+static void walk_dead(struct lk_tree_pos *pos) {
+    pos->leaf = NULL;
+    pos->state = -1;
+}
+
+/* starts looking for the current character of the walk: finds the cell of
+ * the child state or the first leaf of the level and prefetches it.
+ * Returns 0 if the walk is over */
+static int walk_start_char(const struct lk_tree *tree, struct lk_walk *w,
+        const struct lk_leaf *level) {
+    const struct lk_datrie *da = tree->frozen;
+    if (da == NULL) {
+        w->leaf = level;
+        LK_PREFETCH(level);
+        return level != NULL;
+    }
+
+    unsigned short sym = datrie_symbol(da, w->cp);
+    if (sym == 0)
+        return 0;
+    w->cell = (size_t)da->base[w->state] + sym;
+    if (w->cell >= da->size)
+        return 0;
+    LK_PREFETCH(&da->check[w->cell]);
+    LK_PREFETCH(&da->base[w->cell]);
+    return 1;
+}
+
+/* starts the walk of the path. Returns 0 if it ends at once and pos is set */
+static int walk_init(const struct lk_tree *tree, struct lk_walk *w, const char *path,
+        size_t idx, struct lk_tree_pos *pos) {
+    w->rest = (const utf8proc_uint8_t*)path;
+    w->idx = idx;
+    w->state = 0;
+    lk_tree_root(tree, &pos[idx]);
+
+    int next = walk_next_char(w);
+    if (next == 1 && walk_start_char(tree, w, tree->head))
+        return 1;
+    if (next != 0)
+        walk_dead(&pos[idx]);
+    return 0;
+}
+
+/* moves the walk one memory access further. Returns 0 when the walk is over
+ * and its position is set */
+static int walk_advance(const struct lk_tree *tree, struct lk_walk *w, struct lk_tree_pos *pos) {
+    const struct lk_datrie *da = tree->frozen;
+    const struct lk_leaf *level = NULL;
+
+    if (da == NULL) {
+        if (w->leaf->c != (utf8proc_uint32_t)w->cp) {
+            w->leaf = w->leaf->sibling;
+            LK_PREFETCH(w->leaf);
+            if (w->leaf != NULL)
+                return 1;
+            walk_dead(&pos[w->idx]);
+            return 0;
+        }
+        pos[w->idx].leaf = w->leaf;
+        level = w->leaf->next;
+    } else {
+        if (da->check[w->cell] != w->state) {
+            walk_dead(&pos[w->idx]);
+            return 0;
+        }
+        w->state = (utf8proc_int32_t)w->cell;
+        pos[w->idx].state = w->state;
+    }
+
+    int next = walk_next_char(w);
+    if (next == 1 && walk_start_char(tree, w, level))
+        return 1;
+    if (next != 0)
+        walk_dead(&pos[w->idx]);
+    return 0;
+}
+
+/**
+ * Walks many paths at once and sets the position where every path ends.
+ *  Nodes of a big tree are rarely in the CPU cache, so the function keeps
+ *  LK_WALK_GROUP walks in progress: every walk prefetches the node it needs
+ *  next and the other walks are moved while the memory is being read. A walk
+ *  that is over gives its place to the next path
+ *
+ * @param[in] tree is the tree to walk
+ * @param[in] paths is an array of n UTF8 paths
+ * @param[in] n is the number of paths
+ * @param[out] pos is an array of n items. pos[i] receives the same position
+ *  as lk_tree_step for the whole paths[i] from the root, the position state
+ *  is -1 if the path is not in the tree or it is not a valid UTF8 string
+ *
+ * @return the result of operation:
+ *  LK_OK - all paths were walked
+ *  LK_INVALID_ARG - any argument or path is NULL
+ *
+ * @sa lk_tree_step
+ * @sa lk_tree_pos_words
+ */
+lk_result lk_tree_walk_many(const struct lk_tree *tree, const char **paths, size_t n,
+        struct lk_tree_pos *pos) {
+    if (tree == NULL || (n != 0 && (paths == NULL || pos == NULL)))
+        return LK_INVALID_ARG;
+    for (size_t idx = 0; idx < n; idx++) {
+        if (paths[idx] == NULL)
+            return LK_INVALID_ARG;
+    }
+
+    struct lk_walk walks[LK_WALK_GROUP];
+    size_t active = 0, next = 0;
+    while (active < LK_WALK_GROUP && next < n) {
+        if (walk_init(tree, &walks[active], paths[next], next, pos))
+            active++;
+        next++;
+    }
+
+    while (active != 0) {
+        for (size_t idx = 0; idx < active; ) {
+            if (walk_advance(tree, &walks[idx], pos)) {
+                idx++;
+                continue;
+            }
+
+            /* the walk is over, start the next path in its place */
+            int started = 0;
+            while (!started && next < n) {
+                started = walk_init(tree, &walks[idx], paths[next], next, pos);
+                next++;
+            }
+            if (!started)
+                walks[idx] = walks[--active];
+        }
+    }
+
+    return LK_OK;
+}
+
+
+/**
+ * @struct lk_sym_count
+ * Used by lk_tree_freeze to collect all characters of the tree
+ */
+struct lk_sym_count {
+    utf8proc_uint32_t cp;
+    size_t cnt;
+};
+
+/**
+ * @struct lk_da_builder
+ * Temporary data used by lk_tree_freeze to place states into double array
+ */
+struct lk_da_builder {
+    struct lk_datrie *da;
+    size_t cap; /*!< allocated number of cells */
+    size_t used; /*!< the biggest occupied cell + 1 */
+    utf8proc_int32_t *next_free; /*!< list of free cells in ascending order */
+    utf8proc_int32_t *prev_free;
+    utf8proc_int32_t free_head;
+    utf8proc_int32_t free_tail;
+    size_t states; /*!< number of occupied cells */
+
+    unsigned short *syms; /*!< stack of children symbols of states being placed */
+    const struct lk_leaf **leaves; /*!< stack of children of states being placed */
+    size_t stack_cap;
+};
+
+static lk_result count_symbols(const struct lk_leaf *leaf, struct lk_sym_count *direct,
+        struct lk_sym_count **wide, size_t *wide_cnt) {
+    while (leaf != NULL) {
+        if (leaf->c < LK_SYM_DIRECT) {
+            direct[leaf->c].cnt++;
+        } else {
+            size_t idx = 0;
+            while (idx < *wide_cnt && (*wide)[idx].cp != leaf->c)
+                idx++;
+            if (idx == *wide_cnt) {
+                struct lk_sym_count *w = (struct lk_sym_count*)realloc(*wide,
+                        (idx + 1) * sizeof(**wide));
+                if (w == NULL)
+                    return LK_OUT_OF_MEMORY;
+                w[idx].cp = leaf->c;
+                w[idx].cnt = 0;
+                *wide = w;
+                (*wide_cnt)++;
+            }
+            (*wide)[idx].cnt++;
+        }
+
+        lk_result res = count_symbols(leaf->next, direct, wide, wide_cnt);
+        if (res != LK_OK)
+            return res;
+        leaf = leaf->sibling;
+    }
+
+    return LK_OK;
+}
+
+static int cmp_sym_count(const void *a, const void *b) {
+    const struct lk_sym_count *sa = (const struct lk_sym_count*)a;
+    const struct lk_sym_count *sb = (const struct lk_sym_count*)b;
+    if (sa->cnt != sb->cnt)
+        return sa->cnt < sb->cnt ? 1 : -1;
+    return sa->cp < sb->cp ? -1 : (sa->cp > sb->cp);
+}
+
+static int cmp_wide_cp(const void *a, const void *b) {
+    const struct lk_sym_count *sa = (const struct lk_sym_count*)a;
+    const struct lk_sym_count *sb = (const struct lk_sym_count*)b;
+    return sa->cp < sb->cp ? -1 : (sa->cp > sb->cp);
+}
+
+/* assigns dense symbol numbers: the most frequent characters get the least numbers */
+static lk_result build_symbols(const struct lk_tree *tree, struct lk_datrie *da) {
+    struct lk_sym_count *all = (struct lk_sym_count*)calloc(LK_SYM_DIRECT, sizeof(*all));
+    if (all == NULL)
+        return LK_OUT_OF_MEMORY;
+    for (size_t idx = 0; idx < LK_SYM_DIRECT; idx++)
+        all[idx].cp = idx;
+
+    da->sym = (unsigned short*)calloc(LK_SYM_DIRECT, sizeof(*da->sym));
+    if (da->sym == NULL) {
+        free(all);
+        return LK_OUT_OF_MEMORY;
+    }
+
+    struct lk_sym_count *wide = NULL;
+    size_t wide_cnt = 0;
+    lk_result res = count_symbols(tree->head, all, &wide, &wide_cnt);
+    if (res == LK_OK && LK_SYM_DIRECT + wide_cnt > 0xFFFF)
+        res = LK_BUFFER_SMALL;
+    if (res == LK_OK && wide_cnt > 0) {
+        da->wide_cp = (utf8proc_uint32_t*)malloc(wide_cnt * sizeof(*da->wide_cp));
+        da->wide_sym = (unsigned short*)malloc(wide_cnt * sizeof(*da->wide_sym));
+        if (da->wide_cp == NULL || da->wide_sym == NULL)
+            res = LK_OUT_OF_MEMORY;
+    }
+    if (res != LK_OK) {
+        free(all);
+        free(wide);
+        return res;
+    }
+
+    qsort(all, LK_SYM_DIRECT, sizeof(*all), cmp_sym_count);
+    if (wide_cnt > 0)
+        qsort(wide, wide_cnt, sizeof(*wide), cmp_sym_count);
+    /* merge two lists sorted by frequency */
+    unsigned short sym = 1;
+    size_t di = 0, wi = 0;
+    while ((di < LK_SYM_DIRECT && all[di].cnt > 0) || wi < wide_cnt) {
+        if (wi >= wide_cnt || (di < LK_SYM_DIRECT && all[di].cnt >= wide[wi].cnt)) {
+            da->sym[all[di++].cp] = sym++;
+        } else {
+            wide[wi++].cnt = sym++;
+        }
+    }
+
+    /* wide characters are looked up with binary search */
+    if (wide_cnt > 0)
+        qsort(wide, wide_cnt, sizeof(*wide), cmp_wide_cp);
+    for (size_t idx = 0; idx < wide_cnt; idx++) {
+        da->wide_cp[idx] = wide[idx].cp;
+        da->wide_sym[idx] = (unsigned short)wide[idx].cnt;
+    }
+    da->wide_cnt = wide_cnt;
+
+    free(all);
+    free(wide);
+    return LK_OK;
+}
+
+static lk_result builder_grow(struct lk_da_builder *b, size_t need) {
+    if (need <= b->cap)
+        return LK_OK;
+
+    size_t cap = b->cap * 2;
+    if (cap < need)
+        cap = need;
+
+    utf8proc_int32_t *base = (utf8proc_int32_t*)realloc(b->da->base, cap * sizeof(*base));
+    if (base == NULL)
+        return LK_OUT_OF_MEMORY;
+    b->da->base = base;
+    utf8proc_int32_t *check = (utf8proc_int32_t*)realloc(b->da->check, cap * sizeof(*check));
+    if (check == NULL)
+        return LK_OUT_OF_MEMORY;
+    b->da->check = check;
+    const struct lk_word_ptr **value = (const struct lk_word_ptr**)realloc((void*)b->da->value,
+            cap * sizeof(*value));
+    if (value == NULL)
+        return LK_OUT_OF_MEMORY;
+    b->da->value = value;
+    utf8proc_int32_t *next_free = (utf8proc_int32_t*)realloc(b->next_free, cap * sizeof(*next_free));
+    if (next_free == NULL)
+        return LK_OUT_OF_MEMORY;
+    b->next_free = next_free;
+    utf8proc_int32_t *prev_free = (utf8proc_int32_t*)realloc(b->prev_free, cap * sizeof(*prev_free));
+    if (prev_free == NULL)
+        return LK_OUT_OF_MEMORY;
+    b->prev_free = prev_free;
+
+    /* append new cells to the end of free list */
+    for (size_t idx = b->cap; idx < cap; idx++) {
+        base[idx] = 0;
+        check[idx] = -1;
+        value[idx] = NULL;
+        next_free[idx] = -1;
+        prev_free[idx] = b->free_tail;
+        if (b->free_tail == -1)
+            b->free_head = (utf8proc_int32_t)idx;
+        else
+            next_free[b->free_tail] = (utf8proc_int32_t)idx;
+        b->free_tail = (utf8proc_int32_t)idx;
+    }
+    b->cap = cap;
+
+    return LK_OK;
+}
+
+static void builder_occupy(struct lk_da_builder *b, utf8proc_int32_t cell, utf8proc_int32_t parent) {
+    utf8proc_int32_t prev = b->prev_free[cell], next = b->next_free[cell];
+    if (prev == -1)
+        b->free_head = next;
+    else
+        b->next_free[prev] = next;
+    if (next == -1)
+        b->free_tail = prev;
+    else
+        b->prev_free[next] = prev;
+
+    b->da->check[cell] = parent;
+    if ((size_t)cell >= b->used)
+        b->used = cell + 1;
+    b->states++;
+}
+
+/* looks for the first base that fits all children symbols (sorted ascending) */
+static lk_result builder_find_base(struct lk_da_builder *b, const unsigned short *syms,
+        size_t cnt, utf8proc_int32_t *found) {
+    if (b->free_head == -1) {
+        lk_result res = builder_grow(b, b->cap + 1);
+        if (res != LK_OK)
+            return res;
+    }
+
+    utf8proc_int32_t cell = b->free_head;
+    for (;;) {
+        utf8proc_int32_t base = cell - syms[0];
+        if (base >= 1) {
+            lk_result res = builder_grow(b, (size_t)base + syms[cnt - 1] + 1);
+            if (res != LK_OK)
+                return res;
+
+            size_t idx = 1;
+            while (idx < cnt && b->da->check[base + syms[idx]] == -1)
+                idx++;
+            if (idx == cnt) {
+                *found = base;
+                return LK_OK;
+            }
+        }
+
+        if (b->next_free[cell] == -1) {
+            lk_result res = builder_grow(b, b->cap + 1);
+            if (res != LK_OK)
+                return res;
+        }
+        cell = b->next_free[cell];
+    }
+}
+
+static unsigned short builder_symbol(const struct lk_datrie *da, utf8proc_uint32_t cp) {
+    return datrie_symbol(da, (utf8proc_int32_t)cp);
+}
+
+/* places all children of the state and then recursively their children */
+static lk_result builder_place(struct lk_da_builder *b, utf8proc_int32_t state,
+        const struct lk_leaf *level, size_t top) {
+    size_t cnt = 0;
+    for (const struct lk_leaf *leaf = level; leaf != NULL; leaf = leaf->sibling)
+        cnt++;
+    if (cnt == 0)
+        return LK_OK;
+
+    if (top + cnt > b->stack_cap) {
+        size_t cap = (top + cnt) * 2;
+        unsigned short *syms = (unsigned short*)realloc(b->syms, cap * sizeof(*syms));
+        if (syms == NULL)
+            return LK_OUT_OF_MEMORY;
+        b->syms = syms;
+        const struct lk_leaf **leaves = (const struct lk_leaf**)realloc((void*)b->leaves,
+                cap * sizeof(*leaves));
+        if (leaves == NULL)
+            return LK_OUT_OF_MEMORY;
+        b->leaves = leaves;
+        b->stack_cap = cap;
+    }
+
+    /* sort children by symbol with insertion sort - most levels are short */
+    size_t n = 0;
+    for (const struct lk_leaf *leaf = level; leaf != NULL; leaf = leaf->sibling) {
+        unsigned short sym = builder_symbol(b->da, leaf->c);
+        size_t pos = top + n;
+        while (pos > top && b->syms[pos - 1] > sym) {
+            b->syms[pos] = b->syms[pos - 1];
+            b->leaves[pos] = b->leaves[pos - 1];
+            pos--;
+        }
+        b->syms[pos] = sym;
+        b->leaves[pos] = leaf;
+        n++;
+    }
+
+    utf8proc_int32_t base;
+    lk_result res = builder_find_base(b, b->syms + top, cnt, &base);
+    if (res != LK_OK)
+        return res;
+
+    b->da->base[state] = base;
+    for (size_t idx = 0; idx < cnt; idx++) {
+        utf8proc_int32_t child = base + b->syms[top + idx];
+        builder_occupy(b, child, state);
+        b->da->value[child] = b->leaves[top + idx]->word;
+    }
+
+    for (size_t idx = 0; idx < cnt; idx++) {
+        utf8proc_int32_t child = base + b->syms[top + idx];
+        res = builder_place(b, child, b->leaves[top + idx]->next, top + cnt);
+        if (res != LK_OK)
+            return res;
+    }
+
+    return LK_OK;
+}
+
+/* moves all word lists to a new arena, so the memory used by leaves is released */
+static lk_result move_word_lists(struct lk_tree *tree, struct lk_datrie *da) {
+    struct lk_arena arena;
+    lk_arena_init(&arena, LK_ARENA_CHUNK_SIZE);
+
+    for (size_t idx = 0; idx < da->size; idx++) {
+        const struct lk_word_ptr *src = da->value[idx];
+        struct lk_word_ptr *head = NULL, *tail = NULL;
+        while (src != NULL) {
+            struct lk_word_ptr *ptr = (struct lk_word_ptr*)lk_arena_alloc(&arena, sizeof(*ptr));
+            if (ptr == NULL) {
+                lk_arena_free(&arena);
+                return LK_OUT_OF_MEMORY;
+            }
+            ptr->word = src->word;
+            ptr->next = NULL;
+            if (tail == NULL)
+                head = ptr;
+            else
+                tail->next = ptr;
+            tail = ptr;
+            src = src->next;
+        }
+        da->value[idx] = head;
+    }
+
+    lk_arena_free(&tree->arena);
+    tree->arena = arena;
+    tree->head = NULL;
+    tree->minimized = 0;
+    return LK_OK;
+}
+
+/**
+ * Compiles the tree into a double-array trie. After that lk_tree_search looks
+ *  up every character with a couple of array reads instead of walking sibling
+ *  lists. The linked tree is released, so a frozen tree is read-only:
+ *  lk_tree_add_word fails with LK_INVALID_ARG. Freezing a frozen tree does
+ *  nothing. Pointers returned by lk_tree_search before freezing become invalid
+ *
+ * @return the result of operation:
+ *  LK_OK - the tree was frozen successfully
+ *  LK_INVALID_ARG - tree is NULL
+ *  LK_OUT_OF_MEMORY - failed to allocated memory for the trie. The tree is
+ *   left unchanged and it is still usable
+ *  LK_BUFFER_SMALL - the tree contains too many different characters
+ */
+lk_result lk_tree_freeze(struct lk_tree *tree) {
+    if (tree == NULL)
+        return LK_INVALID_ARG;
+    if (tree->frozen != NULL)
+        return LK_OK;
+
+    struct lk_datrie *da = (struct lk_datrie*)calloc(1, sizeof(*da));
+    if (da == NULL)
+        return LK_OUT_OF_MEMORY;
+
+    struct lk_da_builder b;
+    memset(&b, 0, sizeof(b));
+    b.da = da;
+    b.free_head = -1;
+    b.free_tail = -1;
+
+    lk_result res = build_symbols(tree, da);
+    if (res == LK_OK)
+        res = builder_grow(&b, 1024);
+    if (res == LK_OK) {
+        /* root is never a target of any transition */
+        builder_occupy(&b, 0, -2);
+        res = builder_place(&b, 0, tree->head, 0);
+    }
+
+    free(b.next_free);
+    free(b.prev_free);
+    free(b.syms);
+    free((void*)b.leaves);
+
+    if (res == LK_OK) {
+        /* trim unused tail of the arrays */
+        da->size = b.used;
+        utf8proc_int32_t *base = (utf8proc_int32_t*)realloc(da->base, da->size * sizeof(*base));
+        if (base != NULL)
+            da->base = base;
+        utf8proc_int32_t *check = (utf8proc_int32_t*)realloc(da->check, da->size * sizeof(*check));
+        if (check != NULL)
+            da->check = check;
+        const struct lk_word_ptr **value = (const struct lk_word_ptr**)realloc((void*)da->value,
+                da->size * sizeof(*value));
+        if (value != NULL)
+            da->value = value;
+
+        res = move_word_lists(tree, da);
+    }
+
+    if (res != LK_OK) {
+        free_datrie(da);
+        return res;
+    }
+
+    tree->frozen = da;
+    /* root state is not counted as it does not hold any character */
+    tree->nodes = b.states - 1;
+    return LK_OK;
+}
+
+/**
+ * @return non-zero if the tree was compiled with lk_tree_freeze or
+ *  lk_tree_minimize and it is read-only
+ */
+int lk_tree_is_frozen(const struct lk_tree *tree) {
+    return tree != NULL && (tree->frozen != NULL || tree->minimized);
+}
+
+/**
+ * @struct lk_dawg
+ * Temporary data used by lk_tree_minimize: hash tables of unique leaves and
+ *  unique word lists that are already copied to the new arena
+ */
+struct lk_dawg {
+    struct lk_arena arena; /*!< storage for the minimized tree */
+    struct lk_leaf **leaves; /*!< hash table of unique leaves */
+    size_t leaves_cap;
+    size_t leaves_cnt;
+    struct lk_word_ptr **lists; /*!< hash table of unique word lists */
+    size_t lists_cap;
+    size_t lists_cnt;
+};
+
+static size_t hash_mix(size_t h, const void *ptr) {
+    size_t v = (size_t)ptr;
+    h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+static size_t hash_leaf(const struct lk_leaf *leaf) {
+    size_t h = leaf->c;
+    h = hash_mix(h, leaf->word);
+    h = hash_mix(h, leaf->next);
+    return hash_mix(h, leaf->sibling);
+}
+
+static size_t hash_list(const struct lk_word_ptr *list) {
+    size_t h = 0;
+    for (; list != NULL; list = list->next)
+        h = hash_mix(h, list->word);
+    return h;
+}
+
+static int same_lists(const struct lk_word_ptr *a, const struct lk_word_ptr *b) {
+    while (a != NULL && b != NULL) {
+        if (a->word != b->word)
+            return 0;
+        a = a->next;
+        b = b->next;
+    }
+    return a == b;
+}
+
+/* generic growth of open addressing table of pointers */
+static lk_result dawg_rehash(void ***table, size_t *cap, size_t (*hash)(const void*)) {
+    size_t new_cap = (*cap == 0) ? 1024 : *cap * 2;
+    void **items = (void**)calloc(new_cap, sizeof(void*));
+    if (items == NULL)
+        return LK_OUT_OF_MEMORY;
+
+    for (size_t idx = 0; idx < *cap; idx++) {
+        void *item = (*table)[idx];
+        if (item == NULL)
+            continue;
+        size_t pos = hash(item) & (new_cap - 1);
+        while (items[pos] != NULL)
+            pos = (pos + 1) & (new_cap - 1);
+        items[pos] = item;
+    }
+
+    free(*table);
+    *table = items;
+    *cap = new_cap;
+    return LK_OK;
+}
+
+static size_t hash_leaf_item(const void *item) {
+    return hash_leaf((const struct lk_leaf*)item);
+}
+
+static size_t hash_list_item(const void *item) {
+    return hash_list((const struct lk_word_ptr*)item);
+}
+
+/* returns the shared copy of the word list */
+static lk_result dawg_list(struct lk_dawg *d, const struct lk_word_ptr *src,
+        struct lk_word_ptr **out) {
+    *out = NULL;
+    if (src == NULL)
+        return LK_OK;
+
+    if ((d->lists_cnt + 1) * 2 > d->lists_cap) {
+        lk_result res = dawg_rehash((void***)&d->lists, &d->lists_cap, hash_list_item);
+        if (res != LK_OK)
+            return res;
+    }
+
+    size_t pos = hash_list(src) & (d->lists_cap - 1);
+    while (d->lists[pos] != NULL) {
+        if (same_lists(d->lists[pos], src)) {
+            *out = d->lists[pos];
+            return LK_OK;
+        }
+        pos = (pos + 1) & (d->lists_cap - 1);
+    }
+
+    struct lk_word_ptr *head = NULL, *tail = NULL;
+    for (; src != NULL; src = src->next) {
+        struct lk_word_ptr *ptr = (struct lk_word_ptr*)lk_arena_alloc(&d->arena, sizeof(*ptr));
+        if (ptr == NULL)
+            return LK_OUT_OF_MEMORY;
+        ptr->word = src->word;
+        ptr->next = NULL;
+        if (tail == NULL)
+            head = ptr;
+        else
+            tail->next = ptr;
+        tail = ptr;
+    }
+
+    d->lists[pos] = head;
+    d->lists_cnt++;
+    *out = head;
+    return LK_OK;
+}
+
+/* number of leaves of a level that are sorted without allocating memory */
+#define LK_DAWG_LEVEL 64
+
+static lk_result dawg_level(struct lk_dawg *d, const struct lk_leaf *level, struct lk_leaf **out);
+
+/* returns the shared copy of the leaf followed by already shared siblings */
+static lk_result dawg_leaf(struct lk_dawg *d, const struct lk_leaf *leaf, struct lk_leaf *sibling,
+        struct lk_leaf **out) {
+    struct lk_leaf key;
+    key.c = leaf->c;
+    key.sibling = sibling;
+    lk_result res = dawg_level(d, leaf->next, &key.next);
+    if (res == LK_OK)
+        res = dawg_list(d, leaf->word, &key.word);
+    if (res != LK_OK)
+        return res;
+
+    if ((d->leaves_cnt + 1) * 2 > d->leaves_cap) {
+        res = dawg_rehash((void***)&d->leaves, &d->leaves_cap, hash_leaf_item);
+        if (res != LK_OK)
+            return res;
+    }
+
+    size_t pos = hash_leaf(&key) & (d->leaves_cap - 1);
+    while (d->leaves[pos] != NULL) {
+        const struct lk_leaf *item = d->leaves[pos];
+        if (item->c == key.c && item->word == key.word && item->next == key.next
+                && item->sibling == key.sibling) {
+            *out = d->leaves[pos];
+            return LK_OK;
+        }
+        pos = (pos + 1) & (d->leaves_cap - 1);
+    }
+
+    struct lk_leaf *n = (struct lk_leaf*)lk_arena_alloc(&d->arena, sizeof(*n));
+    if (n == NULL)
+        return LK_OUT_OF_MEMORY;
+    *n = key;
+
+    d->leaves[pos] = n;
+    d->leaves_cnt++;
+    *out = n;
+    return LK_OK;
+}
+
+/* returns the shared copy of a level. The characters are sorted in a
+ * temporary array, so equal levels always have the same order and the
+ * source tree is not changed even if minimizing fails */
+static lk_result dawg_level(struct lk_dawg *d, const struct lk_leaf *level, struct lk_leaf **out) {
+    *out = NULL;
+    size_t cnt = 0;
+    for (const struct lk_leaf *leaf = level; leaf != NULL; leaf = leaf->sibling)
+        cnt++;
+    if (cnt == 0)
+        return LK_OK;
+
+    const struct lk_leaf *local[LK_DAWG_LEVEL];
+    const struct lk_leaf **items = local;
+    if (cnt > LK_DAWG_LEVEL) {
+        items = (const struct lk_leaf**)malloc(cnt * sizeof(*items));
+        if (items == NULL)
+            return LK_OUT_OF_MEMORY;
+    }
+
+    size_t sorted = 0;
+    for (const struct lk_leaf *leaf = level; leaf != NULL; leaf = leaf->sibling) {
+        size_t pos = sorted++;
+        while (pos > 0 && items[pos - 1]->c > leaf->c) {
+            items[pos] = items[pos - 1];
+            pos--;
+        }
+        items[pos] = leaf;
+    }
+
+    /* the chain is built from its end, every leaf points to shared siblings */
+    struct lk_leaf *chain = NULL;
+    lk_result res = LK_OK;
+    for (size_t idx = cnt; idx > 0 && res == LK_OK; idx--)
+        res = dawg_leaf(d, items[idx - 1], chain, &chain);
+
+    if (items != local)
+        free(items);
+    if (res == LK_OK)
+        *out = chain;
+    return res;
+}
+
+/**
+ * Minimizes the tree into a directed acyclic word graph: all equal subtrees
+ *  are stored only once. Two subtrees are equal if they have the same
+ *  characters and the same word lists in all leaves, so lk_tree_search
+ *  returns exactly the same lists as before. It saves a lot of memory because
+ *  all generated variants of a word share their common endings.
+ *  The minimized tree is read-only: lk_tree_add_word fails with
+ *  LK_INVALID_ARG. Pointers returned by lk_tree_search before minimizing
+ *  become invalid
+ *
+ * @return the result of operation:
+ *  LK_OK - the tree was minimized or it had been minimized before
+ *  LK_INVALID_ARG - tree is NULL or it is frozen with lk_tree_freeze
+ *  LK_OUT_OF_MEMORY - failed to allocated memory. The tree is left unchanged
+ *   and it is still usable
+ */
+lk_result lk_tree_minimize(struct lk_tree *tree) {
+    if (tree == NULL || tree->frozen != NULL)
+        return LK_INVALID_ARG;
+    if (tree->minimized)
+        return LK_OK;
+
+    struct lk_dawg d;
+    memset(&d, 0, sizeof(d));
+    lk_arena_init(&d.arena, LK_ARENA_CHUNK_SIZE);
+
+    struct lk_leaf *head;
+    lk_result res = dawg_level(&d, tree->head, &head);
+    free(d.leaves);
+    free(d.lists);
+    if (res != LK_OK) {
+        lk_arena_free(&d.arena);
+        return res;
+    }
+
+    lk_arena_free(&tree->arena);
+    tree->arena = d.arena;
+    tree->head = head;
+    tree->nodes = d.leaves_cnt;
+    tree->minimized = 1;
+    return LK_OK;
+}
+
+/**
+ * Fills the structure with the tree size information
+ *
+ * @return LK_INVALID_ARG if any argument is NULL and LK_OK otherwise
+ */
+lk_result lk_tree_get_stats(const struct lk_tree *tree, struct lk_tree_stats *stats) {
+    if (tree == NULL || stats == NULL)
+        return LK_INVALID_ARG;
+
+    stats->nodes = tree->nodes;
+    stats->keys = tree->keys;
+    stats->memory = sizeof(*tree) + tree->arena.reserved;
+    if (tree->frozen != NULL && tree->frozen->mapped) {
+        /* all arrays are in the image that is owned by the caller */
+        stats->memory += sizeof(*tree->frozen);
+    } else if (tree->frozen != NULL) {
+        const struct lk_datrie *da = tree->frozen;
+        stats->memory += sizeof(*da)
+            + da->size * (sizeof(*da->base) + sizeof(*da->check) + sizeof(*da->value))
+            + LK_SYM_DIRECT * sizeof(*da->sym)
+            + da->wide_cnt * (sizeof(*da->wide_cp) + sizeof(*da->wide_sym));
+    }
+
+    return LK_OK;
+}
+
+/* "LKTR" in little-endian byte order */
+#define LK_TRIE_MAGIC 0x52544b4cu
+
+/**
+ * @struct lk_trie_image
+ * Header of a trie written by lk_tree_save. It is followed by arrays:
+ *  sym[LK_SYM_DIRECT] (unsigned short), wide_cp[wide_cnt] (unsigned int),
+ *  wide_sym[wide_cnt] (unsigned short, padded to 4 bytes), base[size],
+ *  check[size] (int), ref[size] and payload[payload_cnt] (unsigned int).
+ *  A word list in payload is the number of words followed by word ids.
+ *  payload[0] is unused, so ref[s] == 0 means the state has no words
+ */
+struct lk_trie_image {
+    unsigned int magic; /*!< LK_TRIE_MAGIC */
+    unsigned int size; /*!< number of trie states */
+    unsigned int nodes; /*!< number of nodes reported by lk_tree_get_stats */
+    unsigned int wide_cnt; /*!< number of code points in wide_cp */
+    unsigned int payload_cnt; /*!< number of items in payload */
+    unsigned int keys; /*!< number of keys reported by lk_tree_get_stats */
+};
+
+static size_t trie_image_size(const struct lk_trie_image *hdr) {
+    size_t wide = (size_t)hdr->wide_cnt * (sizeof(unsigned int) + sizeof(unsigned short));
+    wide = (wide + 3) & ~(size_t)3;
+    return sizeof(*hdr) + LK_SYM_DIRECT * sizeof(unsigned short) + wide
+        + (size_t)hdr->size * (2 * sizeof(utf8proc_int32_t) + sizeof(unsigned int))
+        + (size_t)hdr->payload_cnt * sizeof(unsigned int);
+}
+
+static lk_result write_block(FILE *fh, const void *data, size_t size) {
+    if (size != 0 && fwrite(data, 1, size, fh) != size)
+        return LK_FILE_WRITE_ERR;
+    return LK_OK;
+}
+
+/* converts word lists of a frozen tree into ref and payload arrays */
+static lk_result build_payload(const struct lk_datrie *da, lk_word_id_func id_of, void *arg,
+        unsigned int **ref_out, unsigned int **payload_out, size_t *payload_cnt) {
+    unsigned int *ref = (unsigned int*)calloc(da->size, sizeof(*ref));
+    size_t cap = da->size + 1, cnt = 1;
+    unsigned int *payload = (unsigned int*)malloc(cap * sizeof(*payload));
+    if (ref == NULL || payload == NULL) {
+        free(ref);
+        free(payload);
+        return LK_OUT_OF_MEMORY;
+    }
+    payload[0] = 0;
+
+    for (size_t idx = 0; idx < da->size; idx++) {
+        const struct lk_word_ptr *list = da->value[idx];
+        if (list == NULL)
+            continue;
+
+        size_t len = 0;
+        for (const struct lk_word_ptr *w = list; w != NULL; w = w->next)
+            len++;
+        if (cnt + len + 1 > cap) {
+            size_t new_cap = cap * 2 + len + 1;
+            unsigned int *p = (unsigned int*)realloc(payload, new_cap * sizeof(*p));
+            if (p == NULL) {
+                free(ref);
+                free(payload);
+                return LK_OUT_OF_MEMORY;
+            }
+            payload = p;
+            cap = new_cap;
+        }
+        if (cnt > 0xFFFFFFFFu - len - 1) {
+            free(ref);
+            free(payload);
+            return LK_BUFFER_SMALL;
+        }
+
+        ref[idx] = (unsigned int)cnt;
+        payload[cnt++] = (unsigned int)len;
+        for (const struct lk_word_ptr *w = list; w != NULL; w = w->next)
+            payload[cnt++] = id_of(w->word, arg);
+    }
+
+    *ref_out = ref;
+    *payload_out = payload;
+    *payload_cnt = cnt;
+    return LK_OK;
+}
+
+/**
+ * Writes the frozen tree to a binary file at the current position. The file
+ *  must be opened in binary mode. Words are replaced with their numbers:
+ *  id_of is called for every word of every word list. The written data can
+ *  be read back with lk_tree_open_image
+ *
+ * @param[in] tree is a tree frozen with lk_tree_freeze or opened with
+ *  lk_tree_open_image. In the latter case id_of is not used
+ * @param[in] fh is a file to write to
+ * @param[in] id_of returns the number of a word
+ * @param[in] arg is passed to id_of as is
+ * @param[out] written is the number of bytes written. It can be NULL
+ *
+ * @return the result of operation:
+ *  LK_OK - the tree was written successfully. The number of bytes written
+ *   is always multiple of 4
+ *  LK_INVALID_ARG - tree or fh is NULL, or the tree is not frozen
+ *  LK_OUT_OF_MEMORY - failed to allocate memory
+ *  LK_BUFFER_SMALL - the tree is too big for the file format
+ *  LK_FILE_WRITE_ERR - failed to write data to the file
+ *
+ * @sa lk_tree_open_image
+ */
+lk_result lk_tree_save(const struct lk_tree *tree, FILE *fh, lk_word_id_func id_of, void *arg,
+        size_t *written) {
+    if (tree == NULL || fh == NULL || tree->frozen == NULL)
+        return LK_INVALID_ARG;
+
+    const struct lk_datrie *da = tree->frozen;
+    if (!da->mapped && id_of == NULL)
+        return LK_INVALID_ARG;
+    if (da->size > 0x7FFFFFFF)
+        return LK_BUFFER_SMALL;
+
+    unsigned int *ref = NULL, *payload = NULL;
+    size_t payload_cnt = da->payload_cnt;
+    if (!da->mapped) {
+        lk_result res = build_payload(da, id_of, arg, &ref, &payload, &payload_cnt);
+        if (res != LK_OK)
+            return res;
+    }
+
+    struct lk_trie_image hdr;
+    hdr.magic = LK_TRIE_MAGIC;
+    hdr.size = (unsigned int)da->size;
+    hdr.nodes = (unsigned int)tree->nodes;
+    hdr.wide_cnt = (unsigned int)da->wide_cnt;
+    hdr.payload_cnt = (unsigned int)payload_cnt;
+    hdr.keys = (unsigned int)tree->keys;
+
+    unsigned int *wide_cp = (unsigned int*)malloc((da->wide_cnt + 1) * sizeof(*wide_cp));
+    if (wide_cp == NULL) {
+        free(ref);
+        free(payload);
+        return LK_OUT_OF_MEMORY;
+    }
+    for (size_t idx = 0; idx < da->wide_cnt; idx++)
+        wide_cp[idx] = da->wide_cp[idx];
+
+    const unsigned short pad = 0;
+    lk_result res = write_block(fh, &hdr, sizeof(hdr));
+    if (res == LK_OK)
+        res = write_block(fh, da->sym, LK_SYM_DIRECT * sizeof(*da->sym));
+    if (res == LK_OK)
+        res = write_block(fh, wide_cp, da->wide_cnt * sizeof(*wide_cp));
+    if (res == LK_OK)
+        res = write_block(fh, da->wide_sym, da->wide_cnt * sizeof(*da->wide_sym));
+    if (res == LK_OK && da->wide_cnt % 2 != 0)
+        res = write_block(fh, &pad, sizeof(pad));
+    if (res == LK_OK)
+        res = write_block(fh, da->base, da->size * sizeof(*da->base));
+    if (res == LK_OK)
+        res = write_block(fh, da->check, da->size * sizeof(*da->check));
+    if (res == LK_OK)
+        res = write_block(fh, da->mapped ? da->ref : ref, da->size * sizeof(*ref));
+    if (res == LK_OK)
+        res = write_block(fh, da->mapped ? da->payload : payload, payload_cnt * sizeof(*payload));
+
+    free(wide_cp);
+    free(ref);
+    free(payload);
+
+    if (res == LK_OK && written != NULL)
+        *written = trie_image_size(&hdr);
+    return res;
+}
+
+/**
+ * Creates a read-only tree on top of data written by lk_tree_save. Nothing
+ *  is copied: the tree points to the data, so the data must stay valid and
+ *  unchanged until the tree is freed. The data must be aligned to 4 bytes.
+ *  The tree does not keep word lists, use lk_tree_search_ids to look up
+ *  words in it
+ *
+ * @param[in] data is the first byte of the saved tree
+ * @param[in] size is the number of bytes available
+ *
+ * @return NULL if data does not contain a valid tree or if it failed to
+ *  allocate memory
+ *
+ * @sa lk_tree_save
+ * @sa lk_tree_free
+ */
+struct lk_tree* lk_tree_open_image(const void *data, size_t size) {
+    if (data == NULL || size < sizeof(struct lk_trie_image) || ((size_t)data & 3) != 0)
+        return NULL;
+
+    const struct lk_trie_image *hdr = (const struct lk_trie_image*)data;
+    if (hdr->magic != LK_TRIE_MAGIC || hdr->size == 0 || hdr->size > 0x7FFFFFFF
+        || hdr->payload_cnt == 0 || trie_image_size(hdr) > size)
+        return NULL;
+
+    struct lk_tree *tree = lk_tree_init();
+    if (tree == NULL)
+        return NULL;
+    struct lk_datrie *da = (struct lk_datrie*)calloc(1, sizeof(*da));
+    if (da == NULL) {
+        lk_tree_free(tree);
+        return NULL;
+    }
+
+    const char *p = (const char*)(hdr + 1);
+    da->mapped = 1;
+    da->size = hdr->size;
+    da->wide_cnt = hdr->wide_cnt;
+    da->payload_cnt = hdr->payload_cnt;
+    da->sym = (unsigned short*)p;
+    p += LK_SYM_DIRECT * sizeof(*da->sym);
+    da->wide_cp = (utf8proc_uint32_t*)p;
+    p += da->wide_cnt * sizeof(*da->wide_cp);
+    da->wide_sym = (unsigned short*)p;
+    p += (da->wide_cnt * sizeof(*da->wide_sym) + 3) & ~(size_t)3;
+    da->base = (utf8proc_int32_t*)p;
+    p += da->size * sizeof(*da->base);
+    da->check = (utf8proc_int32_t*)p;
+    p += da->size * sizeof(*da->check);
+    da->ref = (const unsigned int*)p;
+    p += da->size * sizeof(*da->ref);
+    da->payload = (const unsigned int*)p;
+
+    tree->frozen = da;
+    tree->nodes = hdr->nodes;
+    tree->keys = hdr->keys;
+    return tree;
+}
+
+/**
+ * Looks up the path in a tree opened with lk_tree_open_image
+ *
+ * @param[in] tree is a tree opened with lk_tree_open_image
+ * @param[in] path is a UTF8 string to look up
+ * @param[out] ids receives the pointer to ids of the words associated with
+ *  the path. DO NOT free or modify it - it points to the tree data
+ * @param[out] count receives the number of ids
+ *
+ * @return the result of operation:
+ *  LK_OK - the path was found
+ *  LK_WORD_NOT_FOUND - the tree does not contain the path
+ *  LK_INVALID_ARG - any argument is NULL or the tree was not opened with
+ *   lk_tree_open_image
+ *
+ * @sa lk_tree_open_image
+ */
+lk_result lk_tree_search_ids(const struct lk_tree *tree, const char *path,
+        const unsigned int **ids, size_t *count) {
+    if (tree == NULL || path == NULL || ids == NULL || count == NULL
+        || tree->frozen == NULL || !tree->frozen->mapped)
+        return LK_INVALID_ARG;
+    if (*path == '\0')
+        return LK_WORD_NOT_FOUND;
+
+    const struct lk_datrie *da = tree->frozen;
+    utf8proc_int32_t state = datrie_walk(da, path);
+    if (state == -1)
+        return LK_WORD_NOT_FOUND;
+    return datrie_ids(da, state, ids, count);
+}
+
+/**
+ * Returns ids of the words associated with the path that leads to the
+ *  position in a tree opened with lk_tree_open_image
+ *
+ * @return the same values as lk_tree_search_ids
+ *
+ * @sa lk_tree_step
+ * @sa lk_tree_search_ids
+ */
+lk_result lk_tree_pos_ids(const struct lk_tree *tree, const struct lk_tree_pos *pos,
+        const unsigned int **ids, size_t *count) {
+    if (tree == NULL || pos == NULL || ids == NULL || count == NULL
+        || tree->frozen == NULL || !tree->frozen->mapped)
+        return LK_INVALID_ARG;
+    if (pos->state == -1)
+        return LK_WORD_NOT_FOUND;
+
+    return datrie_ids(tree->frozen, (utf8proc_int32_t)pos->state, ids, count);
+}
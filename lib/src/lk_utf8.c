@@ -0,0 +1,85 @@
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LK_SSE2 1
+#endif
+
+#include "lk_common.h"
+#include "lk_utf8.h"
+
+#ifdef LK_SSE2
+/* checks 16 bytes that contain only ASCII characters and 2-byte sequences.
+ * Returns the number of bytes that are checked: 16, or 15 if the last byte
+ * starts a sequence that continues in the next block. Returns 0 if the block
+ * has other bytes, so it must be checked one character at a time.
+ * Bytes >= 0x80 are negative for the signed compare: continuation bytes are
+ * 0x80..0xBF and lead bytes of 2-byte sequences are 0xC2..0xDF */
+static size_t check16(const utf8proc_uint8_t *s) {
+    __m128i v = _mm_loadu_si128((const __m128i*)s);
+    unsigned int high = (unsigned int)_mm_movemask_epi8(v);
+    if (high == 0)
+        return 16;
+
+    __m128i cont = _mm_cmplt_epi8(v, _mm_set1_epi8((char)0xC0));
+    __m128i lead = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)0xC1)),
+            _mm_cmplt_epi8(v, _mm_set1_epi8((char)0xE0)));
+    unsigned int cmask = (unsigned int)_mm_movemask_epi8(cont);
+    unsigned int lmask = (unsigned int)_mm_movemask_epi8(lead);
+
+    /* every lead byte is followed by one continuation byte, and there are no
+     * other bytes >= 0x80 */
+    if ((cmask | lmask) != high || ((lmask << 1) & 0xFFFF) != cmask)
+        return 0;
+    return (lmask & 0x8000) ? 15 : 16;
+}
+#endif
+
+/**
+ * Checks that a string is a correct UTF8 sequence with the same rules as
+ *  lk_utf8_decode has
+ *
+ * @param[in] s is the string
+ * @param[in] len is the length of the string in bytes
+ *
+ * @return the number of bytes before the first invalid sequence, len if the
+ *  whole string is correct. A sequence cut by the end of the string is
+ *  invalid
+ *
+ * How it works:
+ *  Blocks of 16 bytes that have only ASCII characters and 2-byte sequences,
+ *  that is most of Lakota text, are checked at once with SSE2. A block with
+ *  anything else (e.g, 3-byte U+2019 or an invalid byte) is decoded one
+ *  character at a time
+ */
+size_t lk_utf8_valid_len(const utf8proc_uint8_t *s, size_t len) {
+    size_t idx = 0;
+
+    while (idx < len) {
+#ifdef LK_SSE2
+        while (idx + 16 <= len) {
+            size_t n = check16(s + idx);
+            if (n == 0)
+                break;
+            idx += n;
+        }
+        /* the slow path goes up to the end of the block */
+        size_t stop = idx + 16 <= len ? idx + 16 : len;
+#else
+        size_t stop = len;
+#endif
+        while (idx < stop) {
+            if (s[idx] < 0x80) {
+                idx++;
+                continue;
+            }
+            utf8proc_int32_t cp;
+            utf8proc_ssize_t n = lk_utf8_decode(s + idx, (utf8proc_ssize_t)(len - idx), &cp);
+            if (n <= 0)
+                return idx;
+            idx += (size_t)n;
+        }
+    }
+
+    return idx;
+}
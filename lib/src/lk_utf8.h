@@ -0,0 +1,157 @@
+#ifndef LKCHECKER_UTF8
+#define LKCHECKER_UTF8
+
+#include <utf8proc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * UTF8 decoder and encoder that the compiler can inline into the loops over
+ *  words. Lakota text consists of ASCII, 2-byte letters and 3-byte U+2019,
+ *  so only 4-byte sequences and invalid bytes are passed to utf8proc. The
+ *  results are the same as utf8proc_iterate and utf8proc_encode_char give
+ */
+
+/* returns non-zero if the byte continues a multibyte sequence */
+static inline int lk_utf8_cont(utf8proc_uint8_t b) {
+    return (b & 0xC0) == 0x80;
+}
+
+/**
+ * Decodes the first character of a string like utf8proc_iterate does:
+ *  overlong sequences and surrogates are invalid
+ *
+ * @param[in] s is the string
+ * @param[in] len is the length of the string or a negative value if the
+ *  string ends with zero
+ * @param[out] cp receives the code point or -1 if the string is empty or it
+ *  does not start with a valid UTF8 sequence
+ *
+ * @return the length of the character in bytes, 0 for an empty string and
+ *  a negative value for an invalid sequence
+ */
+static inline utf8proc_ssize_t lk_utf8_decode(const utf8proc_uint8_t *s, utf8proc_ssize_t len,
+        utf8proc_int32_t *cp) {
+    if (len == 0) {
+        *cp = -1;
+        return 0;
+    }
+
+    utf8proc_int32_t b = s[0];
+    if (b < 0x80) {
+        *cp = b;
+        return 1;
+    }
+
+    /* a zero terminated string is never read past its end: the zero is not
+     * a continuation byte */
+    if (b >= 0xC2 && b < 0xE0) {
+        if ((len < 0 || len >= 2) && lk_utf8_cont(s[1])) {
+            *cp = ((b & 0x1F) << 6) | (s[1] & 0x3F);
+            return 2;
+        }
+    } else if (b >= 0xE0 && b < 0xF0) {
+        if ((len < 0 || len >= 3) && lk_utf8_cont(s[1]) && lk_utf8_cont(s[2])) {
+            utf8proc_int32_t c = ((b & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+            if (c >= 0x800 && (c < 0xD800 || c > 0xDFFF)) {
+                *cp = c;
+                return 3;
+            }
+        }
+    } else {
+        return utf8proc_iterate(s, len, cp);
+    }
+
+    *cp = -1;
+    return UTF8PROC_ERROR_INVALIDUTF8;
+}
+
+/**
+ * Decodes the first character of a string that is known to be correct UTF8,
+ *  e.g. a line that lk_utf8_valid_len accepted. Only the lead byte is looked
+ *  at, so continuation bytes, overlong sequences and surrogates are not
+ *  checked. The string is never read past len: a character cut by the end
+ *  of the string is invalid
+ *
+ * @return the length of the character in bytes, 0 for an empty string and
+ *  a negative value for a cut character. cp is -1 in both cases
+ */
+static inline utf8proc_ssize_t lk_utf8_decode_trusted(const utf8proc_uint8_t *s,
+        utf8proc_ssize_t len, utf8proc_int32_t *cp) {
+    if (len <= 0) {
+        *cp = -1;
+        return 0;
+    }
+
+    utf8proc_int32_t b = s[0];
+    if (b < 0x80) {
+        *cp = b;
+        return 1;
+    }
+    if (b < 0xE0 && len >= 2) {
+        *cp = ((b & 0x1F) << 6) | (s[1] & 0x3F);
+        return 2;
+    }
+    if (b >= 0xE0 && b < 0xF0 && len >= 3) {
+        *cp = ((b & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        return 3;
+    }
+    if (b >= 0xF0 && len >= 4) {
+        *cp = ((b & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+        return 4;
+    }
+
+    *cp = -1;
+    return UTF8PROC_ERROR_INVALIDUTF8;
+}
+
+/* returns the length of the UTF8 sequence of a code point, 0 if it is not
+ * a valid code point */
+static inline size_t lk_utf8_cp_len(utf8proc_int32_t cp) {
+    if (cp < 0)
+        return 0;
+    if (cp < 0x80)
+        return 1;
+    if (cp < 0x800)
+        return 2;
+    if (cp < 0x10000)
+        return 3;
+    return cp < 0x110000 ? 4 : 0;
+}
+
+/**
+ * Encodes a code point like utf8proc_encode_char does. The buffer must have
+ *  space for 4 bytes
+ *
+ * @return the number of written bytes, 0 for a negative code point
+ */
+static inline utf8proc_ssize_t lk_utf8_encode(utf8proc_int32_t cp, utf8proc_uint8_t *d) {
+    utf8proc_uint32_t c = (utf8proc_uint32_t)cp;
+    if (c < 0x80) {
+        d[0] = (utf8proc_uint8_t)c;
+        return 1;
+    }
+    if (c < 0x800) {
+        d[0] = (utf8proc_uint8_t)(0xC0 | (c >> 6));
+        d[1] = (utf8proc_uint8_t)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        d[0] = (utf8proc_uint8_t)(0xE0 | (c >> 12));
+        d[1] = (utf8proc_uint8_t)(0x80 | ((c >> 6) & 0x3F));
+        d[2] = (utf8proc_uint8_t)(0x80 | (c & 0x3F));
+        return 3;
+    }
+
+    return utf8proc_encode_char(cp, d);
+}
+
+size_t lk_utf8_valid_len(const utf8proc_uint8_t *s, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
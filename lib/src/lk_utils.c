@@ -1,14 +1,22 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LK_SSE2 1
 #endif
 
 #include <utf8proc.h>
 #include "lk_common.h"
 #include "lk_utils.h"
+#include "lk_chars.h"
+#include "lk_utf8.h"
 
 /* A table of UNICODE characters and their code
  * Just to keep the information somewhere at hand
@@ -40,51 +48,21 @@ typedef enum {
 } lk_state;
 
 
-/*
- * All three array below must have the same number of elements in the same
- *  order. Vowels must go first.
- */
-/* Array contains lowcase letters with diacritic marks as UNICODE characters */
-const utf8proc_uint32_t lk_low_case[] = {
-    LK_A_LOW, LK_O_LOW, LK_E_LOW, LK_I_LOW, LK_U_LOW,
-    LK_N_LOW, LK_C_LOW, LK_Z_LOW, LK_H_LOW, LK_G_LOW, LK_S_LOW,
-};
-/* Array contains upcase letters with diacritic marks as UNICODE characters */
-const utf8proc_uint32_t lk_up_case[] = {
-    LK_A_UP, LK_O_UP, LK_E_UP, LK_I_UP, LK_U_UP,
-    LK_N_UP, LK_C_UP, LK_Z_UP, LK_H_UP, LK_G_UP, LK_S_UP,
-};
-/* Array contains ASCII letters that represent the same characters as two
- * previous array but with diacritic marks removed
- */
-const utf8proc_int32_t lk_low_ascii[] = {
-    'a', 'o', 'e', 'i', 'u', 'n', 'c', 'z', 'h', 'g', 's',
-};
-
-/* a function type to use in string processing */
-typedef utf8proc_int32_t (*ustr_func) (utf8proc_int32_t);
-
+/* all functions below look up the character in lk_char_table */
 static int lk_is_stressed_vowel(utf8proc_uint32_t cp) {
-    return (cp == LK_A_LOW || cp == LK_E_LOW || cp == LK_I_LOW
-        || cp == LK_U_LOW || cp == LK_O_LOW);
+    return (lk_char_get((int)cp)->flags & LK_CH_STRESSED) != 0;
 }
 
 static int lk_is_unstressed_vowel(utf8proc_uint32_t cp) {
-    return (cp == 'a' || cp == 'e'
-        || cp == 'i' || cp == 'o' || cp == 'u');
+    return (lk_char_get((int)cp)->flags & (LK_CH_VOWEL | LK_CH_STRESSED)) == LK_CH_VOWEL;
 }
 
 static int lk_is_vowel(utf8proc_uint32_t cp) {
-    return lk_is_unstressed_vowel(cp) || lk_is_stressed_vowel(cp);
-}
-
-static int lk_is_lakota_quote(utf8proc_uint32_t c) {
-    return c == LK_QUOTE   /* NLD & NLDO */
-        || c == LK_QUOTE2; /* some web-sites */
+    return (lk_char_get((int)cp)->flags & LK_CH_VOWEL) != 0;
 }
 
 static int lk_is_quote(utf8proc_uint32_t c) {
-    return c == '\'' || c == '`' || lk_is_lakota_quote(c);
+    return (lk_char_get((int)c)->flags & LK_CH_QUOTE) != 0;
 }
 
 static int lk_is_glottal_stop(utf8proc_uint32_t cp) {
@@ -93,85 +71,90 @@ static int lk_is_glottal_stop(utf8proc_uint32_t cp) {
 
 /* remove diacritic mark from a letter */
 static utf8proc_uint32_t lk_char_to_ascii(utf8proc_uint32_t cp) {
-    if (lk_is_quote(cp))
-        return '\'';
-
-    for (size_t idx = 0; idx < sizeof(lk_low_case)/sizeof(lk_low_case[0]); idx++) {
-        if (cp == lk_low_case[idx])
-            return lk_low_ascii[idx];
-    }
-
-    return cp;
+    const struct lk_char_info *ci = lk_char_get((int)cp);
+    return ci->flags ? ci->ascii : cp;
 }
 
 /* remove diacritic mark from a vowel */
 static utf8proc_uint32_t lk_stress_to_unstress(utf8proc_uint32_t cp) {
-    if (cp < 128)
-        return cp;
-
-    switch (cp) {
-        case LK_A_LOW:
-            return 'a';
-        case LK_E_LOW:
-            return 'e';
-        case LK_I_LOW:
-            return 'i';
-        case LK_O_LOW:
-            return 'o';
-        case LK_U_LOW:
-            return 'u';
-    }
-    return cp;
+    const struct lk_char_info *ci = lk_char_get((int)cp);
+    return ci->flags ? ci->unstressed : cp;
 }
 
-/* length of a UTF8 character in bytes */
-static size_t cp_length(utf8proc_uint32_t cp) {
-    if (cp < 0) {
-        return 0;
-    } else if (cp < 0x80) {
-        return 1;
-    } else if (cp < 0x800) {
-        return 2;
-    } else if (cp < 0x10000) {
-        return 3;
-    } else if (cp < 0x110000) {
-        return 4;
-    } else {
-        return 0;
-    }
+/* decodes the next character of a word. A trusted word is known to be
+ * correct UTF8, so its characters are decoded without checks */
+static utf8proc_ssize_t decode_char(const utf8proc_uint8_t *s, const utf8proc_uint8_t *end,
+        utf8proc_int32_t *cp, int trusted) {
+    if (trusted)
+        return lk_utf8_decode_trusted(s, end - s, cp);
+    return lk_utf8_decode(s, end - s, cp);
 }
 
-/* run a function for the whole string - used by ustr_lowcase etc */
-static lk_result process_ustr(char *src, ustr_func fn) {
-    if (src == NULL)
-        return LK_OK;
+/*
+ * Most of Lakota text is ASCII, so the functions below process runs of ASCII
+ *  bytes 8 bytes at a time as one 64-bit word and decode only multibyte
+ *  characters. All bytes of a word passed to the ascii_ helpers are below
+ *  0x80, so adding a constant to a byte never carries into the next one
+ */
+#define LK_ONES 0x0101010101010101ull
+#define LK_HIGHS 0x8080808080808080ull
 
-    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)src;
-    utf8proc_uint8_t *udst = (utf8proc_uint8_t*)src;
-    utf8proc_int32_t cpsrc, cpdst;
+static unsigned long long load8(const utf8proc_uint8_t *s) {
+    unsigned long long x;
+    memcpy(&x, s, sizeof(x));
+    return x;
+}
 
-    while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cpsrc);
-        if (cpsrc == -1)
-            return LK_INVALID_STRING;
+static void store8(utf8proc_uint8_t *d, unsigned long long x) {
+    memcpy(d, &x, sizeof(x));
+}
 
-        cpdst = (*fn)(cpsrc);
-        usrc += len;
+/* returns the number of leading bytes below 0x80 in the first len bytes */
+static size_t ascii_run(const utf8proc_uint8_t *s, size_t len) {
+    size_t idx = 0;
+    while (idx + 8 <= len && (load8(s + idx) & LK_HIGHS) == 0)
+        idx += 8;
+    while (idx < len && s[idx] < 0x80)
+        idx++;
+    return idx;
+}
 
-        size_t lendst = cp_length(cpdst);
-        if (lendst > len)
-            return LK_BUFFER_SMALL;
+/* returns 0x80 in every byte of x that is equal to c */
+static unsigned long long ascii_eq(unsigned long long x, unsigned char c) {
+    unsigned long long v = x ^ (LK_ONES * c);
+    return ~(v + LK_ONES * 0x7F) & LK_HIGHS;
+}
 
-        lendst = utf8proc_encode_char(cpdst, udst);
-        udst += lendst;
-    }
+/* returns 0x80 in every byte of x that is equal to c, x may have any bytes */
+static unsigned long long byte_eq(unsigned long long x, unsigned char c) {
+    unsigned long long v = x ^ (LK_ONES * c);
+    return ~(((v & ~LK_HIGHS) + (LK_ONES * 0x7F)) | v) & LK_HIGHS;
+}
 
-    return LK_OK;
+/* returns 0x80 in every byte of x that is a quote mark: ' or ` */
+static unsigned long long ascii_quotes(unsigned long long x) {
+    return ascii_eq(x, '\'') | ascii_eq(x, '`');
 }
 
-/* convert a string to low case inplace */
-static lk_result ustr_lowcase(char *src) {
-    return process_ustr(src, utf8proc_tolower);
+/* converts capital letters of x to low case */
+static unsigned long long ascii_low(unsigned long long x) {
+    /* the high bit is set in bytes >= 'A' and in bytes > 'Z' */
+    unsigned long long ge_a = x + LK_ONES * (0x80 - 'A');
+    unsigned long long gt_z = x + LK_ONES * (0x80 - 'Z' - 1);
+    return x + ((ge_a & ~gt_z & LK_HIGHS) >> 2);
+}
+
+/* returns how many of n ASCII bytes fit the output buffer of out_sz bytes
+ * with the space for the trailing zero */
+static size_t ascii_fit(size_t n, size_t out_sz) {
+    if (n < out_sz)
+        return n;
+    return out_sz == 0 ? 0 : out_sz - 1;
+}
+
+/* returns the number of bytes of x that have the high bit in mask */
+static unsigned int ascii_count(unsigned long long mask) {
+    return (unsigned int)(((mask >> 7) * LK_ONES) >> 56);
 }
 
 /**
@@ -200,33 +183,6 @@ int lk_ends_with(const char *orig, const char *cmp) {
     return strcmp(from, cmp) == 0 ? 1 : 0;
 }
 
-static lk_result fix_glottal_stop(const char *word, char *out, size_t out_sz) {
-    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)word;
-    utf8proc_uint8_t *udst = (utf8proc_uint8_t*)out;
-    utf8proc_int32_t cp;
-
-    while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cp);
-        if (cp == -1)
-            return LK_INVALID_STRING;
-
-        if (cp == '\'' || cp == '`' || cp == LK_QUOTE2)
-            cp = LK_QUOTE;
-
-        usrc += len;
-        len = cp_length(cp);
-        if (len >= out_sz)
-            return LK_BUFFER_SMALL;
-
-        len = utf8proc_encode_char(cp, udst);
-        udst += len;
-        out_sz -= len;
-    }
-    *udst = '\0';
-
-    return LK_OK;
-}
-
 /**
  * Converts a string to lowcase. All single quotes and apostrophes are replaced
  *  with glottal stop as well
@@ -246,6 +202,14 @@ static lk_result fix_glottal_stop(const char *word, char *out, size_t out_sz) {
  *  LK_INVALID_STRING - the original string is not correct UTF8 sequence
  */
 lk_result lk_to_low_case(const char *word, char *out, size_t out_sz) {
+    if (word == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_to_low_case_n(word, strlen(word), out, out_sz);
+}
+
+/* converts a word to low case, a trusted word is decoded without checks */
+static lk_result to_low_case(const char *word, size_t len, char *out, size_t out_sz, int trusted) {
     if (word == NULL)
         return LK_INVALID_ARG;
     if (out == NULL)
@@ -253,14 +217,385 @@ lk_result lk_to_low_case(const char *word, char *out, size_t out_sz) {
     if (out == word)
         return LK_INVALID_ARG;
 
-    if (strlen(word) > out_sz)
+    if (len > out_sz)
         return LK_BUFFER_SMALL;
 
-    lk_result r = fix_glottal_stop(word, out, out_sz);
-    if (r != LK_OK)
-        return r;
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + len;
+    utf8proc_uint8_t *udst = (utf8proc_uint8_t*)out;
+    /* a character which low case form is longer is not converted */
+    int longer = 0;
+
+    while (usrc < uend) {
+        if (*usrc < 0x80) {
+            size_t n = ascii_run(usrc, uend - usrc);
+            /* quote marks become glottal stops of 2 bytes */
+            while (n >= 8 && out_sz > 8) {
+                unsigned long long x = load8(usrc);
+                if (ascii_quotes(x))
+                    break;
+                store8(udst, ascii_low(x));
+                usrc += 8;
+                udst += 8;
+                out_sz -= 8;
+                n -= 8;
+            }
+            for (; n != 0; n--, usrc++) {
+                utf8proc_uint8_t b = *usrc;
+                if (b == '\'' || b == '`') {
+                    if (out_sz <= 2)
+                        return LK_BUFFER_SMALL;
+                    udst += lk_utf8_encode(LK_QUOTE, udst);
+                    out_sz -= 2;
+                    continue;
+                }
+                if (out_sz <= 1)
+                    return LK_BUFFER_SMALL;
+                *udst++ = (b >= 'A' && b <= 'Z') ? b + ('a' - 'A') : b;
+                out_sz--;
+            }
+            continue;
+        }
+
+        utf8proc_int32_t cp;
+        utf8proc_ssize_t cplen = decode_char(usrc, uend, &cp, trusted);
+        if (cp == -1)
+            return LK_INVALID_STRING;
+        usrc += cplen;
+
+        cp = lk_char_fix_quote(cp);
+        size_t q_len = lk_utf8_cp_len(cp);
+        if (q_len >= out_sz)
+            return LK_BUFFER_SMALL;
 
-    return ustr_lowcase(out);
+        utf8proc_int32_t low = lk_char_to_low(cp);
+        if (lk_utf8_cp_len(low) > q_len) {
+            longer = 1;
+            low = cp;
+        }
+        size_t n = lk_utf8_encode(low, udst);
+        udst += n;
+        out_sz -= n;
+    }
+    *udst = '\0';
+
+    return longer ? LK_BUFFER_SMALL : LK_OK;
+}
+
+/**
+ * Length-delimited version of lk_to_low_case: word is len bytes long and
+ *  does not have to end with zero, so a word is converted right in the text
+ *
+ * @sa lk_to_low_case
+ */
+lk_result lk_to_low_case_n(const char *word, size_t len, char *out, size_t out_sz) {
+    return to_low_case(word, len, out, out_sz, 0);
+}
+
+/**
+ * Version of lk_to_low_case_n for a word that is known to be correct UTF8,
+ *  e.g. a word of a line that lk_file_line_trusted confirmed. Characters are
+ *  decoded by their first byte without any check, so the result for an
+ *  invalid word is undefined, but the word is never read past len
+ *
+ * @sa lk_to_low_case_n
+ * @sa lk_file_check_utf8
+ */
+lk_result lk_to_low_case_trusted(const char *word, size_t len, char *out, size_t out_sz) {
+    return to_low_case(word, len, out, out_sz, 1);
+}
+
+/* the original word in lk_forms distinct bitmasks */
+#define LK_FORM_ORIG LK_FORM_COUNT
+
+/* marks every pair of forms from ids that have different characters */
+static void mark_different(unsigned int *differ, const int *ids,
+        const utf8proc_int32_t *cps, size_t cnt) {
+    for (size_t i = 0; i < cnt; i++) {
+        for (size_t j = i + 1; j < cnt; j++) {
+            if (cps[i] != cps[j]) {
+                differ[ids[i]] |= LK_FORM_BIT(ids[j]);
+                differ[ids[j]] |= LK_FORM_BIT(ids[i]);
+            }
+        }
+    }
+}
+
+/* appends a character to a form if the form is requested and it still fits */
+static void put_form_char(struct lk_forms *forms, size_t *pos, int f, utf8proc_int32_t cp) {
+    if ((forms->valid & LK_FORM_BIT(f)) == 0)
+        return;
+
+    if (pos[f] + lk_utf8_cp_len(cp) + 1 > LK_MAX_WORD_LEN) {
+        forms->valid &= ~LK_FORM_BIT(f);
+        return;
+    }
+    pos[f] += lk_utf8_encode(cp, (utf8proc_uint8_t*)forms->form[f] + pos[f]);
+}
+
+/**
+ * Builds several variants of a word at once: the word is decoded only once
+ *  and every character is converted to all requested forms. The result is
+ *  the same as calling lk_to_low_case, lk_destress, lk_to_ascii and
+ *  lk_remove_glottal_stop one after another. Duplicates are detected while
+ *  converting characters, so no string comparison is needed
+ *
+ * @param[in] word is the original string
+ * @param[in] kinds is a bitmask of LK_FORM_BIT of forms to build. Forms that
+ *  the requested ones are made of are built as well
+ * @param[out] forms receives the variants and information about the word
+ *
+ * @return the result of operation:
+ *  LK_OK - the word was processed. Check forms->valid to see what forms were
+ *   built: a form that is longer than LK_MAX_WORD_LEN is not built, in the
+ *   same case the corresponding function returns an error
+ *  LK_INVALID_ARG - word or forms is NULL
+ *  LK_INVALID_STRING - the word is not correct UTF8 sequence
+ */
+lk_result lk_normalize_forms(const char *word, unsigned int kinds, struct lk_forms *forms) {
+    if (word == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_normalize_forms_n(word, strlen(word), kinds, forms);
+}
+
+/**
+ * Length-delimited version of lk_normalize_forms: word is len bytes long and
+ *  does not have to end with zero
+ *
+ * @sa lk_normalize_forms
+ */
+lk_result lk_normalize_forms_n(const char *word, size_t len, unsigned int kinds,
+        struct lk_forms *forms) {
+    if (word == NULL || forms == NULL)
+        return LK_INVALID_ARG;
+
+    /* the forms that requested ones are made of */
+    if (kinds & LK_FORMS_DICT)
+        kinds |= LK_FORM_BIT(LK_FORM_LOW);
+    if (kinds & LK_FORM_BIT(LK_FORM_DESTRESSED_LOW))
+        kinds |= LK_FORM_BIT(LK_FORM_DESTRESSED);
+
+    size_t pos[LK_FORM_COUNT] = {0};
+    /* lk_to_low_case checks the size of both the original string and
+     * the string after replacing quotes */
+    size_t word_len = 0, low_src = 0, dlow_src = 0;
+    unsigned int differ[LK_FORM_COUNT + 1] = {0};
+    static const int stop_ids[] = {
+        LK_FORM_ORIG, LK_FORM_LOW, LK_FORM_UNSTRESSED, LK_FORM_ASCII, LK_FORM_ASCII_GRAVE
+    };
+    static const int no_stop_ids[] = {
+        LK_FORM_LOW_NO_STOP, LK_FORM_UNSTRESSED_NO_STOP, LK_FORM_ASCII_NO_STOP
+    };
+
+    forms->valid = kinds & (LK_FORM_BIT(LK_FORM_COUNT) - 1);
+    forms->distinct = 0;
+    forms->stressed = 0;
+    forms->has_stop = 0;
+
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + len;
+    while (usrc < uend) {
+        if (*usrc < 0x80 && *usrc != '\'' && *usrc != '`') {
+            /* fast path: all forms get the same ASCII letter in low case */
+            char b = (char)*usrc++;
+            char lb = (b >= 'A' && b <= 'Z') ? b + ('a' - 'A') : b;
+            if (++word_len > LK_MAX_WORD_LEN || ++low_src + 1 > LK_MAX_WORD_LEN)
+                forms->valid &= ~(LK_FORMS_DICT & kinds);
+            if (++dlow_src + 1 > LK_MAX_WORD_LEN)
+                forms->valid &= ~LK_FORM_BIT(LK_FORM_DESTRESSED_LOW);
+
+            for (int f = 0; f < LK_FORM_COUNT; f++) {
+                if ((forms->valid & LK_FORM_BIT(f)) == 0)
+                    continue;
+                if (pos[f] + 2 > LK_MAX_WORD_LEN)
+                    forms->valid &= ~LK_FORM_BIT(f);
+                else
+                    forms->form[f][pos[f]++] = (f == LK_FORM_DESTRESSED) ? b : lb;
+            }
+
+            if (lb != b) {
+                for (size_t idx = 1; idx < 5; idx++) {
+                    differ[LK_FORM_ORIG] |= LK_FORM_BIT(stop_ids[idx]);
+                    differ[stop_ids[idx]] |= LK_FORM_BIT(LK_FORM_ORIG);
+                }
+            }
+            continue;
+        }
+
+        utf8proc_int32_t c;
+        size_t cplen = lk_utf8_decode(usrc, uend - usrc, &c);
+        if (c == -1)
+            return LK_INVALID_STRING;
+        usrc += cplen;
+        word_len += cplen;
+
+        if (lk_is_stressed_vowel(c))
+            forms->stressed++;
+        int stop = lk_is_glottal_stop(c);
+        if (stop)
+            forms->has_stop = 1;
+
+        utf8proc_int32_t q = lk_char_fix_quote(c);
+        utf8proc_int32_t l = lk_char_to_low(q);
+        utf8proc_int32_t u = lk_stress_to_unstress(l);
+        utf8proc_int32_t a = lk_char_to_ascii(u);
+        utf8proc_int32_t g = (a == '\'') ? '`' : a;
+
+        if (forms->valid & LK_FORM_BIT(LK_FORM_LOW)) {
+            low_src += lk_utf8_cp_len(q);
+            if (low_src + 1 > LK_MAX_WORD_LEN || word_len > LK_MAX_WORD_LEN
+                    || lk_utf8_cp_len(l) > lk_utf8_cp_len(q))
+                forms->valid &= ~(LK_FORMS_DICT & kinds);
+        }
+        put_form_char(forms, pos, LK_FORM_LOW, l);
+        put_form_char(forms, pos, LK_FORM_UNSTRESSED, u);
+        put_form_char(forms, pos, LK_FORM_ASCII, a);
+        put_form_char(forms, pos, LK_FORM_ASCII_GRAVE, g);
+        if (!stop) {
+            put_form_char(forms, pos, LK_FORM_LOW_NO_STOP, l);
+            put_form_char(forms, pos, LK_FORM_UNSTRESSED_NO_STOP, u);
+            put_form_char(forms, pos, LK_FORM_ASCII_NO_STOP, a);
+        }
+
+        if (kinds & LK_FORM_BIT(LK_FORM_DESTRESSED)) {
+            utf8proc_int32_t d = lk_stress_to_unstress(c);
+            utf8proc_int32_t dq = lk_char_fix_quote(d);
+            utf8proc_int32_t dl = lk_char_to_low(dq);
+            put_form_char(forms, pos, LK_FORM_DESTRESSED, d);
+            if (forms->valid & LK_FORM_BIT(LK_FORM_DESTRESSED_LOW)) {
+                dlow_src += lk_utf8_cp_len(dq);
+                if (dlow_src + 1 > LK_MAX_WORD_LEN || lk_utf8_cp_len(dl) > lk_utf8_cp_len(dq))
+                    forms->valid &= ~LK_FORM_BIT(LK_FORM_DESTRESSED_LOW);
+            }
+            put_form_char(forms, pos, LK_FORM_DESTRESSED_LOW, dl);
+        }
+
+        if ((kinds & LK_FORMS_DICT) == LK_FORMS_DICT) {
+            utf8proc_int32_t with_stop[] = {c, l, u, a, g};
+            mark_different(differ, stop_ids, with_stop, 5);
+            if (!stop) {
+                utf8proc_int32_t no_stop[] = {l, u, a};
+                mark_different(differ, no_stop_ids, no_stop, 3);
+            }
+        }
+    }
+
+    for (int f = 0; f < LK_FORM_COUNT; f++) {
+        if (forms->valid & LK_FORM_BIT(f))
+            forms->form[f][pos[f]] = '\0';
+        else
+            forms->form[f][0] = '\0';
+    }
+
+    if ((kinds & LK_FORMS_DICT) != LK_FORMS_DICT)
+        return LK_OK;
+
+    /* forms without glottal stops never match forms with them. If there is
+     * no glottal stop they are the same as the forms they are made of, so
+     * they are never distinct and other forms are not compared to them */
+    unsigned int stop_mask = 0, no_stop_mask = 0;
+    for (size_t idx = 0; idx < 5; idx++)
+        stop_mask |= LK_FORM_BIT(stop_ids[idx]);
+    for (size_t idx = 0; idx < 3; idx++)
+        no_stop_mask |= LK_FORM_BIT(no_stop_ids[idx]);
+    for (size_t idx = 0; idx < 5; idx++)
+        differ[stop_ids[idx]] |= no_stop_mask;
+    for (size_t idx = 0; idx < 3; idx++) {
+        int f = no_stop_ids[idx];
+        if (forms->has_stop)
+            differ[f] |= stop_mask;
+        else
+            differ[f] = 0;
+    }
+
+    /* the dictionary does not add unstressed forms of words without stressed
+     * vowels: capital stressed vowels are not stress marks */
+    if (forms->stressed == 0) {
+        unsigned int unstressed = LK_FORM_BIT(LK_FORM_UNSTRESSED) | LK_FORM_BIT(LK_FORM_UNSTRESSED_NO_STOP);
+        for (int f = LK_FORM_LOW; f <= LK_FORM_ASCII_GRAVE; f++)
+            differ[f] |= unstressed;
+        differ[LK_FORM_UNSTRESSED] = 0;
+        differ[LK_FORM_UNSTRESSED_NO_STOP] = 0;
+    }
+
+    for (int f = LK_FORM_LOW; f <= LK_FORM_ASCII_GRAVE; f++) {
+        unsigned int before = (LK_FORM_BIT(f) - 1) | LK_FORM_BIT(LK_FORM_ORIG);
+        if ((differ[f] & before) == before && (forms->valid & LK_FORM_BIT(f)))
+            forms->distinct |= LK_FORM_BIT(f);
+    }
+
+    return LK_OK;
+}
+
+/* returns the length of the character cp if the key starts with it or 0 */
+static size_t key_starts_with(const char *key, utf8proc_int32_t cp) {
+    if (cp < 0x80)
+        return (utf8proc_int32_t)(unsigned char)*key == cp ? 1 : 0;
+
+    utf8proc_uint8_t buf[4];
+    size_t len = lk_utf8_encode(cp, buf);
+    for (size_t idx = 0; idx < len; idx++) {
+        if ((utf8proc_uint8_t)key[idx] != buf[idx])
+            return 0;
+    }
+    return len;
+}
+
+/**
+ * Checks what forms of a word are equal to a key. The forms are not built:
+ *  every character of the word is converted and compared to the key at
+ *  once, so the function is much faster than lk_normalize_forms followed by
+ *  string comparisons
+ *
+ * @param[in] word is the original string
+ * @param[in] kinds is a bitmask of LK_FORM_BIT of forms to compare. Only
+ *  forms from LK_FORMS_DICT are supported
+ * @param[in] key is the string to compare with
+ *
+ * @return bitmask of LK_FORM_BIT of forms from kinds that are equal to
+ *  the key. 0 if nothing matches, an argument is NULL or the word is not
+ *  correct UTF8 sequence
+ */
+unsigned int lk_match_forms(const char *word, unsigned int kinds, const char *key) {
+    if (word == NULL || key == NULL)
+        return 0;
+
+    const unsigned int no_stop = LK_FORM_BIT(LK_FORM_LOW_NO_STOP)
+        | LK_FORM_BIT(LK_FORM_UNSTRESSED_NO_STOP) | LK_FORM_BIT(LK_FORM_ASCII_NO_STOP);
+    size_t pos[LK_FORM_ASCII_GRAVE + 1] = {0};
+
+    kinds &= LK_FORMS_DICT;
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    while (*usrc && kinds) {
+        utf8proc_int32_t c;
+        size_t len = lk_utf8_decode(usrc, -1, &c);
+        if (c == -1)
+            return 0;
+        usrc += len;
+
+        unsigned int cmp = lk_is_glottal_stop(c) ? kinds & ~no_stop : kinds;
+        utf8proc_int32_t l = lk_char_to_low(lk_char_fix_quote(c));
+        utf8proc_int32_t u = lk_stress_to_unstress(l);
+        utf8proc_int32_t a = lk_char_to_ascii(u);
+        utf8proc_int32_t v[] = {l, l, u, u, a, a, (a == '\'') ? '`' : a};
+
+        for (int f = LK_FORM_LOW; f <= LK_FORM_ASCII_GRAVE; f++) {
+            if ((cmp & LK_FORM_BIT(f)) == 0)
+                continue;
+            size_t n = key_starts_with(key + pos[f], v[f]);
+            if (n == 0)
+                kinds &= ~LK_FORM_BIT(f);
+            pos[f] += n;
+        }
+    }
+
+    for (int f = LK_FORM_LOW; f <= LK_FORM_ASCII_GRAVE; f++) {
+        if ((kinds & LK_FORM_BIT(f)) && key[pos[f]] != '\0')
+            kinds &= ~LK_FORM_BIT(f);
+    }
+
+    return kinds;
 }
 
 /**
@@ -272,11 +607,17 @@ int lk_stressed_vowels_no(const char *word) {
         return 0;
 
     int cnt = 0;
-    utf8proc_uint8_t *uw = (utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uw = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = uw + strlen(word);
     utf8proc_int32_t cp;
 
-    while (*uw) {
-        size_t len = utf8proc_iterate(uw, -1, &cp);
+    while (uw < uend) {
+        /* stressed vowels are never ASCII */
+        uw += ascii_run(uw, uend - uw);
+        if (uw == uend)
+            break;
+
+        utf8proc_ssize_t len = lk_utf8_decode(uw, uend - uw, &cp);
         if (cp == -1)
             return 0;
 
@@ -298,11 +639,24 @@ int lk_vowels_no(const char *word) {
         return 0;
 
     int cnt = 0;
-    utf8proc_uint8_t *uw = (utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uw = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = uw + strlen(word);
     utf8proc_int32_t cp;
 
-    while (*uw) {
-        size_t len = utf8proc_iterate(uw, -1, &cp);
+    while (uw < uend) {
+        if (*uw < 0x80) {
+            size_t n = ascii_run(uw, uend - uw);
+            for (; n >= 8; n -= 8, uw += 8) {
+                unsigned long long x = load8(uw);
+                cnt += ascii_count(ascii_eq(x, 'a') | ascii_eq(x, 'e') | ascii_eq(x, 'i')
+                    | ascii_eq(x, 'o') | ascii_eq(x, 'u'));
+            }
+            for (; n != 0; n--, uw++)
+                cnt += lk_is_unstressed_vowel(*uw);
+            continue;
+        }
+
+        utf8proc_ssize_t len = lk_utf8_decode(uw, uend - uw, &cp);
         if (cp == -1)
             return 0;
 
@@ -322,18 +676,8 @@ int lk_is_ascii(const char *word) {
     if (word == NULL)
         return 0;
 
-    utf8proc_uint8_t *uw = (utf8proc_uint8_t*)word;
-    utf8proc_int32_t cp;
-
-    while (*uw) {
-        size_t len = utf8proc_iterate(uw, -1, &cp);
-        if (cp == -1 || cp > 127)
-            return 0;
-
-        uw += len;
-    }
-
-    return 1;
+    size_t len = strlen(word);
+    return ascii_run((const utf8proc_uint8_t*)word, len) == len;
 }
 
 /**
@@ -352,32 +696,80 @@ int lk_is_ascii(const char *word) {
  *  LK_INVALID_STRING - the original string is not correct UTF8 sequence
  */
 lk_result lk_to_ascii(const char *word, char *out, size_t out_sz) {
+    if (word == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_to_ascii_n(word, strlen(word), out, out_sz);
+}
+
+/* converts a word to ASCII, a trusted word is decoded without checks */
+static lk_result to_ascii(const char *word, size_t len, char *out, size_t out_sz, int trusted) {
     if (word == NULL || out == NULL)
         return LK_INVALID_ARG;
 
-    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + len;
     utf8proc_uint8_t *udst = (utf8proc_uint8_t*)out;
     utf8proc_int32_t cp;
 
-    while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cp);
+    while (usrc < uend) {
+        if (*usrc < 0x80) {
+            /* only grave accent changes: it becomes a single quote mark */
+            size_t n = ascii_run(usrc, uend - usrc);
+            size_t fit = ascii_fit(n, out_sz);
+            size_t idx = 0;
+            for (; idx + 8 <= fit; idx += 8) {
+                unsigned long long x = load8(usrc + idx);
+                unsigned long long grave = (ascii_eq(x, '`') >> 7) * 0xFF;
+                store8(udst + idx, (x & ~grave) | (grave & (LK_ONES * '\'')));
+            }
+            for (; idx < fit; idx++)
+                udst[idx] = usrc[idx] == '`' ? '\'' : usrc[idx];
+            if (fit != n)
+                return LK_BUFFER_SMALL;
+            usrc += n;
+            udst += n;
+            out_sz -= n;
+            continue;
+        }
+
+        utf8proc_ssize_t cplen = decode_char(usrc, uend, &cp, trusted);
         if (cp == -1)
             return LK_INVALID_STRING;
 
         cp = lk_char_to_ascii(cp);
-        usrc += len;
-        if (cp_length(cp) >= out_sz)
+        usrc += cplen;
+        if (lk_utf8_cp_len(cp) >= out_sz)
             return LK_BUFFER_SMALL;
 
-        len = utf8proc_encode_char(cp, udst);
-        udst += len;
-        out_sz -= len;
+        cplen = lk_utf8_encode(cp, udst);
+        udst += cplen;
+        out_sz -= cplen;
     }
     *udst = '\0';
 
     return LK_OK;
 }
 
+/**
+ * Length-delimited version of lk_to_ascii: word is len bytes long and
+ *  does not have to end with zero, so a word is converted right in the text
+ *
+ * @sa lk_to_ascii
+ */
+lk_result lk_to_ascii_n(const char *word, size_t len, char *out, size_t out_sz) {
+    return to_ascii(word, len, out, out_sz, 0);
+}
+
+/**
+ * Version of lk_to_ascii_n for a word that is known to be correct UTF8
+ *
+ * @sa lk_to_low_case_trusted
+ */
+lk_result lk_to_ascii_trusted(const char *word, size_t len, char *out, size_t out_sz) {
+    return to_ascii(word, len, out, out_sz, 1);
+}
+
 /**
  * Remove diacritic marks from all vowels in the string
  *
@@ -393,32 +785,74 @@ lk_result lk_to_ascii(const char *word, char *out, size_t out_sz) {
  *  LK_INVALID_STRING - the original string is not correct UTF8 sequence
  */
 lk_result lk_destress(const char *word, char *out, size_t out_sz) {
+    if (word == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_destress_n(word, strlen(word), out, out_sz);
+}
+
+/* removes stress marks, a trusted word is decoded without checks */
+static lk_result destress(const char *word, size_t len, char *out, size_t out_sz, int trusted) {
     if (word == NULL || out == NULL)
         return LK_INVALID_ARG;
 
-    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + len;
     utf8proc_uint8_t *udst = (utf8proc_uint8_t*)out;
     utf8proc_int32_t cp;
 
-    while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cp);
+    while (usrc < uend) {
+        if (*usrc < 0x80) {
+            /* ASCII characters are copied as is */
+            size_t n = ascii_run(usrc, uend - usrc);
+            if (ascii_fit(n, out_sz) != n) {
+                memcpy(udst, usrc, ascii_fit(n, out_sz));
+                return LK_BUFFER_SMALL;
+            }
+            memcpy(udst, usrc, n);
+            usrc += n;
+            udst += n;
+            out_sz -= n;
+            continue;
+        }
+
+        utf8proc_ssize_t cplen = decode_char(usrc, uend, &cp, trusted);
         if (cp == -1)
             return LK_INVALID_STRING;
 
         cp = lk_stress_to_unstress(cp);
-        usrc += len;
-        if (cp_length(cp) >= out_sz)
+        usrc += cplen;
+        if (lk_utf8_cp_len(cp) >= out_sz)
             return LK_BUFFER_SMALL;
 
-        len = utf8proc_encode_char(cp, udst);
-        udst += len;
-        out_sz -= len;
+        cplen = lk_utf8_encode(cp, udst);
+        udst += cplen;
+        out_sz -= cplen;
     }
     *udst = '\0';
 
     return LK_OK;
 }
 
+/**
+ * Length-delimited version of lk_destress: word is len bytes long and
+ *  does not have to end with zero, so a word is converted right in the text
+ *
+ * @sa lk_destress
+ */
+lk_result lk_destress_n(const char *word, size_t len, char *out, size_t out_sz) {
+    return destress(word, len, out, out_sz, 0);
+}
+
+/**
+ * Version of lk_destress_n for a word that is known to be correct UTF8
+ *
+ * @sa lk_to_low_case_trusted
+ */
+lk_result lk_destress_trusted(const char *word, size_t len, char *out, size_t out_sz) {
+    return destress(word, len, out, out_sz, 1);
+}
+
 /**
  * Removes all glotal stops from the string. Glottal stop is one of LK_QUOTE,
  *  single quote mark or apostroph
@@ -430,32 +864,84 @@ lk_result lk_destress(const char *word, char *out, size_t out_sz) {
  *  LK_INVALID_STRING - the string is not valid UTF8 sequence
  */
 lk_result lk_remove_glottal_stop(const char *word, char *out, size_t out_sz) {
+    if (word == NULL)
+        return LK_INVALID_ARG;
+
+    return lk_remove_glottal_stop_n(word, strlen(word), out, out_sz);
+}
+
+/* removes glottal stops, a trusted word is decoded without checks */
+static lk_result remove_glottal_stop(const char *word, size_t len, char *out, size_t out_sz, int trusted) {
     if (word == NULL || out == NULL)
         return LK_INVALID_ARG;
 
-    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + len;
     utf8proc_uint8_t *udst = (utf8proc_uint8_t*)out;
     utf8proc_int32_t cp;
 
-    while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cp);
-        usrc += len;
+    while (usrc < uend) {
+        if (*usrc < 0x80) {
+            /* blocks without quote marks are copied as is */
+            size_t n = ascii_run(usrc, uend - usrc);
+            for (; n >= 8 && out_sz > 8; n -= 8, usrc += 8) {
+                unsigned long long x = load8(usrc);
+                if (ascii_quotes(x))
+                    break;
+                store8(udst, x);
+                udst += 8;
+                out_sz -= 8;
+            }
+            for (; n != 0; n--, usrc++) {
+                if (*usrc == '\'' || *usrc == '`')
+                    continue;
+                if (out_sz <= 1)
+                    return LK_BUFFER_SMALL;
+                *udst++ = *usrc;
+                out_sz--;
+            }
+            continue;
+        }
+
+        utf8proc_ssize_t cplen = decode_char(usrc, uend, &cp, trusted);
+        if (cp == -1)
+            return LK_INVALID_STRING;
+        usrc += cplen;
 
         if (lk_is_glottal_stop(cp))
             continue;
 
-        if (cp_length(cp) >= out_sz)
+        if (lk_utf8_cp_len(cp) >= out_sz)
             return LK_BUFFER_SMALL;
 
-        len = utf8proc_encode_char(cp, udst);
-        udst += len;
-        out_sz -= len;
+        cplen = lk_utf8_encode(cp, udst);
+        udst += cplen;
+        out_sz -= cplen;
     }
     *udst = '\0';
 
     return LK_OK;
 }
 
+/**
+ * Length-delimited version of lk_remove_glottal_stop: word is len bytes long and
+ *  does not have to end with zero, so a word is converted right in the text
+ *
+ * @sa lk_remove_glottal_stop
+ */
+lk_result lk_remove_glottal_stop_n(const char *word, size_t len, char *out, size_t out_sz) {
+    return remove_glottal_stop(word, len, out, out_sz, 0);
+}
+
+/**
+ * Version of lk_remove_glottal_stop_n for a word that is known to be correct UTF8
+ *
+ * @sa lk_to_low_case_trusted
+ */
+lk_result lk_remove_glottal_stop_trusted(const char *word, size_t len, char *out, size_t out_sz) {
+    return remove_glottal_stop(word, len, out, out_sz, 1);
+}
+
 /**
  * Returns 1 if a string contains glotal stop. Glottal stop is one of LK_QUOTE,
  *  single quote mark or apostroph.
@@ -464,14 +950,26 @@ int lk_has_glottal_stop(const char *word) {
     if (word == NULL)
         return 0;
 
-    utf8proc_uint8_t *usrc = (utf8proc_uint8_t*)word;
-    utf8proc_int32_t cp;
-
-    while (*usrc) {
-        size_t len = utf8proc_iterate(usrc, -1, &cp);
-        usrc += len;
+    /* glottal stops are ' ` or the UTF8 sequences of LK_QUOTE (CA BC) and
+     * LK_QUOTE2 (E2 80 99), so the string is not decoded. Blocks without
+     * these bytes are skipped */
+    const utf8proc_uint8_t *usrc = (const utf8proc_uint8_t*)word;
+    const utf8proc_uint8_t *uend = usrc + strlen(word);
+    while (usrc + 8 <= uend) {
+        unsigned long long x = load8(usrc);
+        if (byte_eq(x, '\'') | byte_eq(x, '`') | byte_eq(x, 0xCA) | byte_eq(x, 0xE2))
+            break;
+        usrc += 8;
+    }
 
-        if (lk_is_glottal_stop(cp))
+    for (; usrc < uend; usrc++) {
+        utf8proc_uint8_t b = *usrc;
+        if (b == '\'' || b == '`')
+            return 1;
+        /* the bytes after b are read only if they are not the end */
+        if (b == 0xCA && usrc[1] == 0xBC)
+            return 1;
+        if (b == 0xE2 && usrc[1] == 0x80 && usrc[2] == 0x99)
             return 1;
     }
 
@@ -479,24 +977,7 @@ int lk_has_glottal_stop(const char *word) {
 }
 
 static int is_lk_char(utf8proc_uint32_t c) {
-    if ((c >= 'a' && c <= 'z')
-        || (c >= 'A' && c <= 'Z')
-        || c == LK_QUOTE || c == LK_QUOTE2)
-        return 1;
-
-    size_t sz = sizeof(lk_low_case) / sizeof(lk_low_case[0]);
-    for (size_t idx = 0; idx < sz; idx++) {
-        if (lk_low_case[idx] == c)
-            return 1;
-    }
-
-    sz = sizeof(lk_up_case) / sizeof(lk_up_case[0]);
-    for (size_t idx = 0; idx < sz; idx++) {
-        if (lk_up_case[idx] == c)
-            return 1;
-    }
-
-    return 0;
+    return (lk_char_get((int)c)->flags & LK_CH_LETTER) != 0;
 }
 
 /**
@@ -538,7 +1019,7 @@ const char* lk_word_begin(const char *str, size_t pos) {
 
     if (pos == 0) {
         usrc = (utf8proc_uint8_t *)idx;
-        utf8proc_iterate(usrc, -1, &cp);
+        lk_utf8_decode(usrc, -1, &cp);
         if (cp == -1)
             return NULL;
 
@@ -553,7 +1034,7 @@ const char* lk_word_begin(const char *str, size_t pos) {
         }
 
         usrc = (utf8proc_uint8_t *)idx;
-        utf8proc_iterate(usrc, -1, &cp);
+        lk_utf8_decode(usrc, -1, &cp);
         if (cp == -1)
             return NULL;
 
@@ -567,7 +1048,7 @@ const char* lk_word_begin(const char *str, size_t pos) {
             save = idx--;
             if (idx == str) {
                 usrc = (utf8proc_uint8_t *)idx;
-                utf8proc_iterate(usrc, -1, &cp);
+                lk_utf8_decode(usrc, -1, &cp);
                 if (! is_lk_char(cp))
                     state = LK_STATE_DONE;
             }
@@ -639,7 +1120,7 @@ const char* lk_next_word(const char *str, size_t *len) {
             continue;
         }
 
-        size_t cplen = utf8proc_iterate(usrc, -1, &cp);
+        size_t cplen = lk_utf8_decode(usrc, -1, &cp);
         if (cp == -1)
             return NULL;
 
@@ -683,3 +1164,170 @@ const char* lk_next_word(const char *str, size_t *len) {
 
     return wstart;
 }
+
+static int is_ascii_letter(utf8proc_uint8_t b) {
+    return (utf8proc_uint8_t)((b | 0x20) - 'a') < 26;
+}
+
+#ifdef LK_SSE2
+/* returns the index of the lowest set bit of a non-zero mask */
+static unsigned int lk_first_bit(unsigned int mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+/* returns a mask of ASCII letters among 16 bytes, and bytes >= 0x80 in high.
+ * Setting bit 0x20 makes a letter low case and keeps other bytes out of the
+ * a..z range. Bytes >= 0x80 are negative for the signed compare */
+static unsigned int letters16(const utf8proc_uint8_t *s, unsigned int *high) {
+    __m128i v = _mm_loadu_si128((const __m128i*)s);
+    __m128i low = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(low, _mm_set1_epi8('a' - 1)),
+            _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), low));
+    *high = (unsigned int)_mm_movemask_epi8(v);
+    return (unsigned int)_mm_movemask_epi8(letter);
+}
+#endif
+
+/* returns the number of leading ASCII letters in the first len bytes */
+static size_t letter_run(const utf8proc_uint8_t *s, size_t len) {
+    size_t idx = 0;
+    unsigned int high;
+#ifdef LK_SSE2
+    for (; idx + 16 <= len; idx += 16) {
+        unsigned int mask = ~letters16(s + idx, &high) & 0xFFFF;
+        if (mask != 0)
+            return idx + lk_first_bit(mask);
+    }
+#endif
+    while (idx < len && is_ascii_letter(s[idx]))
+        idx++;
+    return idx;
+}
+
+/* returns the number of leading ASCII bytes that are not letters */
+static size_t gap_run(const utf8proc_uint8_t *s, size_t len) {
+    size_t idx = 0;
+    unsigned int high;
+#ifdef LK_SSE2
+    for (; idx + 16 <= len; idx += 16) {
+        unsigned int mask = letters16(s + idx, &high);
+        if ((mask | high) != 0)
+            return idx + lk_first_bit(mask | high);
+    }
+#endif
+    while (idx < len && s[idx] < 0x80 && !is_ascii_letter(s[idx]))
+        idx++;
+    return idx;
+}
+
+/* checks if a string starts with a letter of a Lakota word. Returns 1 for a
+ * letter, 0 for other characters and the end of the string, and -1 for
+ * invalid UTF8. cplen is filled with the length of the character */
+static int starts_with_letter(const utf8proc_uint8_t *s, size_t len, size_t *cplen) {
+    *cplen = 1;
+    if (len == 0)
+        return 0;
+    if (s[0] < 0x80)
+        return is_ascii_letter(s[0]);
+
+    utf8proc_int32_t cp;
+    utf8proc_ssize_t n = lk_utf8_decode(s, (utf8proc_ssize_t)len, &cp);
+    if (cp == -1)
+        return -1;
+    *cplen = (size_t)n;
+    return is_lk_char(cp);
+}
+
+/**
+ * Splits a buffer into words in one call. The words are the same that
+ *  consecutive calls of lk_next_word return for the buffer, each call starting
+ *  from the end of the previous word.
+ *
+ * @param[in] str is the buffer to split. It does not have to end with zero,
+ *  zero bytes inside the buffer separate words
+ * @param[in] len is the length of the buffer in bytes
+ * @param[out] words is filled with the offsets and lengths of the found words
+ * @param[in,out] count is the capacity of words. On return it is the number
+ *  of found words
+ *
+ * @return the result of the operation:
+ *  LK_OK - all words of the buffer are in words
+ *  LK_BUFFER_SMALL - words is full and the buffer has more words. The next
+ *   call can start from the end of the last found word
+ *  LK_INVALID_STRING - the buffer is not valid UTF8. words has the words that
+ *   end before the invalid sequence, like lk_next_word returns NULL for it
+ *  LK_INVALID_ARG - str or count is NULL, or words is NULL and count is not 0
+ *
+ * How it works:
+ *  Runs of ASCII letters and of ASCII non-letters are skipped by blocks of 16
+ *  bytes with SSE2. Only multibyte characters and glottal stops
+ *  are looked at one by one. A quote mark ' or ` inside a word belongs to it
+ *  only if a letter follows it
+ */
+lk_result lk_split_words(const char *str, size_t len, struct lk_word_span *words, size_t *count) {
+    if (str == NULL || count == NULL || (words == NULL && *count != 0))
+        return LK_INVALID_ARG;
+
+    const utf8proc_uint8_t *s = (const utf8proc_uint8_t *)str;
+    size_t cap = *count, found = 0, pos = 0, cplen;
+    *count = 0;
+
+    while (pos < len) {
+        pos += gap_run(s + pos, len - pos);
+        if (pos >= len)
+            break;
+
+        /* like lk_next_word skips parts of multibyte characters between words */
+        if ((s[pos] & 0xC0) == 0x80) {
+            pos++;
+            continue;
+        }
+
+        int r = starts_with_letter(s + pos, len - pos, &cplen);
+        if (r < 0)
+            break;
+        if (r == 0) {
+            pos += cplen;
+            continue;
+        }
+
+        if (found == cap) {
+            *count = found;
+            return LK_BUFFER_SMALL;
+        }
+
+        size_t start = pos;
+        pos += cplen;
+        for (;;) {
+            pos += letter_run(s + pos, len - pos);
+            if (pos >= len)
+                break;
+
+            if (s[pos] == '\'' || s[pos] == '`') {
+                r = starts_with_letter(s + pos + 1, len - pos - 1, &cplen);
+                if (r > 0)
+                    cplen++;
+            } else {
+                r = starts_with_letter(s + pos, len - pos, &cplen);
+            }
+            if (r <= 0)
+                break;
+            pos += cplen;
+        }
+        if (r < 0)
+            break;
+
+        words[found].offset = start;
+        words[found].len = pos - start;
+        found++;
+    }
+
+    *count = found;
+    return pos < len ? LK_INVALID_STRING : LK_OK;
+}
@@ -0,0 +1,1279 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "lk_common.h"
+#include "lk_dict.h"
+#include "lk_file.h"
+#include "lk_utils.h"
+
+#define BENCH_DICT "bench.dict"
+#define BENCH_IMAGE "bench.image"
+#define BENCH_FORMS 500000
+#define BENCH_TEXT_WORDS 1000000
+#define BENCH_BATCH 4096
+
+static double now_sec() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, cnt;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&cnt);
+    return (double)cnt.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/* returns the number of CPU cache misses of the process or -1 if hardware
+ * counters are not available */
+static long long cache_misses() {
+#ifdef __linux__
+    static int fd = -2;
+    if (fd == -2) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    long long cnt;
+    if (fd < 0 || read(fd, &cnt, sizeof(cnt)) != sizeof(cnt))
+        return -1;
+    return cnt;
+#else
+    return -1;
+#endif
+}
+
+/* xorshift - the same sequence of words on every platform */
+static unsigned int rnd_state = 2463534242u;
+static unsigned int rnd(unsigned int max) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state % max;
+}
+
+static const char *consonants[] = {
+    "", "k", "p", "t", "č", "ȟ", "ǧ", "š", "ž", "l", "m", "n", "w", "y",
+    "kʼ", "pʼ", "tʼ", "čʼ", "h", "s", "z", "b", "g", "kȟ", "ph", "th",
+};
+static const char *vowels[] = {"a", "e", "i", "o", "u", "aŋ", "iŋ", "uŋ"};
+static const char *stressed[] = {"á", "é", "í", "ó", "ú", "áŋ", "íŋ", "úŋ"};
+static const char *prefixes[] = {"ma", "ni", "wa", "uŋ", "ki", "ya", "wičha", "čhi"};
+static const char *suffixes[] = {"pi", "kte", "ŋ", "yA", "la", "šni", "ȟčA", "kA"};
+
+#define ARR_LEN(a) (sizeof(a)/sizeof(a[0]))
+
+/* generates a random Lakota-like word with one stressed vowel */
+static void gen_word(char *out) {
+    int syl = 2 + rnd(3);
+    int stress = rnd(syl);
+
+    *out = '\0';
+    for (int i = 0; i < syl; i++) {
+        strcat(out, consonants[rnd(ARR_LEN(consonants))]);
+        size_t v = rnd(ARR_LEN(vowels));
+        strcat(out, i == stress ? stressed[v] : vowels[v]);
+    }
+}
+
+/* writes a dictionary file with at least forms word forms */
+static size_t gen_dict(const char *path, size_t forms) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return 0;
+
+    char base[LK_MAX_WORD_LEN];
+    size_t total = 0;
+    while (total < forms) {
+        gen_word(base);
+        fputs(base, f);
+        total++;
+
+        int cnt = rnd(6);
+        for (int i = 0; i < cnt; i++) {
+            fputc(' ', f);
+            int kind = rnd(3);
+            if (kind != 1)
+                fputs(prefixes[rnd(ARR_LEN(prefixes))], f);
+            fputs(base, f);
+            if (kind != 0)
+                fputs(suffixes[rnd(ARR_LEN(suffixes))], f);
+            total++;
+        }
+        fputc('\n', f);
+    }
+
+    fclose(f);
+    return total;
+}
+
+static const char* bench_load(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    double start = now_sec();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    double load = now_sec() - start;
+    if (r != LK_OK) {
+        lk_dict_close(dict);
+        return "failed to load dictionary";
+    }
+    size_t words = lk_word_count(dict);
+
+    const size_t rounds = 1000000;
+    struct lk_dict_stats st;
+    start = now_sec();
+    for (size_t idx = 0; idx < rounds; idx++)
+        lk_dict_get_stats(dict, &st);
+    double stats = now_sec() - start;
+
+    start = now_sec();
+    lk_dict_close(dict);
+    double unload = now_sec() - start;
+
+    printf("  forms generated: %u, words loaded: %u\n", (unsigned)total, (unsigned)words);
+    printf("  base forms: %u, lookup keys: %u\n", (unsigned)st.bases, (unsigned)st.keys);
+    printf("  load: %.3f s, free: %.3f s, stats: %.1f ns\n", load, unload, stats * 1e9 / rounds);
+
+    remove(BENCH_DICT);
+    return NULL;
+}
+
+/**
+ * @struct bench_words
+ * All forms of a generated dictionary, used as lookup queries
+ */
+struct bench_words {
+    char *pool;
+    const char **words;
+    size_t cnt;
+};
+
+static void free_words(struct bench_words *w) {
+    free(w->pool);
+    free((void*)w->words);
+}
+
+/* reads all forms from a dictionary file. Every second query is made a miss */
+static int read_words(const char *path, struct bench_words *w) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    w->pool = (char*)malloc(sz * 2 + 1);
+    w->words = (const char**)malloc((sz + 1) * sizeof(char*));
+    w->cnt = 0;
+    if (w->pool == NULL || w->words == NULL || fread(w->pool, 1, sz, f) != (size_t)sz) {
+        fclose(f);
+        free_words(w);
+        return 0;
+    }
+    fclose(f);
+
+    char *miss = w->pool + sz;
+    char *p = w->pool, *end = w->pool + sz;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\n'))
+            *p++ = '\0';
+        if (p == end)
+            break;
+        w->words[w->cnt++] = p;
+        char *start = p;
+        while (p < end && *p != ' ' && *p != '\n')
+            p++;
+        if (w->cnt % 2 == 0 && p - start > 2) {
+            /* the same word with the first byte changed */
+            memcpy(miss, start, p - start);
+            miss[0] = 'q';
+            miss[p - start] = '\0';
+            w->words[w->cnt - 1] = miss;
+            miss += p - start + 1;
+        }
+    }
+    *p = '\0';
+
+    return 1;
+}
+
+static double time_lookups(const struct lk_dictionary *dict, const struct bench_words *w,
+        size_t rounds, size_t *found) {
+    double start = now_sec();
+    *found = 0;
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t idx = 0; idx < w->cnt; idx++) {
+            if (lk_dict_find_word(dict, w->words[idx]) != NULL)
+                (*found)++;
+        }
+    }
+    return now_sec() - start;
+}
+
+static const char* bench_search(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    struct bench_words w;
+    if (r != LK_OK || !read_words(BENCH_DICT, &w)) {
+        lk_dict_close(dict);
+        return "failed to load dictionary";
+    }
+    remove(BENCH_DICT);
+
+    const size_t rounds = 5;
+    size_t found, found_frozen;
+    double linked = time_lookups(dict, &w, rounds, &found);
+
+    double start = now_sec();
+    r = lk_dict_freeze(dict);
+    double freeze = now_sec() - start;
+    if (r != LK_OK) {
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to freeze dictionary";
+    }
+    double frozen = time_lookups(dict, &w, rounds, &found_frozen);
+
+    double n = (double)(rounds * w.cnt);
+    printf("  queries: %u x %u, found: %u\n", (unsigned)w.cnt, (unsigned)rounds, (unsigned)(found / rounds));
+    printf("  linked tree: %.1f ns/lookup\n", linked * 1e9 / n);
+    printf("  freeze: %.3f s\n", freeze);
+    printf("  double-array: %.1f ns/lookup\n", frozen * 1e9 / n);
+
+    free_words(&w);
+    lk_dict_close(dict);
+
+    if (found != found_frozen)
+        return "frozen dictionary returned different results";
+    return NULL;
+}
+
+static const char* bench_dawg(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    struct bench_words w;
+    if (r != LK_OK || !read_words(BENCH_DICT, &w)) {
+        lk_dict_close(dict);
+        return "failed to load dictionary";
+    }
+    remove(BENCH_DICT);
+
+    const size_t rounds = 5;
+    size_t found, found_min;
+    struct lk_dict_stats before, after;
+    lk_dict_get_stats(dict, &before);
+    double tree = time_lookups(dict, &w, rounds, &found);
+
+    double start = now_sec();
+    r = lk_dict_minimize(dict);
+    double minimize = now_sec() - start;
+    if (r != LK_OK) {
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to minimize dictionary";
+    }
+    lk_dict_get_stats(dict, &after);
+    double dawg = time_lookups(dict, &w, rounds, &found_min);
+
+    double n = (double)(rounds * w.cnt);
+    printf("  tree: %u nodes, %.1f MiB, %.1f ns/lookup\n", (unsigned)before.nodes,
+            before.tree_memory / 1048576.0, tree * 1e9 / n);
+    printf("  minimize: %.3f s\n", minimize);
+    printf("  dawg: %u nodes, %.1f MiB, %.1f ns/lookup\n", (unsigned)after.nodes,
+            after.tree_memory / 1048576.0, dawg * 1e9 / n);
+
+    free_words(&w);
+    lk_dict_close(dict);
+
+    if (found != found_min)
+        return "minimized dictionary returned different results";
+    return NULL;
+}
+
+static const char* bench_image(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    double start = now_sec();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    double load = now_sec() - start;
+    struct bench_words w;
+    if (r != LK_OK || !read_words(BENCH_DICT, &w)) {
+        lk_dict_close(dict);
+        return "failed to load dictionary";
+    }
+    remove(BENCH_DICT);
+
+    start = now_sec();
+    r = lk_dict_save_image(dict, BENCH_IMAGE);
+    double save = now_sec() - start;
+    if (r != LK_OK) {
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to save image";
+    }
+
+    const size_t rounds = 5;
+    size_t found, found_image;
+    double frozen = time_lookups(dict, &w, rounds, &found);
+    lk_dict_close(dict);
+
+    start = now_sec();
+    dict = lk_dict_open_image(BENCH_IMAGE);
+    double open = now_sec() - start;
+    if (dict == NULL) {
+        free_words(&w);
+        remove(BENCH_IMAGE);
+        return "failed to open image";
+    }
+    double image = time_lookups(dict, &w, rounds, &found_image);
+
+    double n = (double)(rounds * w.cnt);
+    printf("  text load: %.3f s, freeze and save: %.3f s\n", load, save);
+    printf("  image open: %.6f s\n", open);
+    printf("  frozen: %.1f ns/lookup, image: %.1f ns/lookup\n", frozen * 1e9 / n, image * 1e9 / n);
+
+    free_words(&w);
+    lk_dict_close(dict);
+    remove(BENCH_IMAGE);
+
+    if (found != found_image)
+        return "image returned different results";
+    return NULL;
+}
+
+/* returns non-zero if two files have the same content */
+static int same_files(const char *path1, const char *path2) {
+    FILE *f1 = fopen(path1, "rb"), *f2 = fopen(path2, "rb");
+    int same = f1 != NULL && f2 != NULL;
+    char b1[65536], b2[65536];
+    while (same) {
+        size_t n1 = fread(b1, 1, sizeof(b1), f1), n2 = fread(b2, 1, sizeof(b2), f2);
+        same = n1 == n2 && memcmp(b1, b2, n1) == 0;
+        if (n1 == 0)
+            break;
+    }
+    if (f1 != NULL)
+        fclose(f1);
+    if (f2 != NULL)
+        fclose(f2);
+    return same;
+}
+
+static const char* bench_parallel(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    double start = now_sec();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    double seq = now_sec() - start;
+    if (r != LK_OK || lk_dict_save_image(dict, BENCH_IMAGE) != LK_OK) {
+        lk_dict_close(dict);
+        remove(BENCH_DICT);
+        return "failed to load dictionary";
+    }
+    lk_dict_close(dict);
+    printf("  sequential: %.3f s\n", seq);
+
+    const char *err = NULL;
+    size_t threads[] = {2, 4, 8, 0};
+    for (size_t idx = 0; idx < ARR_LEN(threads) && err == NULL; idx++) {
+        dict = lk_dict_init();
+        start = now_sec();
+        r = lk_read_dictionary_parallel(dict, BENCH_DICT, threads[idx]);
+        double par = now_sec() - start;
+        if (r != LK_OK || lk_dict_save_image(dict, BENCH_IMAGE ".par") != LK_OK)
+            err = "failed to load dictionary in parallel";
+        else if (!same_files(BENCH_IMAGE, BENCH_IMAGE ".par"))
+            err = "parallel load differs from sequential one";
+        lk_dict_close(dict);
+
+        if (threads[idx] == 0)
+            printf("  all cores: %.3f s (x%.2f)\n", par, seq / par);
+        else
+            printf("  %u threads: %.3f s (x%.2f)\n", (unsigned)threads[idx], par, seq / par);
+    }
+
+    remove(BENCH_DICT);
+    remove(BENCH_IMAGE);
+    remove(BENCH_IMAGE ".par");
+    return err;
+}
+
+/* builds the dictionary forms of a word with one call per conversion */
+static size_t separate_forms(const char *word) {
+    char low[LK_MAX_WORD_LEN], tmp[LK_MAX_WORD_LEN], buf[LK_MAX_WORD_LEN];
+    size_t len = 0;
+
+    if (lk_to_low_case(word, low, LK_MAX_WORD_LEN) != LK_OK)
+        return 0;
+    lk_remove_glottal_stop(low, buf, LK_MAX_WORD_LEN);
+    len += strlen(buf);
+    lk_destress(low, tmp, LK_MAX_WORD_LEN);
+    lk_remove_glottal_stop(tmp, buf, LK_MAX_WORD_LEN);
+    len += strlen(buf);
+    lk_to_ascii(tmp, buf, LK_MAX_WORD_LEN);
+    lk_remove_glottal_stop(buf, tmp, LK_MAX_WORD_LEN);
+    len += strlen(tmp);
+    return len + (lk_has_glottal_stop(word) + lk_stressed_vowels_no(word));
+}
+
+static const char* bench_forms(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct bench_words w;
+    if (!read_words(BENCH_DICT, &w)) {
+        remove(BENCH_DICT);
+        return "failed to read dictionary";
+    }
+    remove(BENCH_DICT);
+
+    const size_t rounds = 5;
+    size_t sum_separate = 0, sum_fused = 0;
+    double start = now_sec();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t idx = 0; idx < w.cnt; idx++)
+            sum_separate += separate_forms(w.words[idx]);
+    }
+    double separate = now_sec() - start;
+
+    struct lk_forms f;
+    start = now_sec();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t idx = 0; idx < w.cnt; idx++) {
+            if (lk_normalize_forms(w.words[idx], LK_FORMS_DICT, &f) == LK_OK)
+                sum_fused += f.distinct;
+        }
+    }
+    double fused = now_sec() - start;
+
+    double n = (double)(rounds * w.cnt);
+    printf("  words: %u x %u (checksums %u, %u)\n", (unsigned)w.cnt, (unsigned)rounds,
+            (unsigned)sum_separate, (unsigned)sum_fused);
+    printf("  separate conversions: %.1f ns/word\n", separate * 1e9 / n);
+    printf("  lk_normalize_forms: %.1f ns/word (x%.2f)\n", fused * 1e9 / n, separate / fused);
+
+    free_words(&w);
+    return NULL;
+}
+
+static const char* bench_folded(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct bench_words w;
+    if (!read_words(BENCH_DICT, &w)) {
+        remove(BENCH_DICT);
+        return "failed to read dictionary";
+    }
+
+    const char *err = NULL;
+    const char *names[] = {"all forms", "folded"};
+    lk_index_mode modes[] = {LK_INDEX_ALL_FORMS, LK_INDEX_FOLDED};
+    size_t found[2] = {0, 0};
+    const size_t rounds = 5;
+    for (size_t idx = 0; idx < ARR_LEN(modes) && err == NULL; idx++) {
+        struct lk_dictionary *dict = lk_dict_init();
+        lk_dict_set_index_mode(dict, modes[idx]);
+        double start = now_sec();
+        lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+        double load = now_sec() - start;
+        struct lk_dict_stats st;
+        if (r != LK_OK || lk_dict_get_stats(dict, &st) != LK_OK) {
+            lk_dict_close(dict);
+            err = "failed to load dictionary";
+            break;
+        }
+        double lookup = time_lookups(dict, &w, rounds, &found[idx]);
+
+        printf("  %s: load %.3f s, %u nodes, %.1f MiB, %.1f ns/lookup\n", names[idx], load,
+                (unsigned)st.nodes, st.tree_memory / (1024.0 * 1024.0),
+                lookup * 1e9 / (double)(rounds * w.cnt));
+        lk_dict_close(dict);
+    }
+
+    free_words(&w);
+    remove(BENCH_DICT);
+    if (err == NULL && found[0] != found[1])
+        err = "folded index returned different results";
+    return err;
+}
+
+/* reads words of a text file. ASCII characters except letters, digits and
+ * glottal stop marks separate words */
+static int read_text(const char *path, struct bench_words *w) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    w->pool = (char*)malloc(sz + 1);
+    w->words = (const char**)malloc((sz / 2 + 1) * sizeof(char*));
+    w->cnt = 0;
+    if (w->pool == NULL || w->words == NULL || fread(w->pool, 1, sz, f) != (size_t)sz) {
+        fclose(f);
+        free_words(w);
+        return 0;
+    }
+    fclose(f);
+
+    char *p = w->pool, *end = w->pool + sz;
+    for (; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c < 0x80 && c != '\'' && c != '`' && !(c >= '0' && c <= '9')
+            && !((c | 0x20) >= 'a' && (c | 0x20) <= 'z')) {
+            *p = '\0';
+        } else if (p == w->pool || p[-1] == '\0') {
+            w->words[w->cnt++] = p;
+        }
+    }
+    *p = '\0';
+
+    return 1;
+}
+
+/* picks an index with probability proportional to 1/index, like the
+ * frequency of words in a real text */
+static size_t zipf_index(size_t cnt) {
+    unsigned int bits = 0;
+    while (bits < 31 && ((size_t)1 << bits) < cnt)
+        bits++;
+    size_t idx = rnd(1u << rnd(bits + 1));
+    return idx < cnt ? idx : idx % cnt;
+}
+
+/* builds a document from the dictionary forms: frequent words repeat like in
+ * a real text and every eighth word starts with a capital letter */
+static int gen_text(const struct bench_words *forms, size_t cnt, struct bench_words *doc) {
+    doc->pool = (char*)malloc((cnt / 8 + 1) * LK_MAX_WORD_LEN);
+    doc->words = (const char**)malloc(cnt * sizeof(char*));
+    doc->cnt = 0;
+    if (doc->pool == NULL || doc->words == NULL) {
+        free_words(doc);
+        return 0;
+    }
+
+    char *cap = doc->pool;
+    for (size_t idx = 0; idx < cnt; idx++) {
+        const char *word = forms->words[zipf_index(forms->cnt)];
+        size_t len = strlen(word);
+        if (idx % 8 == 0 && len < LK_MAX_WORD_LEN && *word >= 'a' && *word <= 'z') {
+            memcpy(cap, word, len + 1);
+            *cap -= 'a' - 'A';
+            word = cap;
+            cap += len + 1;
+        }
+        doc->words[doc->cnt++] = word;
+    }
+
+    return 1;
+}
+
+/**
+ * @struct bench_check
+ * Summary of spell checking a document, used to compare lookup methods
+ */
+struct bench_check {
+    size_t correct;
+    size_t suggested;
+    size_t not_found;
+    size_t suggestions;
+};
+
+static double check_by_word(const struct lk_dictionary *dict, const struct bench_words *doc,
+        struct bench_check *res) {
+    memset(res, 0, sizeof(*res));
+    double start = now_sec();
+    for (size_t idx = 0; idx < doc->cnt; idx++) {
+        int cnt;
+        char **list = lk_dict_exact_lookup(dict, doc->words[idx], &cnt);
+        if (list != NULL) {
+            res->suggested++;
+            res->suggestions += cnt;
+        } else if (cnt == 0) {
+            res->correct++;
+        } else {
+            res->not_found++;
+        }
+        lk_exact_lookup_free(list);
+    }
+    return now_sec() - start;
+}
+
+static double check_by_view(const struct lk_dictionary *dict, const struct bench_words *doc,
+        struct bench_check *res) {
+    const char *suggestions[64];
+
+    memset(res, 0, sizeof(*res));
+    double start = now_sec();
+    for (size_t idx = 0; idx < doc->cnt; idx++) {
+        size_t cnt = ARR_LEN(suggestions);
+        lk_result r = lk_dict_lookup_view(dict, doc->words[idx], suggestions, &cnt);
+        if (r == LK_OK || r == LK_BUFFER_SMALL) {
+            res->suggested++;
+            res->suggestions += cnt;
+        } else if (r == LK_EXACT_MATCH) {
+            res->correct++;
+        } else {
+            res->not_found++;
+        }
+    }
+    return now_sec() - start;
+}
+
+static double check_by_batch(const struct lk_dictionary *dict, const struct bench_words *doc,
+        struct bench_check *res) {
+    struct lk_lookup_result results[BENCH_BATCH];
+    size_t sugg_cap = BENCH_BATCH;
+    const char **suggestions = (const char**)malloc(sugg_cap * sizeof(char*));
+
+    memset(res, 0, sizeof(*res));
+    double start = now_sec();
+    for (size_t first = 0; first < doc->cnt && suggestions != NULL; first += BENCH_BATCH) {
+        size_t n = doc->cnt - first < BENCH_BATCH ? doc->cnt - first : BENCH_BATCH;
+        size_t sugg_count = sugg_cap;
+        lk_result r = lk_dict_lookup_batch(dict, doc->words + first, n, results,
+                suggestions, &sugg_count);
+        if (r == LK_BUFFER_SMALL) {
+            free((void*)suggestions);
+            sugg_cap = sugg_count;
+            suggestions = (const char**)malloc(sugg_cap * sizeof(char*));
+            first -= BENCH_BATCH;
+            continue;
+        }
+
+        for (size_t idx = 0; idx < n; idx++) {
+            if (results[idx].status == LK_OK) {
+                res->suggested++;
+                res->suggestions += results[idx].count;
+            } else if (results[idx].status == LK_EXACT_MATCH) {
+                res->correct++;
+            } else {
+                res->not_found++;
+            }
+        }
+    }
+    double elapsed = now_sec() - start;
+
+    free((void*)suggestions);
+    return elapsed;
+}
+
+static void print_misses(long long before, long long after, size_t words) {
+    if (before < 0 || after < 0)
+        printf("cache misses n/a");
+    else
+        printf("%.2f cache misses/word", (double)(after - before) / words);
+}
+
+/* checks the document word by word, by word without allocations and by
+ * batches and prints the speed of all of them */
+static const char* compare_checks(const struct lk_dictionary *dict, const struct bench_words *doc,
+        const char *name) {
+    struct bench_check by_word, by_view, by_batch;
+    long long m0 = cache_misses();
+    double t_word = check_by_word(dict, doc, &by_word);
+    long long m1 = cache_misses();
+    double t_view = check_by_view(dict, doc, &by_view);
+    long long m2 = cache_misses();
+    double t_batch = check_by_batch(dict, doc, &by_batch);
+    long long m3 = cache_misses();
+
+    printf("  %s: %u words, %u correct, %u with suggestions\n", name,
+            (unsigned)doc->cnt, (unsigned)by_word.correct, (unsigned)by_word.suggested);
+    printf("    exact lookup: %.0f words/s, ", doc->cnt / t_word);
+    print_misses(m0, m1, doc->cnt);
+    printf("\n    view lookup: %.0f words/s, ", doc->cnt / t_view);
+    print_misses(m1, m2, doc->cnt);
+    printf("\n    batch: %.0f words/s, ", doc->cnt / t_batch);
+    print_misses(m2, m3, doc->cnt);
+    printf("\n");
+
+    if (memcmp(&by_word, &by_view, sizeof(by_word)) != 0)
+        return "view lookup returned different results";
+    if (memcmp(&by_word, &by_batch, sizeof(by_word)) != 0)
+        return "batch lookup returned different results";
+    return NULL;
+}
+
+/* makes a document of every form with the same long prefix: all batch
+ * keys have equal first 8 bytes, so they are sorted by the rest of the key */
+static int gen_same_prefix(const struct bench_words *w, struct bench_words *doc) {
+    const char *prefix = "wičháša";
+    size_t plen = strlen(prefix), size = 0;
+    for (size_t idx = 0; idx < w->cnt; idx++)
+        size += plen + strlen(w->words[idx]) + 1;
+
+    doc->cnt = w->cnt;
+    doc->pool = (char*)malloc(size);
+    doc->words = (const char**)malloc(w->cnt * sizeof(char*));
+    if (doc->pool == NULL || doc->words == NULL) {
+        free_words(doc);
+        return 0;
+    }
+
+    char *dst = doc->pool;
+    for (size_t idx = 0; idx < w->cnt; idx++) {
+        doc->words[idx] = dst;
+        memcpy(dst, prefix, plen);
+        strcpy(dst + plen, w->words[idx]);
+        dst += plen + strlen(w->words[idx]) + 1;
+    }
+    return 1;
+}
+
+static const char* bench_batch(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    struct bench_words w, doc;
+    if (r != LK_OK || !read_words(BENCH_DICT, &w)) {
+        lk_dict_close(dict);
+        return "failed to load dictionary";
+    }
+    remove(BENCH_DICT);
+
+    /* a real text can be checked instead of the generated one */
+    const char *text = getenv("LK_BENCH_TEXT");
+    int ok = (text != NULL) ? read_text(text, &doc) : gen_text(&w, BENCH_TEXT_WORDS, &doc);
+    if (!ok) {
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to read text";
+    }
+
+    /* every form once in random order: no word repeats and almost every
+     * tree node is read from memory */
+    struct bench_words uniform = {NULL, NULL, w.cnt};
+    uniform.words = (const char**)malloc(w.cnt * sizeof(char*));
+    if (uniform.words == NULL) {
+        free_words(&doc);
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to allocate memory";
+    }
+    memcpy((void*)uniform.words, w.words, w.cnt * sizeof(char*));
+    for (size_t idx = uniform.cnt; idx > 1; idx--) {
+        size_t other = rnd((unsigned int)idx);
+        const char *tmp = uniform.words[idx - 1];
+        uniform.words[idx - 1] = uniform.words[other];
+        uniform.words[other] = tmp;
+    }
+
+    struct bench_words prefixed;
+    if (!gen_same_prefix(&uniform, &prefixed)) {
+        free_words(&uniform);
+        free_words(&doc);
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to allocate memory";
+    }
+
+    const char *err = NULL;
+    const char *names[] = {"linked, text", "linked, all forms", "linked, same prefix",
+        "frozen, text", "frozen, all forms", "frozen, same prefix"};
+    const struct bench_words *docs[] = {&doc, &uniform, &prefixed};
+    for (size_t idx = 0; idx < ARR_LEN(names) && err == NULL; idx++) {
+        if (idx == 3 && lk_dict_freeze(dict) != LK_OK) {
+            err = "failed to freeze dictionary";
+            break;
+        }
+        err = compare_checks(dict, docs[idx % 3], names[idx]);
+    }
+
+    free_words(&prefixed);
+    free_words(&uniform);
+    free_words(&doc);
+    free_words(&w);
+    lk_dict_close(dict);
+    return err;
+}
+
+/* checks the same text without the cache and with caches of several sizes */
+static const char* bench_cache(size_t forms) {
+    size_t total = gen_dict(BENCH_DICT, forms);
+    if (total == 0)
+        return "failed to generate dictionary";
+
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_result r = lk_read_dictionary(dict, BENCH_DICT);
+    struct bench_words w, doc;
+    if (r != LK_OK || !read_words(BENCH_DICT, &w)) {
+        lk_dict_close(dict);
+        return "failed to load dictionary";
+    }
+    remove(BENCH_DICT);
+
+    const char *text = getenv("LK_BENCH_TEXT");
+    int ok = (text != NULL) ? read_text(text, &doc) : gen_text(&w, BENCH_TEXT_WORDS, &doc);
+    if (!ok) {
+        free_words(&w);
+        lk_dict_close(dict);
+        return "failed to read text";
+    }
+
+    const char *err = NULL;
+    const size_t sizes[] = {0, 256, 4096, 65536};
+    struct bench_check first;
+    for (int frozen = 0; frozen < 2 && err == NULL; frozen++) {
+        if (frozen && lk_dict_freeze(dict) != LK_OK) {
+            err = "failed to freeze dictionary";
+            break;
+        }
+        for (size_t idx = 0; idx < ARR_LEN(sizes) && err == NULL; idx++) {
+            struct bench_check res;
+            struct lk_cache_stats st;
+            lk_dict_set_cache(dict, sizes[idx]);
+            double t_word = check_by_word(dict, &doc, &res);
+            lk_dict_cache_stats(dict, &st);
+            printf("  %s, cache %u: %.0f words/s, %.1f%% hits\n", frozen ? "frozen" : "linked",
+                    (unsigned)sizes[idx], doc.cnt / t_word,
+                    st.hits + st.misses == 0 ? 0.0 : 100.0 * st.hits / (st.hits + st.misses));
+            if (frozen == 0 && idx == 0)
+                first = res;
+            else if (memcmp(&first, &res, sizeof(res)) != 0)
+                err = "cached lookup returned different results";
+        }
+    }
+
+    free_words(&doc);
+    free_words(&w);
+    lk_dict_close(dict);
+    return err;
+}
+
+/* reads the file with lk_file_read and returns the number of bytes of all lines */
+static size_t read_by_copy(const char *path, size_t *lines) {
+    char buf[4096];
+    size_t bytes = 0;
+    struct lk_file *f = lk_file_open(path);
+    *lines = 0;
+    while (lk_file_read(f, buf, sizeof(buf)) == LK_OK) {
+        bytes += strlen(buf);
+        (*lines)++;
+    }
+    lk_file_close(f);
+    return bytes;
+}
+
+/* reads the file with lk_file_read_line */
+static size_t read_by_line(const char *path, lk_file_mode mode, size_t *lines) {
+    const char *line;
+    size_t len, bytes = 0;
+    struct lk_file *f = lk_file_open_ex(path, mode);
+    *lines = 0;
+    while (lk_file_read_line(f, &line, &len) == LK_OK) {
+        bytes += len;
+        (*lines)++;
+    }
+    lk_file_close(f);
+    return bytes;
+}
+
+/* reads the file with lk_file_next_line_view, wait receives the time the
+ * reader waited for blocks */
+static size_t read_by_view(const char *path, lk_file_mode mode, size_t *lines, double *wait) {
+    const char *line;
+    size_t len, bytes = 0;
+    struct lk_file *f = lk_file_open_ex(path, mode);
+    *lines = 0;
+    while (lk_file_next_line_view(f, &line, &len) == LK_OK) {
+        bytes += len;
+        (*lines)++;
+    }
+    struct lk_file_stats st;
+    *wait = lk_file_get_stats(f, &st) == LK_OK ? st.wait_ns / 1e9 : 0;
+    lk_file_close(f);
+    return bytes;
+}
+
+/* writes a text of long lines: a line has up to 3000 bytes, like a paragraph */
+static int gen_paragraphs(const char *path, size_t words) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return 0;
+
+    char word[LK_MAX_WORD_LEN];
+    size_t line = 0;
+    for (size_t idx = 0; idx < words; idx++) {
+        gen_word(word);
+        size_t len = strlen(word);
+        if (line + len + 1 > 3000 || rnd(400) == 0) {
+            fputs(rnd(2) ? "\n" : "\r\n", f);
+            line = 0;
+        } else if (line != 0) {
+            fputc(' ', f);
+            line++;
+        }
+        fputs(word, f);
+        line += len;
+    }
+
+    fclose(f);
+    return 1;
+}
+
+static const char* bench_read(size_t forms) {
+    if (gen_dict(BENCH_DICT, forms * 4) == 0 || !gen_paragraphs(BENCH_IMAGE, forms * 4))
+        return "failed to generate text";
+
+    const char *files[] = {BENCH_DICT, BENCH_IMAGE};
+    const char *file_names[] = {"short lines", "long lines"};
+    const char *names[] = {"lk_file_read", "view, buffered", "view, mmap", "view, read-ahead",
+        "read line, buffered", "read line, mmap"};
+    const lk_file_mode modes[] = {LK_FILE_BUFFERED, LK_FILE_BUFFERED, LK_FILE_MMAP,
+        LK_FILE_READ_AHEAD, LK_FILE_BUFFERED, LK_FILE_MMAP};
+    const char *err = NULL;
+    for (int file = 0; file < 2; file++) {
+        size_t bytes[ARR_LEN(names)], lines[ARR_LEN(names)];
+        for (size_t idx = 0; idx < ARR_LEN(names); idx++) {
+            double best = 0, best_wait = 0, wait = 0;
+            for (int round = 0; round < 3; round++) {
+                double start = now_sec();
+                if (idx == 0)
+                    bytes[idx] = read_by_copy(files[file], &lines[idx]);
+                else if (idx >= 4)
+                    bytes[idx] = read_by_line(files[file], modes[idx], &lines[idx]);
+                else
+                    bytes[idx] = read_by_view(files[file], modes[idx], &lines[idx], &wait);
+                double t = now_sec() - start;
+                if (round == 0 || t < best) {
+                    best = t;
+                    best_wait = wait;
+                }
+            }
+            printf("  %s, %s: %u lines, %.1f MiB/s", file_names[file], names[idx],
+                    (unsigned)lines[idx], bytes[idx] / best / (1024.0 * 1024.0));
+            if (idx != 0 && idx < 4)
+                printf(", waited for blocks %.1f%% of time", 100.0 * best_wait / best);
+            printf("\n");
+            if (bytes[idx] != bytes[0] || lines[idx] != lines[0])
+                err = "readers returned different lines";
+        }
+    }
+
+    remove(BENCH_DICT);
+    remove(BENCH_IMAGE);
+    return err;
+}
+
+/* runs a string function for all strings and returns the time in ns per call */
+#define TIME_STR_FUNC(call, strs, cnt, rounds, sink) do { \
+        double start = now_sec(); \
+        for (int r = 0; r < (rounds); r++) \
+            for (size_t i = 0; i < (cnt); i++) { \
+                const char *s = (strs)[i]; \
+                (sink) += (size_t)(call); \
+            } \
+        t = (now_sec() - start) * 1e9 / ((double)(rounds) * (cnt)); \
+    } while (0)
+
+/* times every string function of lk_utils for words and for long lines */
+static const char* bench_utils(size_t forms) {
+    size_t cnt = forms / 10 < 1000 ? 1000 : forms / 10;
+    char **strs = (char**)calloc(cnt * 3, sizeof(char*));
+    if (strs == NULL)
+        return "out of memory";
+
+    /* Lakota words, the same words in ASCII, and lines of 16 words */
+    char word[LK_MAX_WORD_LEN], line[16 * LK_MAX_WORD_LEN];
+    for (size_t idx = 0; idx < cnt; idx++) {
+        gen_word(word);
+        if (rnd(4) == 0)
+            word[0] = word[0] >= 'a' && word[0] <= 'z' ? word[0] - 'a' + 'A' : word[0];
+        strs[idx] = strdup(word);
+        lk_to_ascii(word, line, sizeof(line));
+        strs[cnt + idx] = strdup(line);
+        line[0] = '\0';
+        for (int w = 0; w < 16; w++) {
+            char ascii[LK_MAX_WORD_LEN];
+            gen_word(word);
+            lk_to_ascii(word, ascii, sizeof(ascii));
+            strcat(line, w == 0 ? "" : " ");
+            strcat(line, rnd(2) ? word : ascii);
+        }
+        strs[2 * cnt + idx] = strdup(line);
+    }
+
+    const char *kinds[] = {"lakota words", "ascii words", "lines"};
+    size_t sink = 0;
+    int rounds = 20;
+    char out[32 * LK_MAX_WORD_LEN];
+    for (int k = 0; k < 3; k++) {
+        char **set = strs + k * cnt;
+        int rr = k == 2 ? rounds / 4 : rounds;
+        double t;
+        printf("  %s, ns per call:\n", kinds[k]);
+        TIME_STR_FUNC(lk_to_low_case(s, out, sizeof(out)), set, cnt, rr, sink);
+        printf("    lk_to_low_case %.1f\n", t);
+        TIME_STR_FUNC(lk_destress(s, out, sizeof(out)), set, cnt, rr, sink);
+        printf("    lk_destress %.1f\n", t);
+        TIME_STR_FUNC(lk_to_ascii(s, out, sizeof(out)), set, cnt, rr, sink);
+        printf("    lk_to_ascii %.1f\n", t);
+        TIME_STR_FUNC(lk_remove_glottal_stop(s, out, sizeof(out)), set, cnt, rr, sink);
+        printf("    lk_remove_glottal_stop %.1f\n", t);
+        TIME_STR_FUNC(lk_vowels_no(s), set, cnt, rr, sink);
+        printf("    lk_vowels_no %.1f\n", t);
+        TIME_STR_FUNC(lk_stressed_vowels_no(s), set, cnt, rr, sink);
+        printf("    lk_stressed_vowels_no %.1f\n", t);
+        TIME_STR_FUNC(lk_is_ascii(s), set, cnt, rr, sink);
+        printf("    lk_is_ascii %.1f\n", t);
+        TIME_STR_FUNC(lk_has_glottal_stop(s), set, cnt, rr, sink);
+        printf("    lk_has_glottal_stop %.1f\n", t);
+    }
+    printf("  (checksum %u)\n", (unsigned)sink);
+
+    for (size_t idx = 0; idx < cnt * 3; idx++)
+        free(strs[idx]);
+    free(strs);
+    return NULL;
+}
+
+/* finds words of all lines with lk_next_word or lk_split_words and
+ * returns the time in ns per line. Modes 2 and 3 convert every found word to
+ * low case: a copy of the word or right in the line */
+static double time_words(char **lines, size_t cnt, int rounds, int mode, size_t *sink) {
+    struct lk_word_span words[256];
+    char word[LK_MAX_WORD_LEN], low[LK_MAX_WORD_LEN * 2];
+    double start = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < cnt; i++) {
+            const char *line = lines[i];
+            if (mode == 0) {
+                size_t len;
+                const char *w = lk_next_word(line, &len);
+                while (w != NULL) {
+                    *sink += len;
+                    w = lk_next_word(w + len, &len);
+                }
+                continue;
+            }
+
+            size_t len = strlen(line), from = 0, count;
+            lk_result res = LK_BUFFER_SMALL;
+            while (res == LK_BUFFER_SMALL) {
+                count = ARR_LEN(words);
+                res = lk_split_words(line + from, len - from, words, &count);
+                for (size_t w = 0; w < count; w++) {
+                    const char *start = line + from + words[w].offset;
+                    size_t wlen = words[w].len;
+                    if (mode == 2 && wlen < sizeof(word)) {
+                        strncpy(word, start, wlen);
+                        word[wlen] = '\0';
+                        lk_to_low_case(word, low, sizeof(low));
+                    } else if (mode == 3) {
+                        lk_to_low_case_n(start, wlen, low, sizeof(low));
+                    }
+                    *sink += wlen;
+                }
+                if (count != 0)
+                    from += words[count - 1].offset + words[count - 1].len;
+            }
+        }
+    }
+    return (now_sec() - start) * 1e9 / ((double)rounds * cnt);
+}
+
+/* compares a loop of lk_next_word with lk_split_words on lines of text */
+static const char* bench_words(size_t forms) {
+    size_t cnt = forms / 10 < 1000 ? 1000 : forms / 10;
+    char **lines = (char**)calloc(cnt * 2, sizeof(char*));
+    if (lines == NULL)
+        return "out of memory";
+
+    /* lines of 16 words with punctuation: Lakota words and ASCII only words */
+    const char *marks[] = {" ", " ", " ", ", ", ". ", " - ", " \"", "\" "};
+    for (int k = 0; k < 2; k++) {
+        for (size_t idx = 0; idx < cnt; idx++) {
+            char word[LK_MAX_WORD_LEN], ascii[LK_MAX_WORD_LEN], line[16 * (LK_MAX_WORD_LEN + 4)];
+            line[0] = '\0';
+            for (int w = 0; w < 16; w++) {
+                gen_word(word);
+                if (k == 1)
+                    lk_to_ascii(word, ascii, sizeof(ascii));
+                strcat(line, w == 0 ? "" : marks[rnd(ARR_LEN(marks))]);
+                strcat(line, k == 1 ? ascii : word);
+            }
+            lines[k * cnt + idx] = strdup(line);
+        }
+    }
+
+    const char *kinds[] = {"lakota lines", "ascii lines"};
+    const char *err = NULL;
+    for (int k = 0; k < 2; k++) {
+        size_t sink_next = 0, sink_split = 0, sink_copy = 0, sink_view = 0;
+        double t_next = time_words(lines + k * cnt, cnt, 20, 0, &sink_next);
+        double t_split = time_words(lines + k * cnt, cnt, 20, 1, &sink_split);
+        printf("  %s, ns per line: lk_next_word %.1f, lk_split_words %.1f\n", kinds[k], t_next, t_split);
+        double t_copy = time_words(lines + k * cnt, cnt, 20, 2, &sink_copy);
+        double t_view = time_words(lines + k * cnt, cnt, 20, 3, &sink_view);
+        printf("  %s to low case, ns per line: copied words %.1f, lk_to_low_case_n %.1f\n",
+                kinds[k], t_copy, t_view);
+        if (sink_next != sink_split || sink_next != sink_copy || sink_next != sink_view)
+            err = "lk_split_words found different words";
+    }
+
+    for (size_t idx = 0; idx < cnt * 2; idx++)
+        free(lines[idx]);
+    free(lines);
+    return err;
+}
+
+/* reads the file with lk_file_next_line_view and returns the time in seconds.
+ * With convert != 0 every word is converted to low case: with the trusted
+ * function for a checked line if convert is 2 */
+static double time_checked_read(const char *path, int check, int convert, size_t *sink) {
+    struct lk_word_span words[256];
+    char low[LK_MAX_WORD_LEN * 2];
+    const char *line;
+    size_t len;
+    double start = now_sec();
+    struct lk_file *f = lk_file_open_ex(path, LK_FILE_MMAP);
+    lk_file_check_utf8(f, check);
+    while (lk_file_next_line_view(f, &line, &len) == LK_OK) {
+        *sink += len;
+        if (!convert)
+            continue;
+
+        int trusted = convert == 2 && lk_file_line_trusted(f);
+        size_t from = 0, count;
+        lk_result res = LK_BUFFER_SMALL;
+        while (res == LK_BUFFER_SMALL) {
+            count = ARR_LEN(words);
+            res = lk_split_words(line + from, len - from, words, &count);
+            for (size_t w = 0; w < count; w++) {
+                const char *ws = line + from + words[w].offset;
+                if (trusted)
+                    lk_to_low_case_trusted(ws, words[w].len, low, sizeof(low));
+                else
+                    lk_to_low_case_n(ws, words[w].len, low, sizeof(low));
+                *sink += (unsigned char)low[0];
+            }
+            if (count != 0)
+                from += words[count - 1].offset + words[count - 1].len;
+        }
+    }
+    lk_file_close(f);
+    return now_sec() - start;
+}
+
+/* compares reading a text with and without checking UTF8, and converting
+ * its words with the checking and the trusted functions */
+static const char* bench_check(size_t forms) {
+    if (!gen_paragraphs(BENCH_IMAGE, forms * 4))
+        return "failed to generate text";
+
+    const char *names[] = {"view", "view, checked", "low case, lk_to_low_case_n",
+        "low case, lk_to_low_case_trusted"};
+    const int check[] = {0, 1, 1, 1};
+    const int convert[] = {0, 0, 1, 2};
+    size_t sinks[ARR_LEN(names)], bytes = 0;
+    for (size_t idx = 0; idx < ARR_LEN(names); idx++) {
+        double best = 0;
+        for (int round = 0; round < 3; round++) {
+            size_t sink = 0;
+            double t = time_checked_read(BENCH_IMAGE, check[idx], convert[idx], &sink);
+            if (round == 0 || t < best)
+                best = t;
+            sinks[idx] = sink;
+        }
+        if (idx == 0)
+            bytes = sinks[0];
+        printf("  %s: %.1f MiB/s\n", names[idx], bytes / best / (1024.0 * 1024.0));
+    }
+
+    remove(BENCH_IMAGE);
+    if (sinks[0] != sinks[1] || sinks[2] != sinks[3])
+        return "checked reading returned different results";
+    return NULL;
+}
+
+struct bench_case {
+    const char *name;
+    const char* (*run)(size_t forms);
+};
+
+static struct bench_case cases[] = {
+    {"load", bench_load},
+    {"search", bench_search},
+    {"dawg", bench_dawg},
+    {"image", bench_image},
+    {"parallel", bench_parallel},
+    {"forms", bench_forms},
+    {"folded", bench_folded},
+    {"batch", bench_batch},
+    {"cache", bench_cache},
+    {"read", bench_read},
+    {"utils", bench_utils},
+    {"words", bench_words},
+    {"check", bench_check},
+};
+
+int main (int argc, char** argv) {
+    const char *name = (argc > 1) ? argv[1] : NULL;
+    size_t forms = (argc > 2) ? (size_t)strtoul(argv[2], NULL, 10) : BENCH_FORMS;
+
+    if (forms == 0) {
+        printf("Usage: bench [case_name] [number_of_forms]\n");
+        return 1;
+    }
+
+    for (size_t idx = 0; idx < ARR_LEN(cases); idx++) {
+        if (name != NULL && strcmp(name, "all") != 0 && strcmp(name, cases[idx].name) != 0)
+            continue;
+
+        printf("Running %s...\n", cases[idx].name);
+        const char *err = cases[idx].run(forms);
+        if (err != NULL) {
+            printf("  FAIL: %s\n", err);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -156,6 +156,79 @@ const char* test_lookup() {
     return 0;
 }
 
+const char* test_freeze() {
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_parse_word("kiŋ", dict);
+    lk_parse_word("sápa masápa sapápi kunísapa", dict);
+    lk_parse_word("číkʼalA mačíkʼala", dict);
+    lk_parse_word("kóla makolá", dict);
+    lk_parse_word("kolá mákʼóla", dict);
+
+    lk_result r = lk_dict_freeze(dict);
+    ut_assert("Dict frozen", r == LK_OK);
+    r = lk_parse_word("he", dict);
+    ut_assert("Parse to frozen", r == LK_INVALID_ARG && lk_word_count(dict) == 11);
+
+    int cnt = 0;
+    char **lookup;
+
+    lookup = lk_dict_exact_lookup(dict, "he", &cnt);
+    ut_assert("Non-existent word", cnt == -LK_WORD_NOT_FOUND && lookup == NULL);
+    lookup = lk_dict_exact_lookup(dict, "kiŋ", &cnt);
+    ut_assert("Exact match", cnt == 0 && lookup == NULL);
+    lookup = lk_dict_exact_lookup(dict, "KUNISAPA", &cnt);
+    ut_assert("Ascii match", cnt == 1 && lookup != NULL && strcmp(lookup[0], "kunísapa") == 0);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "mačík`ala", &cnt);
+    ut_assert("Glottal", cnt == 1 && lookup != NULL && strcmp(lookup[0], "mačíkʼala") == 0);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "kola", &cnt);
+    ut_assert("Multifit", cnt == 2 && lookup != NULL);
+    lk_exact_lookup_free(lookup);
+
+    lk_dict_close(dict);
+
+    return 0;
+}
+
+const char* test_minimize() {
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_parse_word("kiŋ", dict);
+    lk_parse_word("sápa masápa sapápi kunísapa", dict);
+    lk_parse_word("číkʼalA mačíkʼala", dict);
+    lk_parse_word("kóla makolá", dict);
+    lk_parse_word("kolá mákʼóla", dict);
+
+    struct lk_dict_stats before, after;
+    lk_dict_get_stats(dict, &before);
+    lk_result r = lk_dict_minimize(dict);
+    ut_assert("Dict minimized", r == LK_OK);
+    r = lk_dict_get_stats(dict, &after);
+    ut_assert("Less nodes", r == LK_OK && after.words == before.words
+            && after.nodes < before.nodes && after.tree_memory <= before.tree_memory);
+    r = lk_parse_word("he", dict);
+    ut_assert("Parse to minimized", r == LK_INVALID_ARG);
+
+    int cnt = 0;
+    char **lookup;
+
+    lookup = lk_dict_exact_lookup(dict, "kiŋ", &cnt);
+    ut_assert("Exact match", cnt == 0 && lookup == NULL);
+    lookup = lk_dict_exact_lookup(dict, "masapa", &cnt);
+    ut_assert("Ascii match", cnt == 1 && lookup != NULL && strcmp(lookup[0], "masápa") == 0);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "macikala", &cnt);
+    ut_assert("Glottal", cnt == 1 && lookup != NULL && strcmp(lookup[0], "mačíkʼala") == 0);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "kola", &cnt);
+    ut_assert("Multifit", cnt == 2 && lookup != NULL);
+    lk_exact_lookup_free(lookup);
+
+    lk_dict_close(dict);
+
+    return 0;
+}
+
 const char* test_dict_load() {
     FILE *f = fopen("lk.dict", "wb");
     ut_assert("File created", f != 0);
@@ -204,6 +277,493 @@ const char* test_dict_load() {
     return 0;
 }
 
+const char* test_image() {
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_parse_word("kiŋ", dict);
+    lk_parse_word("sápa masápa sapápi kunísapa", dict);
+    lk_parse_word("číkʼalA mačíkʼala", dict);
+    lk_parse_word("zédún wazédunpi wazédunpis", dict);
+    lk_parse_word("kóla makolá", dict);
+    lk_parse_word("kolá mákʼóla", dict);
+
+    lk_result r = lk_dict_save_image(dict, "lk.image");
+    ut_assert("Image saved", r == LK_OK);
+    size_t words = lk_word_count(dict);
+    lk_dict_close(dict);
+
+    dict = lk_dict_open_image("lk.image");
+    ut_assert("Image opened", dict != NULL && lk_word_count(dict) == words);
+    r = lk_parse_word("he", dict);
+    ut_assert("Parse to image", r == LK_INVALID_ARG);
+
+    int cnt = 0;
+    char **lookup;
+
+    lookup = lk_dict_exact_lookup(dict, "kiŋ", &cnt);
+    ut_assert("Exact match", cnt == 0 && lookup == NULL);
+    lookup = lk_dict_exact_lookup(dict, "he", &cnt);
+    ut_assert("Non-existent word", cnt == -LK_WORD_NOT_FOUND && lookup == NULL);
+    lookup = lk_dict_exact_lookup(dict, "KUNISAPA", &cnt);
+    ut_assert("Ascii match", cnt == 1 && lookup != NULL && strcmp(lookup[0], "kunísapa") == 0);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "zédun", &cnt);
+    ut_assert("Incorrect stress", cnt == 1 && lookup != NULL);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "mačík`ala", &cnt);
+    ut_assert("Glottal", cnt == 1 && lookup != NULL && strcmp(lookup[0], "mačíkʼala") == 0);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "kola", &cnt);
+    ut_assert("Multifit", cnt == 2 && lookup != NULL);
+    lk_exact_lookup_free(lookup);
+
+    lk_dict_close(dict);
+
+    FILE *f = fopen("lk.image", "wb");
+    fputs("kta\n", f);
+    fclose(f);
+    dict = lk_dict_open_image("lk.image");
+    ut_assert("Invalid image", dict == NULL);
+    remove("lk.image");
+
+    return 0;
+}
+
+/* returns non-zero if two files have the same content */
+static int same_files(const char *path1, const char *path2) {
+    FILE *f1 = fopen(path1, "rb"), *f2 = fopen(path2, "rb");
+    int same = f1 != NULL && f2 != NULL;
+    while (same) {
+        int c1 = fgetc(f1), c2 = fgetc(f2);
+        same = c1 == c2;
+        if (c1 == EOF)
+            break;
+    }
+    if (f1 != NULL)
+        fclose(f1);
+    if (f2 != NULL)
+        fclose(f2);
+    return same;
+}
+
+/* loads the file sequentially and with threads and compares the results */
+static int same_parallel_load(const char *path, size_t threads, lk_index_mode mode) {
+    struct lk_dictionary *seq = lk_dict_init(), *par = lk_dict_init();
+    lk_dict_set_index_mode(seq, mode);
+    lk_dict_set_index_mode(par, mode);
+    lk_result r_seq = lk_read_dictionary(seq, path);
+    lk_result r_par = lk_read_dictionary_parallel(par, path, threads);
+    struct lk_dict_stats st_seq, st_par;
+    lk_dict_get_stats(seq, &st_seq);
+    lk_dict_get_stats(par, &st_par);
+
+    /* images contain words in dictionary order and the trie built from the tree */
+    int same = r_seq == r_par && st_seq.words == st_par.words && st_seq.nodes == st_par.nodes
+        && lk_dict_save_image(seq, "seq.image") == LK_OK
+        && lk_dict_save_image(par, "par.image") == LK_OK
+        && same_files("seq.image", "par.image");
+
+    lk_dict_close(seq);
+    lk_dict_close(par);
+    remove("seq.image");
+    remove("par.image");
+    return same;
+}
+
+const char* test_parallel_load() {
+    FILE *f = fopen("lk.dict", "wb");
+    ut_assert("File created", f != 0);
+
+    fputs("kta\n", f);
+    fputs("lapa milapa nilapa\n", f);
+    fputs("kiŋ\n", f);
+    fputs("zédún wazédunpi wazédunpis\n", f);
+    fputs("uya wauya wauyapi uyae\n", f);
+    fputs("sápa masápa sapápi kunísapa\n", f);
+    fputs("he\n", f);
+    fputs("číkʼalA mačíkʼala\n", f);
+    fputs("kóla makolá\n", f);
+    fputs("kolá mákʼóla\n", f);
+    fputs("Šúŋka šúŋkapi\n", f);
+    fputs("ȟé ȟépi\n", f);
+    fclose(f);
+
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_result r = lk_read_dictionary_parallel(dict, "lk.dict", 4);
+    ut_assert("Reading dictionary", r == LK_OK && lk_word_count(dict) == 27);
+
+    int cnt = 0;
+    char **lookup = lk_dict_exact_lookup(dict, "kola", &cnt);
+    ut_assert("Multifit", cnt == 2 && lookup != NULL);
+    lk_exact_lookup_free(lookup);
+    lookup = lk_dict_exact_lookup(dict, "sunkapi", &cnt);
+    ut_assert("Ascii match", cnt == 1 && lookup != NULL && strcmp(lookup[0], "šúŋkapi") == 0);
+    lk_exact_lookup_free(lookup);
+    lk_dict_close(dict);
+
+    ut_assert("Same as sequential", same_parallel_load("lk.dict", 3, LK_INDEX_ALL_FORMS));
+    ut_assert("More threads than lines", same_parallel_load("lk.dict", 64, LK_INDEX_ALL_FORMS));
+    ut_assert("Folded index", same_parallel_load("lk.dict", 3, LK_INDEX_FOLDED));
+
+    /* an article of any length is loaded */
+    f = fopen("lk.dict", "ab");
+    fputs("wašté", f);
+    for (int idx = 0; idx < 1000; idx++)
+        fputs(idx % 2 ? " wašteya" : " wašteyapi", f);
+    fputs("\n", f);
+    fclose(f);
+    dict = lk_dict_init();
+    r = lk_read_dictionary(dict, "lk.dict");
+    ut_assert("Long article", r == LK_OK && lk_word_count(dict) == 27 + 1001);
+    lk_dict_close(dict);
+    ut_assert("Long article in parallel", same_parallel_load("lk.dict", 3, LK_INDEX_ALL_FORMS));
+
+    /* loading stops at the comment line */
+    f = fopen("lk.dict", "ab");
+    fputs("# comment\n", f);
+    fputs("wičháša\n", f);
+    fclose(f);
+    ut_assert("Stop at comment", same_parallel_load("lk.dict", 4, LK_INDEX_ALL_FORMS));
+
+    ut_assert("Missing file", same_parallel_load("missing.dict", 4, LK_INDEX_ALL_FORMS));
+    remove("lk.dict");
+
+    return 0;
+}
+
+/* returns non-zero if both dictionaries give the same suggestions for the word */
+static int same_lookup(const struct lk_dictionary *d1, const struct lk_dictionary *d2,
+        const char *word) {
+    int cnt1 = 0, cnt2 = 0;
+    char **l1 = lk_dict_exact_lookup(d1, word, &cnt1);
+    char **l2 = lk_dict_exact_lookup(d2, word, &cnt2);
+    int same = cnt1 == cnt2 && (l1 == NULL) == (l2 == NULL);
+    for (int idx = 0; same && l1 != NULL && l1[idx] != NULL; idx++)
+        same = l2[idx] != NULL && strcmp(l1[idx], l2[idx]) == 0;
+
+    lk_exact_lookup_free(l1);
+    lk_exact_lookup_free(l2);
+    return same;
+}
+
+const char* test_folded_index() {
+    const char *lines[] = {
+        "kta",
+        "lapa milapa nilapa",
+        "kiŋ",
+        "zédún wazédunpi wazédunpis",
+        "sápa masápa sapápi kunísapa",
+        "číkʼalA mačíkʼala",
+        "kóla makolá",
+        "kolá mákʼóla",
+        "Šúŋka šúŋkapi",
+        "ÁŋB",
+        "ʼ '",
+    };
+    const char *queries[] = {
+        "kiŋg", "kiŋ", "kunisapa", "zedun", "kola", "kóla", "kolá", "KOLA",
+        "makola", "mak'ola", "mákóla", "cikala", "čikʼala", "čík'ala", "cik`ala",
+        "sunkapi", "ŠÚŊKA", "áŋb", "ab", "aŋb", "ʼ", "'", "``", "",
+    };
+
+    struct lk_dictionary *all = lk_dict_init(), *folded = lk_dict_init();
+    lk_result r = lk_dict_set_index_mode(folded, LK_INDEX_FOLDED);
+    ut_assert("Set index mode", r == LK_OK);
+    r = lk_dict_set_index_mode(NULL, LK_INDEX_FOLDED);
+    ut_assert("NULL dictionary", r == LK_INVALID_ARG);
+    for (size_t idx = 0; idx < sizeof(lines)/sizeof(lines[0]); idx++) {
+        lk_parse_word(lines[idx], all);
+        lk_parse_word(lines[idx], folded);
+    }
+    r = lk_dict_set_index_mode(folded, LK_INDEX_ALL_FORMS);
+    ut_assert("Not empty dictionary", r == LK_INVALID_ARG);
+
+    struct lk_dict_stats st_all, st_folded;
+    lk_dict_get_stats(all, &st_all);
+    lk_dict_get_stats(folded, &st_folded);
+    ut_assert("Fewer nodes", st_all.words == st_folded.words && st_folded.nodes < st_all.nodes);
+
+    for (size_t idx = 0; idx < sizeof(queries)/sizeof(queries[0]); idx++)
+        ut_assert(queries[idx], same_lookup(all, folded, queries[idx]));
+
+    const struct lk_word_ptr *list = lk_dict_find_word(folded, "kóla");
+    ut_assert("Filtered list", list != NULL && list->next == NULL);
+
+    r = lk_dict_save_image(folded, "folded.image");
+    ut_assert("Saving image", r == LK_OK);
+    struct lk_dictionary *image = lk_dict_open_image("folded.image");
+    ut_assert("Opening image", image != NULL);
+    for (size_t idx = 0; idx < sizeof(queries)/sizeof(queries[0]); idx++)
+        ut_assert(queries[idx], same_lookup(all, image, queries[idx]));
+    r = lk_dict_set_index_mode(image, LK_INDEX_ALL_FORMS);
+    ut_assert("Image index mode", r == LK_INVALID_ARG);
+
+    lk_dict_close(image);
+    lk_dict_close(folded);
+    lk_dict_close(all);
+    remove("folded.image");
+
+    return 0;
+}
+
+/* checks that every result of a batch is the same as lk_dict_exact_lookup */
+static int same_batch(const struct lk_dictionary *dict, const char **words, size_t n) {
+    struct lk_lookup_result results[64];
+    const char *suggestions[256];
+    size_t sugg_count = sizeof(suggestions)/sizeof(suggestions[0]);
+
+    if (lk_dict_lookup_batch(dict, words, n, results, suggestions, &sugg_count) != LK_OK)
+        return 0;
+
+    for (size_t idx = 0; idx < n; idx++) {
+        int cnt = 0;
+        char **list = lk_dict_exact_lookup(dict, words[idx], &cnt);
+        int same;
+        if (list == NULL && cnt == 0)
+            same = results[idx].status == LK_EXACT_MATCH;
+        else if (list == NULL)
+            same = results[idx].status == (lk_result)-cnt;
+        else
+            same = results[idx].status == LK_OK && results[idx].count == (size_t)cnt;
+        for (int i = 0; same && list != NULL && i < cnt; i++)
+            same = strcmp(list[i], suggestions[results[idx].first + i]) == 0;
+        lk_exact_lookup_free(list);
+        if (!same) {
+            printf("    batch differs for '%s'\n", words[idx]);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+const char* test_batch_lookup() {
+    const char *lines[] = {
+        "lapa milapa nilapa",
+        "kiŋ",
+        "zédún wazédunpi wazédunpis",
+        "sápa masápa sapápi kunísapa",
+        "číkʼalA mačíkʼala",
+        "kóla makolá",
+        "kolá mákʼóla",
+        "Šúŋka šúŋkapi",
+        "wičhášakte wičhášaktepi wičhášakteyA",
+    };
+    /* the last words have the same first 8 bytes, so they are sorted by the
+     * rest of the word */
+    const char *queries[] = {
+        "kiŋg", "kiŋ", "kunisapa", "zedun", "kola", "kóla", "kolá", "KOLA", "makola",
+        "mak'ola", "mákóla", "cikala", "čikʼala", "čík'ala", "sunkapi", "ŠÚŊKA", "zédun",
+        "wazédunpi", "wazedúnpi", "lapa", "lapa", "milapa", "lap", "", "kiŋ", "kóla",
+        "wičhášaktepi", "wičhášakteya", "wičhášakte", "wičhášaktepi", "wičhášakta",
+        "WIČHÁŠAKTE", "wičhášakte", "wičhašaktepi", "wičhášaktepiŋ", "wičhášakteyA",
+    };
+    size_t n = sizeof(queries)/sizeof(queries[0]);
+
+    struct lk_dictionary *all = lk_dict_init(), *folded = lk_dict_init();
+    lk_dict_set_index_mode(folded, LK_INDEX_FOLDED);
+    for (size_t idx = 0; idx < sizeof(lines)/sizeof(lines[0]); idx++) {
+        lk_parse_word(lines[idx], all);
+        lk_parse_word(lines[idx], folded);
+    }
+
+    ut_assert("Linked tree", same_batch(all, queries, n));
+    ut_assert("Folded index", same_batch(folded, queries, n));
+
+    struct lk_lookup_result results[4];
+    const char *words[] = {"kola", NULL, "lapa", "kolá"};
+    size_t sugg_count = 0;
+    lk_result r = lk_dict_lookup_batch(all, words, 4, results, NULL, &sugg_count);
+    ut_assert("Small buffer", r == LK_BUFFER_SMALL && sugg_count == 2
+        && results[0].status == LK_OK && results[0].count == 2);
+    ut_assert("NULL word", results[1].status == LK_INVALID_ARG
+        && results[2].status == LK_EXACT_MATCH && results[3].status == LK_EXACT_MATCH);
+    sugg_count = 0;
+    r = lk_dict_lookup_batch(all, NULL, 4, results, NULL, &sugg_count);
+    ut_assert("NULL words", r == LK_INVALID_ARG);
+    r = lk_dict_lookup_batch(all, words, 0, NULL, NULL, &sugg_count);
+    ut_assert("Empty batch", r == LK_OK && sugg_count == 0);
+
+    lk_dict_freeze(all);
+    ut_assert("Frozen tree", same_batch(all, queries, n));
+    r = lk_dict_save_image(folded, "batch.image");
+    ut_assert("Saving image", r == LK_OK);
+    struct lk_dictionary *image = lk_dict_open_image("batch.image");
+    ut_assert("Image", image != NULL && same_batch(image, queries, n));
+
+    struct lk_lookup_ctx *ctx = lk_lookup_ctx_init();
+    sugg_count = 0;
+    r = lk_dict_lookup_batch_r(image, words, 4, results, NULL, &sugg_count, ctx);
+    ut_assert("Reentrant batch", r == LK_BUFFER_SMALL && sugg_count == 2
+        && results[3].status == LK_EXACT_MATCH);
+    lk_lookup_ctx_free(ctx);
+
+    lk_dict_close(image);
+    lk_dict_close(folded);
+    lk_dict_close(all);
+    remove("batch.image");
+
+    return 0;
+}
+
+const char* test_view_lookup() {
+    struct lk_dictionary *dict = lk_dict_init();
+    /* "kola" is listed twice, it must be suggested once */
+    const char *lines[] = {"kóla kola", "kolá kola makolá", "lapa"};
+    for (size_t idx = 0; idx < sizeof(lines)/sizeof(lines[0]); idx++)
+        lk_parse_word(lines[idx], dict);
+
+    const char *suggestions[8];
+    size_t cnt = 8;
+    lk_result r = lk_dict_lookup_view(dict, "KOLA", suggestions, &cnt);
+    ut_assert("Suggestions", r == LK_OK && cnt == 3);
+    int kola = 0;
+    for (size_t idx = 0; idx < cnt; idx++)
+        kola += strcmp(suggestions[idx], "kola") == 0;
+    ut_assert("No duplicates", kola == 1);
+
+    int list_cnt = 0;
+    char **list = lk_dict_exact_lookup(dict, "KOLA", &list_cnt);
+    ut_assert("Same as exact lookup", list != NULL && list_cnt == 3);
+    for (int idx = 0; list != NULL && idx < list_cnt; idx++)
+        ut_assert(list[idx], strcmp(list[idx], suggestions[idx]) == 0);
+    lk_exact_lookup_free(list);
+
+    const char *first = suggestions[0];
+    cnt = 1;
+    r = lk_dict_lookup_view(dict, "KOLA", suggestions, &cnt);
+    ut_assert("Small buffer", r == LK_BUFFER_SMALL && cnt == 3 && suggestions[0] == first);
+    cnt = 0;
+    r = lk_dict_lookup_view(dict, "lapa", NULL, &cnt);
+    ut_assert("Exact match", r == LK_EXACT_MATCH && cnt == 0);
+    r = lk_dict_lookup_view(dict, "lap", NULL, &cnt);
+    ut_assert("Not found", r == LK_WORD_NOT_FOUND);
+    r = lk_dict_lookup_view(dict, NULL, NULL, &cnt);
+    ut_assert("NULL word", r == LK_INVALID_ARG);
+    cnt = 8;
+    r = lk_dict_lookup_view(dict, "KOLA", NULL, &cnt);
+    ut_assert("NULL array", r == LK_INVALID_ARG);
+
+    struct lk_lookup_ctx *ctx = lk_lookup_ctx_init();
+    cnt = 8;
+    r = lk_dict_lookup_view_r(dict, "mákola", suggestions, &cnt, ctx);
+    ut_assert("Reentrant lookup", r == LK_OK && cnt == 1 && strcmp(suggestions[0], "makolá") == 0);
+    lk_lookup_ctx_free(ctx);
+
+    lk_dict_close(dict);
+
+    return 0;
+}
+
+const char* test_lookup_cache() {
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_parse_word("kóla kola makolá", dict);
+    lk_parse_word("lapa", dict);
+
+    struct lk_lookup_ctx *ctx = lk_lookup_ctx_init();
+    lk_result r = lk_lookup_ctx_set_cache(ctx, 2);
+    ut_assert("Cache enabled", r == LK_OK);
+
+    const char *suggestions[8];
+    size_t cnt = 8;
+    r = lk_dict_lookup_view_r(dict, "KOLA", suggestions, &cnt, ctx);
+    ut_assert("Miss", r == LK_OK && cnt == 2);
+    const char *first = suggestions[0];
+    cnt = 8;
+    r = lk_dict_lookup_view_r(dict, "KOLA", suggestions, &cnt, ctx);
+    ut_assert("Hit", r == LK_OK && cnt == 2 && suggestions[0] == first);
+    cnt = 1;
+    r = lk_dict_lookup_view_r(dict, "KOLA", suggestions, &cnt, ctx);
+    ut_assert("Hit with small buffer", r == LK_BUFFER_SMALL && cnt == 2);
+
+    int list_cnt = 0;
+    char **list = lk_dict_exact_lookup_r(dict, "KOLA", &list_cnt, ctx);
+    ut_assert("Exact lookup hit", list != NULL && list_cnt == 2 && strcmp(list[0], first) == 0);
+    lk_exact_lookup_free(list);
+
+    struct lk_cache_stats st;
+    lk_lookup_ctx_cache_stats(ctx, &st);
+    ut_assert("Counters", st.hits == 3 && st.misses == 1 && st.entries == 1 && st.capacity == 2);
+
+    /* "lapa" and "lap" push "KOLA" out of the cache */
+    cnt = 0;
+    r = lk_dict_lookup_view_r(dict, "lapa", NULL, &cnt, ctx);
+    ut_assert("Exact match", r == LK_EXACT_MATCH);
+    r = lk_dict_lookup_view_r(dict, "lap", NULL, &cnt, ctx);
+    ut_assert("Not found", r == LK_WORD_NOT_FOUND);
+    r = lk_dict_lookup_view_r(dict, "lap", NULL, &cnt, ctx);
+    ut_assert("Cached not found", r == LK_WORD_NOT_FOUND);
+    cnt = 8;
+    r = lk_dict_lookup_view_r(dict, "KOLA", suggestions, &cnt, ctx);
+    ut_assert("Evicted", r == LK_OK && cnt == 2);
+    lk_lookup_ctx_cache_stats(ctx, &st);
+    ut_assert("Counters after eviction", st.hits == 4 && st.misses == 4 && st.entries == 2);
+
+    /* a new word changes the result of a cached one */
+    lk_parse_word("lap", dict);
+    cnt = 0;
+    r = lk_dict_lookup_view_r(dict, "lap", NULL, &cnt, ctx);
+    ut_assert("Invalidated", r == LK_EXACT_MATCH);
+
+    r = lk_lookup_ctx_set_cache(ctx, 0);
+    lk_lookup_ctx_cache_stats(ctx, &st);
+    ut_assert("Cache disabled", r == LK_OK && st.hits == 0 && st.capacity == 0);
+    lk_lookup_ctx_free(ctx);
+
+    r = lk_dict_set_cache(dict, 16);
+    list = lk_dict_exact_lookup(dict, "KOLA", &list_cnt);
+    lk_exact_lookup_free(list);
+    list = lk_dict_exact_lookup(dict, "KOLA", &list_cnt);
+    lk_exact_lookup_free(list);
+    lk_dict_cache_stats(dict, &st);
+    ut_assert("Dictionary cache", r == LK_OK && st.hits == 1 && st.misses == 1);
+
+    lk_dict_close(dict);
+
+    return 0;
+}
+
+const char* test_lookup_by_length() {
+    struct lk_dictionary *dict = lk_dict_init();
+    lk_parse_word("kóla kola makolá", dict);
+    lk_parse_word("lapa", dict);
+
+    /* words are given by length inside a line of text */
+    const char *text = "KOLA lapa, lap";
+    const struct lk_word_ptr *found = lk_dict_find_word_n(dict, text, 4);
+    ut_assert("Find by length", found != NULL && found == lk_dict_find_word(dict, "KOLA"));
+    ut_assert("Find prefix by length", lk_dict_find_word_n(dict, text + 5, 3) == NULL);
+
+    const char *suggestions[8];
+    size_t cnt = 8;
+    lk_result r = lk_dict_lookup_view_n(dict, text, 4, suggestions, &cnt);
+    ut_assert("View by length", r == LK_OK && cnt == 2);
+    cnt = 0;
+    r = lk_dict_lookup_view_n(dict, text + 5, 4, NULL, &cnt);
+    ut_assert("Exact match by length", r == LK_EXACT_MATCH && cnt == 0);
+    r = lk_dict_lookup_view_n(dict, text + 11, 3, NULL, &cnt);
+    ut_assert("Not found by length", r == LK_WORD_NOT_FOUND);
+    /* "lap" is a part of "lapa", the cache must not mix them up */
+    r = lk_dict_set_cache(dict, 16);
+    r = lk_dict_lookup_view_n(dict, text + 5, 4, NULL, &cnt);
+    r = lk_dict_lookup_view_n(dict, text + 5, 3, NULL, &cnt);
+    ut_assert("Cached by length", r == LK_WORD_NOT_FOUND);
+
+    int list_cnt = 0;
+    char **list = lk_dict_exact_lookup_n(dict, text, 4, &list_cnt);
+    ut_assert("Exact lookup by length", list != NULL && list_cnt == 2);
+    for (int idx = 0; list != NULL && idx < list_cnt; idx++)
+        ut_assert("Same suggestions", strcmp(list[idx], suggestions[idx]) == 0);
+    lk_exact_lookup_free(list);
+    list = lk_dict_exact_lookup_n(dict, "makolá makola", 7, &list_cnt);
+    ut_assert("Correct word by length", list == NULL && list_cnt == 0);
+    list = lk_dict_exact_lookup_n(dict, NULL, 4, &list_cnt);
+    ut_assert("NULL word by length", list == NULL && list_cnt == -LK_INVALID_ARG);
+
+    lk_dict_close(dict);
+
+    return 0;
+}
+
 const char * run_all_test() {
     printf("=== Basic operations ===\n");
 
@@ -211,6 +771,15 @@ const char * run_all_test() {
     ut_run_test("Dict search", test_search);
     ut_run_test("Dict suggestions", test_lookup);
     ut_run_test("Dict load", test_dict_load);
+    ut_run_test("Dict freeze", test_freeze);
+    ut_run_test("Dict minimize", test_minimize);
+    ut_run_test("Dict image", test_image);
+    ut_run_test("Dict parallel load", test_parallel_load);
+    ut_run_test("Dict folded index", test_folded_index);
+    ut_run_test("Dict batch lookup", test_batch_lookup);
+    ut_run_test("Dict view lookup", test_view_lookup);
+    ut_run_test("Dict lookup cache", test_lookup_cache);
+    ut_run_test("Dict lookup by length", test_lookup_by_length);
 
     return 0;
 }
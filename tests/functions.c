@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -104,6 +105,294 @@ const char* test_fileread() {
     return 0;
 }
 
+const char* test_file_view() {
+    /* a line longer than the reader buffer */
+    size_t long_len = 100000;
+    char *long_line = (char*)malloc(long_len + 1);
+    ut_assert("Memory allocated", long_line != NULL);
+    for (size_t idx = 0; idx < long_len; idx++)
+        long_line[idx] = 'a' + idx % 26;
+    long_line[long_len] = '\0';
+
+    FILE *ftxt = fopen("view.txt", "wb");
+    ut_assert("File created", ftxt != 0);
+    fputs("\xEF\xBB\xBF" "first\r\n\r\nsecond\n", ftxt);
+    fputs(long_line, ftxt);
+    fputs("\nlast", ftxt);
+    fclose(ftxt);
+
+    const char *lines[] = {"first", "second", long_line, "last"};
+    lk_file_mode modes[] = {LK_FILE_MMAP, LK_FILE_BUFFERED, LK_FILE_READ_AHEAD};
+    for (size_t m = 0; m < sizeof(modes)/sizeof(modes[0]); m++) {
+        struct lk_file *f = lk_file_open_ex("view.txt", modes[m]);
+        ut_assert("File opened", lk_file_is_valid(f));
+
+        const char *line;
+        size_t len;
+        lk_result r;
+        for (size_t idx = 0; idx < sizeof(lines)/sizeof(lines[0]); idx++) {
+            r = lk_file_next_line_view(f, &line, &len);
+            ut_assert(idx == 2 ? "long line" : lines[idx], r == LK_OK && len == strlen(lines[idx])
+                && strncmp(line, lines[idx], len) == 0);
+        }
+        r = lk_file_next_line_view(f, &line, &len);
+        ut_assert("View EOF", r == LK_EOF && line == NULL && len == 0);
+        r = lk_file_next_line_view(f, &line, &len);
+        ut_assert("View EOF again", r == LK_EOF);
+        lk_file_close(f);
+
+        /* both ways of reading can be mixed */
+        char buf[16];
+        f = lk_file_open_ex("view.txt", modes[m]);
+        r = lk_file_next_line_view(f, &line, &len);
+        ut_assert("View first", r == LK_OK && len == 5 && strncmp(line, "first", 5) == 0);
+        r = lk_file_read(f, buf, sizeof(buf));
+        ut_assert("Read second", r == LK_OK && strcmp(buf, "second") == 0);
+        r = lk_file_next_line_view(f, &line, &len);
+        ut_assert("View long line", r == LK_OK && len == long_len);
+        lk_file_close(f);
+    }
+
+    struct lk_file *f = lk_file_open_ex("abcde.txt", LK_FILE_MMAP);
+    ut_assert("Missing file", !lk_file_is_valid(f));
+    lk_file_close(f);
+
+    free(long_line);
+    remove("view.txt");
+
+    return 0;
+}
+
+const char* test_file_read_ahead() {
+    FILE *ftxt = fopen("ahead.txt", "wb");
+    ut_assert("File created", ftxt != 0);
+    for (int idx = 0; idx < 1000; idx++)
+        fprintf(ftxt, "line %d\r\n", idx);
+    fclose(ftxt);
+
+    /* blocks smaller than a line and a ring of the minimal depth */
+    size_t sizes[] = {3, 7, 4096, 0};
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+        struct lk_file *f = lk_file_open_read_ahead("ahead.txt", sizes[s], 1);
+        ut_assert("File opened", lk_file_is_valid(f));
+
+        char buf[32], expected[32];
+        lk_result r;
+        int idx = 0;
+        while ((r = lk_file_read(f, buf, sizeof(buf))) == LK_OK) {
+            sprintf(expected, "line %d", idx++);
+            ut_assert("Read line", strcmp(buf, expected) == 0);
+        }
+        ut_assert("Read EOF", r == LK_EOF && idx == 1000);
+
+        struct lk_file_stats st;
+        r = lk_file_get_stats(f, &st);
+        ut_assert("Stats", r == LK_OK && st.bytes == 9890 && st.blocks > 0);
+        ut_assert("Stats NULL", lk_file_get_stats(f, NULL) == LK_INVALID_ARG);
+        lk_file_close(f);
+    }
+
+    /* closing the file before the whole file is read stops the thread */
+    struct lk_file *f = lk_file_open_read_ahead("ahead.txt", 16, 2);
+    const char *line;
+    size_t len;
+    lk_result r = lk_file_next_line_view(f, &line, &len);
+    ut_assert("View first", r == LK_OK && len == 6 && strncmp(line, "line 0", 6) == 0);
+    lk_file_close(f);
+
+    f = lk_file_open_read_ahead("abcde.txt", 0, 0);
+    ut_assert("Missing file", !lk_file_is_valid(f));
+    lk_file_close(f);
+
+    remove("ahead.txt");
+
+    return 0;
+}
+
+const char* test_file_read_line() {
+    /* lines longer than the reader buffer, one of them is the last line */
+    size_t long_len = 150000;
+    char *long_line = (char*)malloc(long_len + 1);
+    ut_assert("Memory allocated", long_line != NULL);
+    for (size_t idx = 0; idx < long_len; idx++)
+        long_line[idx] = 'a' + idx % 26;
+    long_line[long_len] = '\0';
+
+    FILE *ftxt = fopen("readline.txt", "wb");
+    ut_assert("File created", ftxt != 0);
+    fputs("\xEF\xBB\xBF" "first\r\n", ftxt);
+    fputs(long_line, ftxt);
+    fputs("\r\n\nsecond\n", ftxt);
+    fputs(long_line, ftxt);
+    fclose(ftxt);
+
+    const char *lines[] = {"first", long_line, "second", long_line};
+    lk_file_mode modes[] = {LK_FILE_MMAP, LK_FILE_BUFFERED, LK_FILE_READ_AHEAD};
+    for (size_t m = 0; m < sizeof(modes)/sizeof(modes[0]); m++) {
+        struct lk_file *f = lk_file_open_ex("readline.txt", modes[m]);
+        ut_assert("File opened", lk_file_is_valid(f));
+
+        const char *line;
+        size_t len;
+        lk_result r;
+        for (size_t idx = 0; idx < sizeof(lines)/sizeof(lines[0]); idx++) {
+            r = lk_file_read_line(f, &line, &len);
+            ut_assert("Line", r == LK_OK && len == strlen(lines[idx]) && strcmp(line, lines[idx]) == 0);
+        }
+        r = lk_file_read_line(f, &line, &len);
+        ut_assert("Read line EOF", r == LK_EOF && line == NULL && len == 0);
+        lk_file_close(f);
+
+        /* the length is optional and the ways of reading can be mixed */
+        char buf[16];
+        f = lk_file_open_ex("readline.txt", modes[m]);
+        r = lk_file_read(f, buf, sizeof(buf));
+        ut_assert("Read first", r == LK_OK && strcmp(buf, "first") == 0);
+        r = lk_file_read_line(f, &line, NULL);
+        ut_assert("Long line", r == LK_OK && strcmp(line, long_line) == 0);
+        r = lk_file_read(f, buf, sizeof(buf));
+        ut_assert("Read second", r == LK_OK && strcmp(buf, "second") == 0);
+        lk_file_close(f);
+    }
+
+    struct lk_file *f = lk_file_open("readline.txt");
+    ut_assert("NULL line", lk_file_read_line(f, NULL, NULL) == LK_INVALID_ARG);
+    lk_file_close(f);
+
+    free(long_line);
+    remove("readline.txt");
+
+    return 0;
+}
+
+const char* test_file_check_utf8() {
+    /* the long line is joined from blocks of the buffered reader, and the
+     * last line ends with a part of a character */
+    size_t long_len = 100000;
+    char *long_line = (char*)malloc(long_len + 3);
+    ut_assert("Memory allocated", long_line != NULL);
+    memset(long_line, 'a', long_len);
+    strcpy(long_line + long_len, "ŋ");
+
+    const char *first = "Kʼola wičháša\n";
+    FILE *ftxt = fopen("check.txt", "wb");
+    ut_assert("File created", ftxt != 0);
+    fputs(first, ftxt);
+    fputs("bad \xC3 byte\r\n", ftxt);
+    fputs("Čhaŋ k`a\n", ftxt);
+    fputs(long_line, ftxt);
+    fputs("\nend \xE2\x80", ftxt);
+    fclose(ftxt);
+
+    int trusted[] = {1, 0, 1, 1, 0};
+    unsigned long long bad = strlen(first) + 4;
+    lk_file_mode modes[] = {LK_FILE_MMAP, LK_FILE_BUFFERED, LK_FILE_READ_AHEAD};
+    for (size_t m = 0; m < sizeof(modes)/sizeof(modes[0]); m++) {
+        struct lk_file *f = lk_file_open_ex("check.txt", modes[m]);
+        ut_assert("File opened", lk_file_is_valid(f));
+        ut_assert("Check on", lk_file_check_utf8(f, 1) == LK_OK);
+
+        const char *line;
+        size_t len;
+        unsigned long long offset;
+        for (size_t idx = 0; idx < sizeof(trusted)/sizeof(trusted[0]); idx++) {
+            lk_result r = lk_file_next_line_view(f, &line, &len);
+            ut_assert("Line read", r == LK_OK);
+            ut_assert("Line checked", lk_file_line_trusted(f) == trusted[idx]);
+        }
+        ut_assert("Read EOF", lk_file_next_line_view(f, &line, &len) == LK_EOF);
+        ut_assert("EOF not trusted", !lk_file_line_trusted(f));
+        ut_assert("First error", lk_file_utf8_error(f, &offset) == LK_INVALID_STRING && offset == bad);
+        ut_assert("Error NULL", lk_file_utf8_error(f, NULL) == LK_INVALID_ARG);
+        lk_file_close(f);
+    }
+
+    /* lines are not checked by default */
+    char buf[32];
+    struct lk_file *f = lk_file_open("check.txt");
+    lk_result r = lk_file_read(f, buf, sizeof(buf));
+    ut_assert("Not checked", r == LK_OK && !lk_file_line_trusted(f));
+    lk_file_check_utf8(f, 1);
+    r = lk_file_read(f, buf, sizeof(buf));
+    ut_assert("Read invalid", r == LK_OK && !lk_file_line_trusted(f));
+    r = lk_file_read(f, buf, sizeof(buf));
+    ut_assert("Read valid", r == LK_OK && lk_file_line_trusted(f));
+    lk_file_close(f);
+    ut_assert("Invalid file", lk_file_check_utf8(NULL, 1) == LK_INVALID_FILE);
+
+    free(long_line);
+    remove("check.txt");
+
+    return 0;
+}
+
+/* reads lines of a range and appends them to out separated with '|' */
+static int read_range(const char *path, lk_file_mode mode, unsigned long long begin,
+        unsigned long long end, char *out, size_t out_size) {
+    struct lk_file *f = lk_file_open_range(path, mode, begin, end);
+    if (!lk_file_is_valid(f))
+        return 0;
+
+    const char *line;
+    size_t len, used = strlen(out);
+    lk_result r;
+    while ((r = lk_file_next_line_view(f, &line, &len)) == LK_OK && used + len + 2 < out_size) {
+        memcpy(out + used, line, len);
+        used += len;
+        out[used++] = '|';
+        out[used] = '\0';
+    }
+    lk_file_close(f);
+    return r == LK_EOF;
+}
+
+const char* test_file_range() {
+    const char text[] = "\xEF\xBB\xBF" "ab cd\r\n\r\nef\ngh ij kl\n\n\nm\rno pq\r\nrst";
+    FILE *ftxt = fopen("range.txt", "wb");
+    ut_assert("File created", ftxt != 0);
+    fwrite(text, 1, sizeof(text) - 1, ftxt);
+    fclose(ftxt);
+
+    const char *expected = "ab cd|ef|gh ij kl|m|no pq|rst|";
+    char out[256];
+    lk_file_mode modes[] = {LK_FILE_MMAP, LK_FILE_BUFFERED, LK_FILE_READ_AHEAD};
+    for (size_t m = 0; m < sizeof(modes)/sizeof(modes[0]); m++) {
+        /* every pair of cut points */
+        for (unsigned long long cut1 = 0; cut1 <= sizeof(text); cut1++) {
+            for (unsigned long long cut2 = cut1; cut2 <= sizeof(text); cut2++) {
+                out[0] = '\0';
+                int ok = read_range("range.txt", modes[m], 0, cut1, out, sizeof(out))
+                    && read_range("range.txt", modes[m], cut1, cut2, out, sizeof(out))
+                    && read_range("range.txt", modes[m], cut2, ULLONG_MAX, out, sizeof(out));
+                ut_assert("Ranges", ok && strcmp(out, expected) == 0);
+            }
+        }
+    }
+
+    struct lk_file_range ranges[8];
+    for (size_t cnt = 1; cnt <= 8; cnt++) {
+        lk_result r = lk_file_plan_chunks("range.txt", ranges, cnt);
+        ut_assert("Plan", r == LK_OK && ranges[0].begin == 0
+            && ranges[cnt - 1].end == sizeof(text) - 1);
+        out[0] = '\0';
+        for (size_t idx = 0; idx < cnt; idx++) {
+            ut_assert("Line start", idx == 0 || ranges[idx].begin == ranges[idx - 1].end);
+            unsigned long long b = ranges[idx].begin;
+            ut_assert("Aligned", b == 0 || b == sizeof(text) - 1
+                || ((text[b - 1] == '\n' || text[b - 1] == '\r') && text[b] != '\n' && text[b] != '\r'));
+            ut_assert("Read range", read_range("range.txt", LK_FILE_BUFFERED, ranges[idx].begin,
+                ranges[idx].end, out, sizeof(out)));
+        }
+        ut_assert("Planned lines", strcmp(out, expected) == 0);
+    }
+    ut_assert("Plan no ranges", lk_file_plan_chunks("range.txt", ranges, 0) == LK_INVALID_ARG);
+    ut_assert("Plan missing file", lk_file_plan_chunks("abcde.txt", ranges, 2) == LK_INVALID_FILE);
+
+    remove("range.txt");
+
+    return 0;
+}
+
 const char* test_lowcase() {
     char *a[] = {
         NULL,
@@ -265,6 +554,101 @@ const char* test_remove_stop() {
     return 0;
 }
 
+/* long strings: ASCII runs are processed by blocks of 8 bytes */
+const char* test_ascii_runs() {
+    const char *word = "WICHASHA Kola'z`ALPHABET lakotA OYATE Čík'ala ŋbcdefgh'";
+    char buf[128];
+
+    lk_result r = lk_to_low_case(word, buf, sizeof(buf));
+    ut_assert("low case", r == LK_OK
+        && strcmp(buf, "wichasha kolaʼzʼalphabet lakota oyate číkʼala ŋbcdefghʼ") == 0);
+    r = lk_to_ascii(word, buf, sizeof(buf));
+    ut_assert("ascii", r == LK_OK
+        && strcmp(buf, "WICHASHA Kola'z'ALPHABET lakotA OYATE Čik'ala nbcdefgh'") == 0);
+    r = lk_destress(word, buf, sizeof(buf));
+    ut_assert("destress", r == LK_OK
+        && strcmp(buf, "WICHASHA Kola'z`ALPHABET lakotA OYATE Čik'ala ŋbcdefgh'") == 0);
+    r = lk_remove_glottal_stop(word, buf, sizeof(buf));
+    ut_assert("remove stop", r == LK_OK
+        && strcmp(buf, "WICHASHA KolazALPHABET lakotA OYATE Číkala ŋbcdefgh") == 0);
+    ut_assert("vowels", lk_vowels_no(word) == 8 && lk_stressed_vowels_no(word) == 1);
+    ut_assert("is ascii", !lk_is_ascii(word) && lk_is_ascii("WICHASHA Kola'z`ALPHABET"));
+    ut_assert("has stop", lk_has_glottal_stop(word) && !lk_has_glottal_stop("WICHASHA KolazALPHABET")
+        && lk_has_glottal_stop("WICHASHA KolazALPHABETʼ") && lk_has_glottal_stop("WICHASHA Kola’"));
+
+    /* the output ends exactly at the buffer end */
+    const char *ascii = "abcdefghijklmnopqrstuvwxyz";
+    for (size_t sz = 0; sz <= 30; sz++) {
+        r = lk_destress(ascii, buf, sz);
+        ut_assert("destress size", sz > 26 ? r == LK_OK && strcmp(buf, ascii) == 0 : r == LK_BUFFER_SMALL);
+        r = lk_to_ascii(ascii, buf, sz);
+        ut_assert("ascii size", sz > 26 ? r == LK_OK && strcmp(buf, ascii) == 0 : r == LK_BUFFER_SMALL);
+        r = lk_remove_glottal_stop(ascii, buf, sz);
+        ut_assert("remove size", sz > 26 ? r == LK_OK && strcmp(buf, ascii) == 0 : r == LK_BUFFER_SMALL);
+        r = lk_to_low_case("ABCDEFGHIJKLMNOPQRSTUVWXYZ", buf, sz);
+        ut_assert("low size", sz > 26 ? r == LK_OK && strcmp(buf, ascii) == 0 : r == LK_BUFFER_SMALL);
+    }
+
+    return 0;
+}
+
+const char* test_normalize_forms() {
+    struct lk_forms f;
+    const unsigned int all = LK_FORM_BIT(LK_FORM_COUNT) - 1;
+
+    lk_result r = lk_normalize_forms(NULL, all, &f);
+    ut_assert("NULL word", r == LK_INVALID_ARG);
+    r = lk_normalize_forms("test", all, NULL);
+    ut_assert("NULL forms", r == LK_INVALID_ARG);
+    r = lk_normalize_forms("te\xffst", all, &f);
+    ut_assert("Invalid string", r == LK_INVALID_STRING);
+
+    r = lk_normalize_forms("Číkʼa'lá", all, &f);
+    ut_assert("Forms", r == LK_OK && f.valid == all && f.stressed == 2 && f.has_stop);
+    ut_assert("Low", strcmp(f.form[LK_FORM_LOW], "číkʼaʼlá") == 0);
+    ut_assert("Low no stop", strcmp(f.form[LK_FORM_LOW_NO_STOP], "číkalá") == 0);
+    ut_assert("Unstressed", strcmp(f.form[LK_FORM_UNSTRESSED], "čikʼaʼla") == 0);
+    ut_assert("Unstressed no stop", strcmp(f.form[LK_FORM_UNSTRESSED_NO_STOP], "čikala") == 0);
+    ut_assert("Ascii", strcmp(f.form[LK_FORM_ASCII], "cik'a'la") == 0);
+    ut_assert("Ascii no stop", strcmp(f.form[LK_FORM_ASCII_NO_STOP], "cikala") == 0);
+    ut_assert("Ascii grave", strcmp(f.form[LK_FORM_ASCII_GRAVE], "cik`a`la") == 0);
+    ut_assert("Destressed", strcmp(f.form[LK_FORM_DESTRESSED], "Čikʼa'la") == 0);
+    ut_assert("Destressed low", strcmp(f.form[LK_FORM_DESTRESSED_LOW], "čikʼaʼla") == 0);
+    ut_assert("All distinct", f.distinct == LK_FORMS_DICT);
+
+    r = lk_normalize_forms("kola", LK_FORMS_DICT, &f);
+    ut_assert("Ascii word", r == LK_OK && f.distinct == 0 && !f.has_stop && f.stressed == 0);
+    r = lk_normalize_forms("Kola", LK_FORMS_DICT, &f);
+    ut_assert("Capital", r == LK_OK && f.distinct == LK_FORM_BIT(LK_FORM_LOW));
+    r = lk_normalize_forms("kolá", LK_FORMS_DICT, &f);
+    ut_assert("Stressed", r == LK_OK && f.distinct == LK_FORM_BIT(LK_FORM_UNSTRESSED));
+    r = lk_normalize_forms("ÁŋB", LK_FORMS_DICT, &f);
+    ut_assert("Capital stress", r == LK_OK && f.stressed == 0
+            && f.distinct == (LK_FORM_BIT(LK_FORM_LOW) | LK_FORM_BIT(LK_FORM_ASCII)));
+
+    r = lk_normalize_forms("kola", LK_FORM_BIT(LK_FORM_DESTRESSED_LOW), &f);
+    ut_assert("Required forms", r == LK_OK
+            && f.valid == (LK_FORM_BIT(LK_FORM_DESTRESSED) | LK_FORM_BIT(LK_FORM_DESTRESSED_LOW)));
+
+    char low[64];
+    const char *words[] = {
+        "tESt`a'b",
+        "vow - 'Флáiíbcúúéŋeoóóíí`",
+        "’aaÉȞmeíóāsaáníhžŋnbaž",
+        "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa`",
+        "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa’",
+    };
+    for (size_t idx = 0; idx < sizeof(words)/sizeof(words[0]); idx++) {
+        r = lk_normalize_forms(words[idx], all, &f);
+        lk_result r_low = lk_to_low_case(words[idx], low, 64);
+        ut_assert(words[idx], r == LK_OK
+                && (r_low == LK_OK) == ((f.valid & LK_FORM_BIT(LK_FORM_LOW)) != 0));
+        ut_assert(words[idx], r_low != LK_OK || strcmp(low, f.form[LK_FORM_LOW]) == 0);
+    }
+
+    return 0;
+}
+
 const char* test_word_begin() {
     const char *pure_ascii = "some example string";
     const char *ascii = "'some' ex'ample s`tri'ng";
@@ -357,11 +741,158 @@ const char* test_next_word() {
     return 0;
 }
 
+/* compares words found from offset from with lk_next_word results and moves
+ * from to the end of the last word */
+static int same_words(const char *str, size_t *from, const struct lk_word_span *words, size_t count) {
+    const char *base = str + *from;
+    for (size_t idx = 0; idx < count; idx++) {
+        size_t wlen;
+        const char *w = lk_next_word(str + *from, &wlen);
+        if (w != base + words[idx].offset || wlen != words[idx].len)
+            return 0;
+        *from = w - str + wlen;
+    }
+    return 1;
+}
+
+/* checks that lk_split_words finds the same words as a loop of lk_next_word */
+static int same_as_next_word(const char *str, size_t cap) {
+    struct lk_word_span words[64];
+    size_t count = cap, from = 0;
+    lk_result res;
+    while ((res = lk_split_words(str + from, strlen(str + from), words, &count)) == LK_BUFFER_SMALL) {
+        if (count != cap)
+            return 0;
+        if (!same_words(str, &from, words, count))
+            return 0;
+        count = cap;
+    }
+
+    if (!same_words(str, &from, words, count))
+        return 0;
+    /* after the last word lk_next_word finds nothing, or fails on invalid UTF8 */
+    if (lk_next_word(str + from, NULL) != NULL)
+        return 0;
+    return res == LK_OK || res == LK_INVALID_STRING;
+}
+
+const char* test_split_words() {
+    const char *strs[] = {
+        "some example string",
+        "'some' ex'ample s`tri'ng",
+        "číkʼala mákiŋ",
+        "",
+        "   12, 34 ''  ",
+        "a''b c'`d e' f` 'g ʼh iʼʼj k’l",
+        "Háŋ, mitákuyepi! Lakȟótiyapi uŋkíyapi kte. Wóyakapi waŋ ečhámuŋ kte, "
+            "wašíčuŋ iyápi kiŋ ogná wówapi kiŋ le owápi šni.",
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-abc'def",
+        "word \xff word",
+        "word\xcc\x81 next",
+        "\x80\x81 word",
+        "word'\xff",
+    };
+
+    for (size_t idx = 0; idx < sizeof(strs)/sizeof(strs[0]); idx++) {
+        ut_assert("same words as lk_next_word", same_as_next_word(strs[idx], 64));
+        ut_assert("same words as lk_next_word, small array", same_as_next_word(strs[idx], 1));
+        ut_assert("same words as lk_next_word, array of 3", same_as_next_word(strs[idx], 3));
+    }
+
+    struct lk_word_span words[8];
+    size_t count = 8;
+    const char *ascii = "'some' ex'ample s`tri'ng";
+    ut_assert("split ASCII", lk_split_words(ascii, strlen(ascii), words, &count) == LK_OK);
+    ut_assert("split ASCII - count", count == 3);
+    ut_assert("split ASCII - word #2", words[1].offset == 7 && words[1].len == 8);
+    ut_assert("split ASCII - word #3", words[2].offset == 16 && words[2].len == 8);
+
+    count = 8;
+    ut_assert("split invalid UTF8", lk_split_words("word \xff word", 11, words, &count) == LK_INVALID_STRING);
+    ut_assert("split invalid UTF8 - words before", count == 1 && words[0].len == 4);
+
+    count = 8;
+    ut_assert("split zero separated", lk_split_words("ab\0cd", 5, words, &count) == LK_OK && count == 2);
+    ut_assert("split zero separated - word #2", words[1].offset == 3 && words[1].len == 2);
+
+    count = 0;
+    ut_assert("split with no array", lk_split_words("ab cd", 5, NULL, &count) == LK_BUFFER_SMALL);
+    ut_assert("split with no array - nothing found", count == 0);
+    count = 0;
+    ut_assert("split with no words", lk_split_words("12 34", 5, NULL, &count) == LK_OK);
+    ut_assert("split NULL", lk_split_words(NULL, 0, words, &count) == LK_INVALID_ARG);
+
+    return 0;
+}
+
+const char* test_length_delimited() {
+    /* every word of the text is converted without copying it */
+    const char *text = "Kʼola Čhaŋ wičháša k`a";
+    const char *words[] = {"Kʼola", "Čhaŋ", "wičháša", "k`a"};
+    char out[64], expected[64];
+    struct lk_word_span spans[8];
+    size_t count = 8;
+    lk_result r = lk_split_words(text, strlen(text), spans, &count);
+    ut_assert("Text split", r == LK_OK && count == 4);
+
+    for (size_t idx = 0; idx < count; idx++) {
+        const char *w = text + spans[idx].offset;
+        size_t len = spans[idx].len;
+        lk_to_low_case(words[idx], expected, sizeof(expected));
+        r = lk_to_low_case_n(w, len, out, sizeof(out));
+        ut_assert("low case by length", r == LK_OK && strcmp(out, expected) == 0);
+        r = lk_to_low_case_trusted(w, len, out, sizeof(out));
+        ut_assert("low case of trusted word", r == LK_OK && strcmp(out, expected) == 0);
+        lk_to_ascii(words[idx], expected, sizeof(expected));
+        r = lk_to_ascii_n(w, len, out, sizeof(out));
+        ut_assert("ASCII by length", r == LK_OK && strcmp(out, expected) == 0);
+        r = lk_to_ascii_trusted(w, len, out, sizeof(out));
+        ut_assert("ASCII of trusted word", r == LK_OK && strcmp(out, expected) == 0);
+        lk_destress(words[idx], expected, sizeof(expected));
+        r = lk_destress_n(w, len, out, sizeof(out));
+        ut_assert("destress by length", r == LK_OK && strcmp(out, expected) == 0);
+        r = lk_destress_trusted(w, len, out, sizeof(out));
+        ut_assert("destress of trusted word", r == LK_OK && strcmp(out, expected) == 0);
+        lk_remove_glottal_stop(words[idx], expected, sizeof(expected));
+        r = lk_remove_glottal_stop_n(w, len, out, sizeof(out));
+        ut_assert("no glottal stop by length", r == LK_OK && strcmp(out, expected) == 0);
+        r = lk_remove_glottal_stop_trusted(w, len, out, sizeof(out));
+        ut_assert("no glottal stop of trusted word", r == LK_OK && strcmp(out, expected) == 0);
+
+        struct lk_forms forms, expected_forms;
+        lk_normalize_forms(words[idx], LK_FORMS_DICT, &expected_forms);
+        r = lk_normalize_forms_n(w, len, LK_FORMS_DICT, &forms);
+        ut_assert("forms by length", r == LK_OK && forms.valid == expected_forms.valid
+                && forms.distinct == expected_forms.distinct);
+        for (int f = 0; f < LK_FORM_COUNT; f++)
+            ut_assert("form by length", strcmp(forms.form[f], expected_forms.form[f]) == 0);
+    }
+
+    /* a part of a multibyte character is not a valid string */
+    r = lk_to_low_case_n("Čhaŋ", 1, out, sizeof(out));
+    ut_assert("low case of a partial character", r == LK_INVALID_STRING);
+    r = lk_to_ascii_n("Čhaŋ", 5, out, sizeof(out));
+    ut_assert("ASCII of a partial character", r == LK_INVALID_STRING);
+    r = lk_to_low_case_trusted("Čhaŋ", 5, out, sizeof(out));
+    ut_assert("trusted cut character", r == LK_INVALID_STRING);
+    r = lk_to_low_case_n("abc", 0, out, sizeof(out));
+    ut_assert("low case of empty word", r == LK_OK && out[0] == '\0');
+    r = lk_destress_n(NULL, 0, out, sizeof(out));
+    ut_assert("destress of NULL", r == LK_INVALID_ARG);
+
+    return 0;
+}
+
 const char * run_all_test() {
     printf("=== Basic operations ===\n");
 
     ut_run_test("File open", test_fileopen);
     ut_run_test("File read", test_fileread);
+    ut_run_test("File view", test_file_view);
+    ut_run_test("File read ahead", test_file_read_ahead);
+    ut_run_test("File range", test_file_range);
+    ut_run_test("File read line", test_file_read_line);
+    ut_run_test("File check UTF8", test_file_check_utf8);
 
     ut_run_test("lowcase", test_lowcase);
     ut_run_test("count stressed", test_stressed_no);
@@ -369,8 +900,12 @@ const char * run_all_test() {
     ut_run_test("to ascii", test_to_ascii);
     ut_run_test("destress", test_destress);
     ut_run_test("remove glottal stop", test_remove_stop);
+    ut_run_test("ASCII runs", test_ascii_runs);
+    ut_run_test("normalize forms", test_normalize_forms);
     ut_run_test("begin of word", test_word_begin);
     ut_run_test("next word", test_next_word);
+    ut_run_test("split words", test_split_words);
+    ut_run_test("length delimited", test_length_delimited);
 
     return 0;
 }
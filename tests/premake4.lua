@@ -54,3 +54,29 @@ project "treefuncs"
    objdir "../obj/tests"
    targetdir "../out/"
    links { "utf8proc", "lkchecker" }
+
+   configuration "linux"
+      links { "dl" }
+
+project "bench"
+   kind "ConsoleApp"
+   language "C"
+
+   files { "bench.c" }
+   includedirs { "../lib/include" }
+   objdir "../obj/tests"
+   targetdir "../out/"
+   links { "lkchecker" }
+
+project "threads"
+   kind "ConsoleApp"
+   language "C"
+
+   files { "unittest.h", "threads.c" }
+   includedirs { "../lib/include" }
+   objdir "../obj/tests"
+   targetdir "../out/"
+   links { "lkchecker" }
+
+   configuration "linux"
+      links { "pthread" }
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "lk_common.h"
+#include "lk_dict.h"
+#include "lk_tree.h"
+
+int skip_failed_pkg = 1;
+#include "unittest.h"
+
+int tests_run = 0;
+int tests_fail = 0;
+
+#define THREAD_CNT 8
+#define ROUNDS 200
+
+static const char *articles[] = {
+    "kta",
+    "lapa milapa nilapa",
+    "kiŋ",
+    "zédún wazédunpi wazédunpis",
+    "uya wauya wauyapi uyae",
+    "sápa masápa sapápi kunísapa",
+    "he",
+    "číkʼalA mačíkʼala",
+    "kóla makolá",
+    "kolá mákʼóla",
+};
+
+/* misspelled, ASCII, stressed and missing words */
+static const char *queries[] = {
+    "kta", "KTA", "milapa", "kin", "kiŋ", "zédun", "wazedunpi", "uyae",
+    "kunisapa", "KUNÍSAPA", "sapa", "macik`ala", "mačíkʼala", "kola", "kóla",
+    "makʼola", "he", "hé", "xyz", "lápa", "nilapá",
+};
+
+#define QUERY_CNT (sizeof(queries) / sizeof(queries[0]))
+
+/**
+ * @struct lookup_result
+ * Suggestions for one query joined into one string
+ */
+struct lookup_result {
+    int count;
+    char list[512];
+};
+
+struct thread_arg {
+    const struct lk_dictionary *dict;
+    const struct lookup_result *expected;
+    int failed;
+};
+
+static void lookup(const struct lk_dictionary *dict, const char *word,
+        struct lk_lookup_ctx *ctx, struct lookup_result *res) {
+    char **list = lk_dict_exact_lookup_r(dict, word, &res->count, ctx);
+
+    res->list[0] = '\0';
+    for (int idx = 0; list != NULL && idx < res->count; idx++) {
+        strcat(res->list, list[idx]);
+        strcat(res->list, " ");
+    }
+    lk_exact_lookup_free(list);
+
+    const struct lk_word_ptr *found = lk_dict_find_word_r(dict, word, ctx);
+    while (found != NULL) {
+        res->count += 1000;
+        found = found->next;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI lookup_thread(LPVOID param) {
+#else
+static void* lookup_thread(void *param) {
+#endif
+    struct thread_arg *arg = (struct thread_arg*)param;
+    struct lk_lookup_ctx *ctx = lk_lookup_ctx_init();
+    if (ctx == NULL) {
+        arg->failed = 1;
+        return 0;
+    }
+
+    for (int r = 0; r < ROUNDS; r++) {
+        for (size_t idx = 0; idx < QUERY_CNT; idx++) {
+            struct lookup_result res;
+            lookup(arg->dict, queries[idx], ctx, &res);
+            if (res.count != arg->expected[idx].count
+                || strcmp(res.list, arg->expected[idx].list) != 0)
+                arg->failed++;
+        }
+    }
+
+    lk_lookup_ctx_free(ctx);
+    return 0;
+}
+
+/* runs THREAD_CNT threads and returns the number of mismatched lookups */
+static int run_threads(const struct lk_dictionary *dict) {
+    struct lookup_result expected[QUERY_CNT];
+    struct lk_lookup_ctx *ctx = lk_lookup_ctx_init();
+    if (ctx == NULL)
+        return -1;
+    for (size_t idx = 0; idx < QUERY_CNT; idx++)
+        lookup(dict, queries[idx], ctx, &expected[idx]);
+    lk_lookup_ctx_free(ctx);
+
+    struct thread_arg args[THREAD_CNT];
+#ifdef _WIN32
+    HANDLE th[THREAD_CNT];
+#else
+    pthread_t th[THREAD_CNT];
+#endif
+    int started = 0, failed = 0;
+
+    for (int idx = 0; idx < THREAD_CNT; idx++) {
+        args[idx].dict = dict;
+        args[idx].expected = expected;
+        args[idx].failed = 0;
+#ifdef _WIN32
+        th[idx] = CreateThread(NULL, 0, lookup_thread, &args[idx], 0, NULL);
+        if (th[idx] == NULL)
+            break;
+#else
+        if (pthread_create(&th[idx], NULL, lookup_thread, &args[idx]) != 0)
+            break;
+#endif
+        started++;
+    }
+
+    for (int idx = 0; idx < started; idx++) {
+#ifdef _WIN32
+        WaitForSingleObject(th[idx], INFINITE);
+        CloseHandle(th[idx]);
+#else
+        pthread_join(th[idx], NULL);
+#endif
+        failed += args[idx].failed;
+    }
+
+    return started == THREAD_CNT ? failed : -1;
+}
+
+static struct lk_dictionary* load_dict() {
+    struct lk_dictionary *dict = lk_dict_init();
+    if (dict == NULL)
+        return NULL;
+
+    for (size_t idx = 0; idx < sizeof(articles) / sizeof(articles[0]); idx++)
+        lk_parse_word(articles[idx], dict);
+    return dict;
+}
+
+const char* test_tree() {
+    struct lk_dictionary *dict = load_dict();
+    ut_assert("Dict loaded", dict != NULL);
+
+    int failed = run_threads(dict);
+    ut_assert("Same results", failed == 0);
+
+    lk_dict_close(dict);
+    return 0;
+}
+
+const char* test_frozen() {
+    struct lk_dictionary *dict = load_dict();
+    ut_assert("Dict loaded", dict != NULL && lk_dict_freeze(dict) == LK_OK);
+
+    int failed = run_threads(dict);
+    ut_assert("Same results", failed == 0);
+
+    lk_dict_close(dict);
+    return 0;
+}
+
+const char* test_image() {
+    struct lk_dictionary *dict = load_dict();
+    ut_assert("Image saved", dict != NULL && lk_dict_save_image(dict, "threads.image") == LK_OK);
+    lk_dict_close(dict);
+
+    dict = lk_dict_open_image("threads.image");
+    ut_assert("Image opened", dict != NULL);
+
+    int failed = run_threads(dict);
+    ut_assert("Same results", failed == 0);
+
+    lk_dict_close(dict);
+    remove("threads.image");
+    return 0;
+}
+
+const char * run_all_test() {
+    printf("=== Shared dictionary lookups ===\n");
+
+    ut_run_test("Threads tree", test_tree);
+    ut_run_test("Threads frozen", test_frozen);
+    ut_run_test("Threads image", test_image);
+
+    return 0;
+}
+
+int main (int argc, char** argv) {
+    const char* res = run_all_test();
+    if (res && tests_fail == 0) {
+        printf("%s\n", res);
+    } else {
+        printf("Tests run: %d\nSuccess: %d\nFail: %d\n", tests_run, tests_run - tests_fail, tests_fail);
+    }
+    return 0;
+}
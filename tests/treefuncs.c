@@ -1,3 +1,7 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -7,6 +11,11 @@
 #include <windows.h>
 #endif
 
+#ifdef __linux__
+#include <dlfcn.h>
+#define LK_FAIL_ALLOC 1
+#endif
+
 #include <utf8proc.h>
 #include "lk_common.h"
 #include "lk_tree.h"
@@ -147,6 +156,430 @@ const char* test_search() {
     sw4 = lk_tree_search(tree, "éfgh");
     ut_assert("éfgh found", sw4 != NULL && strcmp(sw4->word->word, "path") == 0 && sw4 != sw3 && sw4 != sw2 && sw4 != sw);
 
+    /* a path given by length is a part of a longer string */
+    ut_assert("abcd found by length", lk_tree_search_n(tree, "abcdef", 4) == sw);
+    ut_assert("abc found by length", lk_tree_search_n(tree, "abcdef", 3) == sw2);
+    ut_assert("éfgh found by length", lk_tree_search_n(tree, "éfgh ijk", 5) == sw4);
+    ut_assert("Prefix by length", lk_tree_search_n(tree, "abcdef", 2) == NULL);
+    ut_assert("Part of a character", lk_tree_search_n(tree, "éfgh", 1) == NULL);
+    ut_assert("Empty path", lk_tree_search_n(tree, "abc", 0) == NULL);
+
+    lk_tree_free(tree);
+
+    return 0;
+}
+
+const char* test_freeze() {
+    int r;
+
+    struct lk_tree *tree = lk_tree_init();
+    ut_assert("Tree create", tree != NULL);
+
+    char *p = "path", *p2 = "newpath";
+    struct lk_word w = {};
+    w.word = p;
+    struct lk_word w2 = {};
+    w2.word = p2;
+
+    lk_tree_add_word(tree, "abc", &w);
+    lk_tree_add_word(tree, "abcd", &w2);
+    lk_tree_add_word(tree, "abcd", &w);
+    lk_tree_add_word(tree, "ade", &w);
+    lk_tree_add_word(tree, "éfgh", &w);
+    lk_tree_add_word(tree, "kʼa", &w2);
+    lk_tree_add_word(tree, "k’a", &w);
+
+    r = lk_tree_freeze(tree);
+    ut_assert("Tree frozen", r == LK_OK && lk_tree_is_frozen(tree) && tree->head == NULL);
+    r = lk_tree_add_word(tree, "xyz", &w);
+    ut_assert("Add to frozen", r == LK_INVALID_ARG);
+
+    const struct lk_word_ptr *sw = lk_tree_search(tree, "zed");
+    ut_assert("Nonexistant word", sw == NULL);
+    sw = lk_tree_search(tree, "ab");
+    ut_assert("Prefix only", sw == NULL);
+    sw = lk_tree_search(tree, "abcde");
+    ut_assert("Too long", sw == NULL);
+    sw = lk_tree_search(tree, "abc");
+    ut_assert("abc found", sw != NULL && sw->word == &w && sw->next == NULL);
+    sw = lk_tree_search(tree, "abcd");
+    ut_assert("abcd found", sw != NULL && sw->word == &w2 && sw->next != NULL
+            && sw->next->word == &w && sw->next->next == NULL);
+    sw = lk_tree_search(tree, "éfgh");
+    ut_assert("éfgh found", sw != NULL && sw->word == &w);
+    sw = lk_tree_search(tree, "kʼa");
+    ut_assert("kʼa found", sw != NULL && sw->word == &w2);
+    sw = lk_tree_search(tree, "k’a");
+    ut_assert("k’a found", sw != NULL && sw->word == &w);
+    sw = lk_tree_search(tree, "k'a");
+    ut_assert("k'a not found", sw == NULL);
+    sw = lk_tree_search_n(tree, "k’a k'a", 5);
+    ut_assert("k’a found by length", sw != NULL && sw->word == &w);
+    sw = lk_tree_search_n(tree, "abcde", 4);
+    ut_assert("abcd found by length", sw != NULL && sw->word == &w2);
+
+    lk_tree_free(tree);
+
+    return 0;
+}
+
+static unsigned int word_id(const struct lk_word *word, void *arg) {
+    const struct lk_word *first = (const struct lk_word*)arg;
+    return (unsigned int)(word - first);
+}
+
+const char* test_image() {
+    int r;
+
+    struct lk_tree *tree = lk_tree_init();
+    ut_assert("Tree create", tree != NULL);
+
+    struct lk_word w[2] = {};
+    w[0].word = "path";
+    w[1].word = "newpath";
+
+    lk_tree_add_word(tree, "abc", &w[0]);
+    lk_tree_add_word(tree, "abcd", &w[1]);
+    lk_tree_add_word(tree, "abcd", &w[0]);
+    lk_tree_add_word(tree, "éfgh", &w[0]);
+
+    FILE *f = tmpfile();
+    ut_assert("Temp file", f != NULL);
+    size_t size = 0;
+    r = lk_tree_save(tree, f, word_id, w, &size);
+    ut_assert("Save unfrozen", r == LK_INVALID_ARG);
+    lk_tree_freeze(tree);
+    r = lk_tree_save(tree, f, word_id, w, &size);
+    ut_assert("Tree saved", r == LK_OK && size > 0 && size % 4 == 0 && (size_t)ftell(f) == size);
+    lk_tree_free(tree);
+
+    unsigned int *data = (unsigned int*)malloc(size);
+    rewind(f);
+    ut_assert("Tree read", data != NULL && fread(data, 1, size, f) == size);
+    fclose(f);
+
+    ut_assert("Truncated", lk_tree_open_image(data, size - 4) == NULL);
+    tree = lk_tree_open_image(data, size);
+    ut_assert("Tree opened", tree != NULL && lk_tree_is_frozen(tree));
+    r = lk_tree_add_word(tree, "xyz", &w[0]);
+    ut_assert("Add to image", r == LK_INVALID_ARG);
+    ut_assert("No lists", lk_tree_search(tree, "abc") == NULL);
+
+    const unsigned int *ids;
+    size_t cnt;
+    r = lk_tree_search_ids(tree, "ab", &ids, &cnt);
+    ut_assert("Prefix only", r == LK_WORD_NOT_FOUND);
+    r = lk_tree_search_ids(tree, "abcd", &ids, &cnt);
+    ut_assert("abcd found", r == LK_OK && cnt == 2 && ids[0] == 1 && ids[1] == 0);
+    r = lk_tree_search_ids(tree, "éfgh", &ids, &cnt);
+    ut_assert("éfgh found", r == LK_OK && cnt == 1 && ids[0] == 0);
+
+    lk_tree_free(tree);
+    free(data);
+
+    return 0;
+}
+
+const char* test_merge() {
+    int r;
+
+    struct lk_tree *tree = lk_tree_init(), *parts[2];
+    parts[0] = lk_tree_init();
+    parts[1] = lk_tree_init();
+
+    struct lk_word w = {};
+    w.word = "path";
+
+    lk_tree_add_word(tree, "abc", &w);
+    lk_tree_add_word(parts[0], "bcd", &w);
+    lk_tree_add_word(parts[0], "čab", &w);
+    lk_tree_add_word(parts[1], "dab", &w);
+    lk_tree_add_word(parts[1], "abd", &w);
+
+    r = lk_tree_merge(tree, parts, 2, NULL);
+    ut_assert("Same first char", r == LK_INVALID_ARG && lk_tree_search(tree, "bcd") == NULL);
+
+    struct lk_tree *fixed = lk_tree_init();
+    lk_tree_add_word(fixed, "dab", &w);
+    lk_tree_free(parts[1]);
+    parts[1] = fixed;
+
+    r = lk_tree_merge(tree, parts, 2, "dčx");
+    ut_assert("Trees merged", r == LK_OK);
+    ut_assert("Order", tree->head != NULL && tree->head->c == 'd'
+            && tree->head->sibling->c == LK_C_LOW && tree->head->sibling->sibling->c == 'a'
+            && tree->head->sibling->sibling->sibling->c == 'b'
+            && tree->head->sibling->sibling->sibling->sibling == NULL);
+
+    const struct lk_word_ptr *sw = lk_tree_search(tree, "abc");
+    ut_assert("abc found", sw != NULL && sw->word == &w);
+    sw = lk_tree_search(tree, "čab");
+    ut_assert("čab found", sw != NULL && sw->word == &w);
+    sw = lk_tree_search(tree, "dab");
+    ut_assert("dab found", sw != NULL && sw->word == &w);
+    r = lk_tree_add_word(tree, "bce", &w);
+    sw = lk_tree_search(tree, "bce");
+    ut_assert("Add after merge", r == LK_OK && sw != NULL);
+
+    lk_tree_free(tree);
+
+    return 0;
+}
+
+#ifdef LK_FAIL_ALLOC
+/* malloc and calloc of the library are replaced with the functions below,
+ * so a test can make the n-th allocation fail. -1 means no failures */
+static int alloc_countdown = -1;
+static void* (*real_malloc)(size_t);
+static void* (*real_calloc)(size_t, size_t);
+
+static int alloc_fails() {
+    if (alloc_countdown < 0)
+        return 0;
+    return alloc_countdown-- == 0;
+}
+
+void* malloc(size_t size) {
+    if (real_malloc == NULL)
+        real_malloc = (void* (*)(size_t))dlsym(RTLD_NEXT, "malloc");
+    return alloc_fails() ? NULL : real_malloc(size);
+}
+
+void* calloc(size_t cnt, size_t size) {
+    static int resolving = 0;
+    if (real_calloc == NULL) {
+        /* dlsym may call calloc itself and it can handle a failure */
+        if (resolving)
+            return NULL;
+        resolving = 1;
+        real_calloc = (void* (*)(size_t, size_t))dlsym(RTLD_NEXT, "calloc");
+        resolving = 0;
+    }
+    return alloc_fails() ? NULL : real_calloc(cnt, size);
+}
+#endif
+
+/* minimizing fails at every allocation in turn and all words must be
+ * found in the tree after every failure */
+const char* test_minimize_no_memory() {
+#ifdef LK_FAIL_ALLOC
+    /* the first characters of levels are not the smallest ones, so sorting
+     * the levels of the source tree would lose words */
+    const char *paths[] = {
+        "ybc", "yb", "xbc", "abc", "nilapa", "milapa", "lapa", "kolapi",
+        "kola", "makola", "šúŋkapi", "šúŋka", "čhápapi", "čhápa",
+    };
+    /* a level that is too wide to be sorted without allocating memory */
+    char wide[80][3];
+    struct lk_word w[(sizeof(paths)/sizeof(paths[0]))], ww = {};
+
+    struct lk_tree *tree = lk_tree_init();
+    for (size_t idx = 0; idx < (sizeof(paths)/sizeof(paths[0])); idx++) {
+        w[idx].word = (char*)paths[idx];
+        lk_tree_add_word(tree, paths[idx], &w[idx]);
+    }
+    for (size_t idx = 0; idx < (sizeof(wide)/sizeof(wide[0])); idx++) {
+        wide[idx][0] = 'q';
+        wide[idx][1] = (char)('0' + idx);
+        wide[idx][2] = '\0';
+        lk_tree_add_word(tree, wide[idx], &ww);
+    }
+
+    int r, failures = 0;
+    for (int fail_at = 0; ; fail_at++) {
+        alloc_countdown = fail_at;
+        r = lk_tree_minimize(tree);
+        alloc_countdown = -1;
+        if (r != LK_OUT_OF_MEMORY)
+            break;
+        failures++;
+
+        size_t found = 0;
+        for (size_t idx = 0; idx < (sizeof(paths)/sizeof(paths[0])); idx++) {
+            const struct lk_word_ptr *sw = lk_tree_search(tree, paths[idx]);
+            found += sw != NULL && sw->word == &w[idx] && sw->next == NULL;
+        }
+        for (size_t idx = 0; idx < (sizeof(wide)/sizeof(wide[0])); idx++)
+            found += lk_tree_search(tree, wide[idx]) != NULL;
+        ut_assert("All words found after failure", found == (sizeof(paths)/sizeof(paths[0])) + (sizeof(wide)/sizeof(wide[0])));
+        ut_assert("Tree is not minimized", !lk_tree_is_frozen(tree));
+    }
+    ut_assert("Minimized at last", r == LK_OK && failures > 0);
+
+    for (size_t idx = 0; idx < (sizeof(paths)/sizeof(paths[0])); idx++) {
+        const struct lk_word_ptr *sw = lk_tree_search(tree, paths[idx]);
+        ut_assert("Word found after minimizing", sw != NULL && sw->word == &w[idx]);
+    }
+
+    lk_tree_free(tree);
+#endif
+
+    return 0;
+}
+
+const char* test_minimize() {
+    int r;
+    struct lk_tree_stats st;
+
+    struct lk_tree *tree = lk_tree_init();
+    ut_assert("Tree create", tree != NULL);
+
+    char *p = "path", *p2 = "newpath";
+    struct lk_word w = {};
+    w.word = p;
+    struct lk_word w2 = {};
+    w2.word = p2;
+
+    lk_tree_add_word(tree, "abc", &w);
+    lk_tree_add_word(tree, "xbc", &w);
+    lk_tree_add_word(tree, "ybc", &w2);
+    lk_tree_add_word(tree, "yb", &w);
+    r = lk_tree_get_stats(tree, &st);
+    ut_assert("Nodes before", r == LK_OK && st.nodes == 9);
+
+    r = lk_tree_minimize(tree);
+    ut_assert("Tree minimized", r == LK_OK && lk_tree_is_frozen(tree));
+    r = lk_tree_get_stats(tree, &st);
+    ut_assert("Nodes after", r == LK_OK && st.nodes == 7);
+    r = lk_tree_add_word(tree, "xyz", &w);
+    ut_assert("Add to minimized", r == LK_INVALID_ARG);
+
+    const struct lk_word_ptr *sw = lk_tree_search(tree, "abc"), *sw2;
+    ut_assert("abc found", sw != NULL && sw->word == &w && sw->next == NULL);
+    sw2 = lk_tree_search(tree, "xbc");
+    ut_assert("xbc shared", sw2 == sw);
+    sw = lk_tree_search(tree, "ybc");
+    ut_assert("ybc found", sw != NULL && sw->word == &w2 && sw->next == NULL);
+    sw = lk_tree_search(tree, "yb");
+    ut_assert("yb found", sw != NULL && sw->word == &w && sw->next == NULL);
+    sw = lk_tree_search(tree, "xb");
+    ut_assert("xb not found", sw == NULL);
+
+    r = lk_tree_freeze(tree);
+    ut_assert("Minimized tree frozen", r == LK_OK);
+    sw = lk_tree_search(tree, "xbc");
+    ut_assert("xbc found", sw != NULL && sw->word == &w && sw->next == NULL);
+    sw = lk_tree_search(tree, "ybc");
+    ut_assert("ybc found", sw != NULL && sw->word == &w2 && sw->next == NULL);
+
+    lk_tree_free(tree);
+
+    return 0;
+}
+
+const char* test_step() {
+    int r;
+
+    struct lk_tree *tree = lk_tree_init();
+    struct lk_word w = {}, w2 = {};
+    lk_tree_add_word(tree, "abc", &w);
+    lk_tree_add_word(tree, "abčd", &w2);
+
+    for (int frozen = 0; frozen < 2; frozen++) {
+        struct lk_tree_pos pos, pos2;
+        lk_tree_root(tree, &pos);
+        ut_assert("Root has no words", lk_tree_pos_words(tree, &pos) == NULL);
+        r = lk_tree_step(tree, &pos, "ab", 2, NULL);
+        ut_assert("Prefix ab", r == LK_OK && lk_tree_pos_words(tree, &pos) == NULL);
+
+        pos2 = pos;
+        r = lk_tree_step(tree, &pos, "c", 1, NULL);
+        const struct lk_word_ptr *sw = lk_tree_pos_words(tree, &pos);
+        ut_assert("abc found", r == LK_OK && sw != NULL && sw->word == &w);
+        r = lk_tree_step(tree, &pos2, "čd", 3, NULL);
+        sw = lk_tree_pos_words(tree, &pos2);
+        ut_assert("abčd found", r == LK_OK && sw != NULL && sw->word == &w2);
+
+        r = lk_tree_step(tree, &pos, "x", 1, NULL);
+        ut_assert("abcx not found", r == LK_WORD_NOT_FOUND && lk_tree_pos_words(tree, &pos) == NULL);
+        r = lk_tree_step(tree, &pos, "d", 1, NULL);
+        ut_assert("Dead position", r == LK_WORD_NOT_FOUND);
+
+        struct lk_tree_pos trail[6];
+        lk_tree_root(tree, &pos);
+        r = lk_tree_step(tree, &pos, "abčd", 5, trail);
+        sw = lk_tree_pos_words(tree, &trail[4]);
+        ut_assert("Trail", r == LK_OK && sw != NULL && sw->word == &w2 && trail[1].state != -1);
+        pos = trail[1];
+        r = lk_tree_step(tree, &pos, "c", 1, NULL);
+        sw = lk_tree_pos_words(tree, &pos);
+        ut_assert("Continue from trail", r == LK_OK && sw != NULL && sw->word == &w);
+        lk_tree_root(tree, &pos);
+        r = lk_tree_step(tree, &pos, "xbčd", 5, trail);
+        ut_assert("Dead trail", r == LK_WORD_NOT_FOUND && trail[0].state == -1
+            && trail[3].state == -1 && trail[4].state == -1);
+
+        lk_tree_root(tree, &pos);
+        r = lk_tree_step(tree, &pos, "ab\xc4", 3, NULL);
+        ut_assert("Invalid UTF8", r == LK_INVALID_STRING);
+        r = lk_tree_step(NULL, &pos, "a", 1, NULL);
+        ut_assert("NULL tree", r == LK_INVALID_ARG);
+
+        lk_tree_root(tree, &pos);
+        r = lk_tree_step_char(tree, &pos, 'a');
+        ut_assert("Step char a", r == LK_OK);
+        r = lk_tree_step_char(tree, &pos, 'b');
+        ut_assert("Step char b", r == LK_OK);
+        r = lk_tree_step_char(tree, &pos, 0x10D);
+        ut_assert("Step char č", r == LK_OK);
+        r = lk_tree_step_char(tree, &pos, 'd');
+        sw = lk_tree_pos_words(tree, &pos);
+        ut_assert("abčd found by chars", r == LK_OK && sw != NULL && sw->word == &w2);
+        r = lk_tree_step_char(tree, &pos, 'e');
+        ut_assert("abčde not found", r == LK_WORD_NOT_FOUND && pos.state == -1);
+        r = lk_tree_step_char(NULL, &pos, 'a');
+        ut_assert("Step char NULL tree", r == LK_INVALID_ARG);
+
+        r = lk_tree_freeze(tree);
+        ut_assert("Tree frozen", r == LK_OK);
+    }
+
+    lk_tree_free(tree);
+
+    return 0;
+}
+
+const char* test_walk_many() {
+    lk_result r;
+
+    struct lk_tree *tree = lk_tree_init();
+    struct lk_word w = {};
+    const char *words[] = {"abc", "abčd", "ab", "x", "éfgh", "kʼa", "zzzz", "abcab"};
+    for (size_t idx = 0; idx < sizeof(words)/sizeof(words[0]); idx++)
+        lk_tree_add_word(tree, words[idx], &w);
+
+    /* more paths than walks in progress */
+    const char *paths[] = {
+        "abc", "abčd", "ab", "x", "éfgh", "kʼa", "zzzz", "abcab", "", "a", "abx",
+        "ab\xc4", "éfg", "abcabc", "y", "kʼ", "abc", "xx", "ab", "zzzz", "éfgh",
+    };
+    size_t n = sizeof(paths)/sizeof(paths[0]);
+    struct lk_tree_pos pos[sizeof(paths)/sizeof(paths[0])];
+
+    for (int frozen = 0; frozen < 2; frozen++) {
+        r = lk_tree_walk_many(tree, paths, n, pos);
+        ut_assert("Walk many", r == LK_OK);
+        for (size_t idx = 0; idx < n; idx++) {
+            struct lk_tree_pos one;
+            lk_tree_root(tree, &one);
+            lk_tree_step(tree, &one, paths[idx], strlen(paths[idx]), NULL);
+            ut_assert(paths[idx], one.state == pos[idx].state && one.leaf == pos[idx].leaf);
+        }
+        ut_assert("Words found", lk_tree_pos_words(tree, &pos[1]) != NULL
+            && lk_tree_pos_words(tree, &pos[9]) == NULL && pos[11].state == -1);
+
+        r = lk_tree_freeze(tree);
+        ut_assert("Tree frozen", r == LK_OK);
+    }
+
+    r = lk_tree_walk_many(tree, NULL, 1, pos);
+    ut_assert("NULL paths", r == LK_INVALID_ARG);
+    paths[3] = NULL;
+    r = lk_tree_walk_many(tree, paths, n, pos);
+    ut_assert("NULL path", r == LK_INVALID_ARG);
+    r = lk_tree_walk_many(tree, NULL, 0, NULL);
+    ut_assert("No paths", r == LK_OK);
+
     lk_tree_free(tree);
 
     return 0;
@@ -157,6 +590,13 @@ const char * run_all_test() {
 
     ut_run_test("Tree basics", test_basic);
     ut_run_test("Tree search", test_search);
+    ut_run_test("Tree freeze", test_freeze);
+    ut_run_test("Tree minimize", test_minimize);
+    ut_run_test("Tree minimize without memory", test_minimize_no_memory);
+    ut_run_test("Tree image", test_image);
+    ut_run_test("Tree merge", test_merge);
+    ut_run_test("Tree step", test_step);
+    ut_run_test("Tree walk many", test_walk_many);
 
     return 0;
 }
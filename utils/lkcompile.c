@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lk_common.h"
+#include "lk_dict.h"
+
+int main (int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: lkcompile dictionary_file image_file\n");
+        return 0;
+    }
+
+    struct lk_dictionary *dict = lk_dict_init();
+    if (dict == NULL) {
+        fprintf(stderr, "Failed to initialize dictionary\n");
+        return 1;
+    }
+
+    lk_result res = lk_read_dictionary(dict, argv[1]);
+    if (res != LK_OK) {
+        fprintf(stderr, "Failed to read dictionary: %d\n", res);
+        lk_dict_close(dict);
+        return 1;
+    }
+
+    res = lk_dict_save_image(dict, argv[2]);
+    if (res != LK_OK) {
+        fprintf(stderr, "Failed to write image: %d\n", res);
+        lk_dict_close(dict);
+        return 1;
+    }
+
+    struct lk_dict_stats stats;
+    if (lk_dict_get_stats(dict, &stats) == LK_OK)
+        printf("Words: %u, base forms: %u, keys: %u, trie states: %u\n", (unsigned)stats.words,
+                (unsigned)stats.bases, (unsigned)stats.keys, (unsigned)stats.nodes);
+
+    lk_dict_close(dict);
+    return 0;
+}
@@ -33,3 +33,24 @@ project "textparse"
    objdir "../obj/utils"
    targetdir "../out/"
    links { "utf8proc", "lkchecker" }
+
+   configuration "linux"
+      links { "pthread" }
+
+project "lkcompile"
+   kind "ConsoleApp"
+   language "C"
+
+   if not _OPTIONS["utf8proc_inc"] then
+       includedirs { "../lib/include" }
+   else
+       includedirs { _OPTIONS["utf8proc_inc"], "../lib/include" }
+   end
+   if _OPTIONS["utf8proc_lib"] then
+       libdirs { _OPTIONS["utf8proc_lib"] }
+   end
+
+   files { "lkcompile.c" }
+   objdir "../obj/utils"
+   targetdir "../out/"
+   links { "utf8proc", "lkchecker" }
@@ -1,10 +1,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#else
+#include <pthread.h>
 #endif
 
 #include <utf8proc.h>
@@ -12,8 +15,10 @@
 #include "lk_file.h"
 #include "lk_utils.h"
 
-#define LINE_SIZE (32*1024)
 #define WORD_SIZE 96
+#define MAX_JOBS 64
+/* number of words lk_split_words finds in one call */
+#define WORD_BATCH 256
 
 typedef struct {
     size_t cap;
@@ -119,75 +124,200 @@ int arr_add(dynarr *arr, const char *word) {
     return 1;
 }
 
-int main (int argc, char** argv) {
-    if (argc < 2) {
-        printf("Usage: textparse text_file_to_parse\n");
-        return 0;
-    }
-
-    struct lk_file *file = lk_file_open(argv[1]);
+/**
+ * @struct parse_job
+ * A part of the text file parsed by one thread
+ */
+typedef struct {
+    const char *path;
+    struct lk_file_range range;
+    dynarr *words; /* unique words of the part in low case */
+    int ok;
+} parse_job;
+
+/* collects unique words of the lines in the range of the job */
+static int parse_range(parse_job *job) {
+    struct lk_file *file = lk_file_open_range(job->path, LK_FILE_MMAP, job->range.begin, job->range.end);
     if (!lk_file_is_valid(file)) {
-        printf("Invalid file\n");
+        fprintf(stderr, "Invalid file\n");
+        lk_file_close(file);
         return 0;
     }
+    /* words of checked lines are converted without decoding checks */
+    lk_file_check_utf8(file, 1);
 
-
-    char line[LINE_SIZE];
-    char word[WORD_SIZE];
-    char lowword[WORD_SIZE];
+    /* low case form can be longer: a glottal stop ` becomes two-byte ʼ */
+    char lowword[WORD_SIZE * 2];
+    struct lk_word_span words[WORD_BATCH];
     lk_result res = LK_OK;
+    int ok = 1;
 
-    dynarr *ar = arr_init(5);
-
-    while (res == LK_OK) {
-        res = lk_file_read(file, line, LINE_SIZE);
+    while (res == LK_OK && ok) {
+        const char *line;
+        size_t len;
+        res = lk_file_read_line(file, &line, &len);
         if (res == LK_EOF)
             break;
 
         if (res != LK_OK) {
             fprintf(stderr, "Failed to read file: %d\n", res);
-            return 0;
+            ok = 0;
+            break;
         }
 
-        size_t len = 0;
-        const char *start = line;
-        while (start != NULL) {
-            size_t tmp = len;
-            start = lk_next_word(start, &len);
-
-            if (start != NULL) {
-                if (len >= WORD_SIZE) {
-                    fprintf(stderr, "Word at pos %d too long - skipping...\n   len=%d word=[%s]\n", (int)tmp, (int)len, line);
+        int trusted = lk_file_line_trusted(file);
+        size_t from = 0;
+        lk_result split = LK_BUFFER_SMALL;
+        while (split == LK_BUFFER_SMALL && ok) {
+            size_t count = WORD_BATCH;
+            split = lk_split_words(line + from, len - from, words, &count);
+
+            for (size_t idx = 0; idx < count; idx++) {
+                const char *start = line + from + words[idx].offset;
+                size_t wlen = words[idx].len;
+                if (wlen >= WORD_SIZE) {
+                    fprintf(stderr, "Word at pos %d too long - skipping...\n   len=%d word=[%s]\n",
+                            (int)(start - line), (int)wlen, line);
                     continue;
                 }
 
-                strncpy(word, start, len);
-                word[len] = '\0';
-                res = lk_to_low_case(word, lowword, LINE_SIZE);
+                if (trusted)
+                    res = lk_to_low_case_trusted(start, wlen, lowword, sizeof(lowword));
+                else
+                    res = lk_to_low_case_n(start, wlen, lowword, sizeof(lowword));
                 if (res != LK_OK) {
-                    fprintf(stderr, "Failed to convert word to lowcase: %d [%s]\n", res, word);
-                    return 0;
+                    fprintf(stderr, "Failed to convert word to lowcase: %d [%.*s]\n", res, (int)wlen, start);
+                    ok = 0;
+                    break;
                 }
 
                 int vowcnt = lk_vowels_no(lowword);
                 int vowstr = lk_stressed_vowels_no(lowword);
 
                 if (vowcnt == 0 || (vowcnt > 1 && vowstr == 0))
-                    fprintf(stderr, "Invalid word - no vowels: [%s]\n", word);
+                    fprintf(stderr, "Invalid word - no vowels: [%.*s]\n", (int)wlen, start);
                 else {
 
                     /* printf("%s\n", lowword); */
-                    int r = arr_add(ar, lowword);
+                    int r = arr_add(job->words, lowword);
                     if (!r) {
                         fprintf(stderr, "Failed to add a word to array\n");
                     }
                 }
-
-                start += len;
             }
+
+            /* the next batch starts after the last word of this one */
+            if (count != 0)
+                from += words[count - 1].offset + words[count - 1].len;
         }
     }
 
+    unsigned long long offset;
+    if (lk_file_utf8_error(file, &offset) == LK_INVALID_STRING)
+        fprintf(stderr, "Invalid UTF8 at byte %llu\n", offset);
+    lk_file_close(file);
+
+    return ok;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI parse_thread(LPVOID arg) {
+    parse_job *job = (parse_job*)arg;
+    job->ok = parse_range(job);
+    return 0;
+}
+#else
+static void* parse_thread(void *arg) {
+    parse_job *job = (parse_job*)arg;
+    job->ok = parse_range(job);
+    return NULL;
+}
+#endif
+
+/* parses parts of the file in parallel, a part per thread */
+static int run_jobs(parse_job *jobs, size_t cnt) {
+#ifdef _WIN32
+    HANDLE th[MAX_JOBS];
+#else
+    pthread_t th[MAX_JOBS];
+#endif
+    int started[MAX_JOBS];
+
+    for (size_t idx = 0; idx < cnt; idx++) {
+#ifdef _WIN32
+        th[idx] = CreateThread(NULL, 0, parse_thread, &jobs[idx], 0, NULL);
+        started[idx] = th[idx] != NULL;
+#else
+        started[idx] = pthread_create(&th[idx], NULL, parse_thread, &jobs[idx]) == 0;
+#endif
+        /* a part is parsed by this thread if a new one is not started */
+        if (!started[idx])
+            jobs[idx].ok = parse_range(&jobs[idx]);
+    }
+
+    int ok = 1;
+    for (size_t idx = 0; idx < cnt; idx++) {
+        if (started[idx]) {
+#ifdef _WIN32
+            WaitForSingleObject(th[idx], INFINITE);
+            CloseHandle(th[idx]);
+#else
+            pthread_join(th[idx], NULL);
+#endif
+        }
+        ok = ok && jobs[idx].ok;
+    }
+
+    return ok;
+}
+
+int main (int argc, char** argv) {
+    size_t jobs_cnt = 1;
+    int argi = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        jobs_cnt = (size_t)atoi(argv[2]);
+        argi = 3;
+    }
+    if (argc <= argi || jobs_cnt == 0 || jobs_cnt > MAX_JOBS) {
+        printf("Usage: textparse [-j threads] text_file_to_parse\n");
+        printf("   threads - number of threads from 1 to %d, the file is split into\n"
+               "     as many parts of the same size\n", MAX_JOBS);
+        return 0;
+    }
+
+    /* one thread reads the whole file, so it works for pipes as well */
+    struct lk_file_range ranges[MAX_JOBS] = {{0, ULLONG_MAX}};
+    lk_result res = jobs_cnt == 1 ? LK_OK : lk_file_plan_chunks(argv[argi], ranges, jobs_cnt);
+    if (res != LK_OK) {
+        printf("Invalid file\n");
+        return 0;
+    }
+
+    parse_job jobs[MAX_JOBS];
+    for (size_t idx = 0; idx < jobs_cnt; idx++) {
+        jobs[idx].path = argv[argi];
+        jobs[idx].range = ranges[idx];
+        jobs[idx].ok = 0;
+        jobs[idx].words = arr_init(5);
+        if (jobs[idx].words == NULL) {
+            fprintf(stderr, "Failed to allocate memory for words\n");
+            return 0;
+        }
+    }
+
+    if (!run_jobs(jobs, jobs_cnt))
+        return 0;
+
+    /* the parts may have common words */
+    dynarr *ar = jobs[0].words;
+    for (size_t idx = 1; idx < jobs_cnt; idx++) {
+        for (size_t w = 0; w < jobs[idx].words->len; w++) {
+            if (!arr_add(ar, jobs[idx].words->arr[w]))
+                fprintf(stderr, "Failed to add a word to array\n");
+        }
+        arr_free(jobs[idx].words);
+    }
+
     /* printf("-------------------------\n"); */
     for (size_t i = 0; i < ar->len; ++i) {
         printf("%s\n", ar->arr[i]);
@@ -195,7 +325,5 @@ int main (int argc, char** argv) {
 
     arr_free(ar);
 
-    lk_file_close(file);
-
     return 0;
 }